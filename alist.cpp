@@ -37,6 +37,7 @@ AList::AList()
     list = 0;
     lastelem = 0;
     num = 0;
+    iterators = 0;
 }
 
 /// A destructor for the Alist class
@@ -63,6 +64,8 @@ void AList::DeleteAll()
     }
     lastelem = 0;
     num = 0;
+    for (AListSafeIterator *it = iterators; it; it = it->nextiter)
+        it->next = it->stop = 0;
 }
 
 /// Set every element in a list to 0
@@ -80,6 +83,8 @@ void AList::Empty()
     }
     lastelem = 0;
     num = 0;
+    for (AListSafeIterator *it = iterators; it; it = it->nextiter)
+        it->next = it->stop = 0;
 }
 
 /// Insert an AListElem at the start of the list.
@@ -138,13 +143,17 @@ char AList::Remove(AListElem * e)
     if (!e) return 0;
     if (!e->next) lastelem = 0;
 
+    AListElem *prev = 0;
     for (AListElem **pp = &list; *pp; pp = &((*pp)->next)) {
         if (*pp == e) {
+            for (AListSafeIterator *it = iterators; it; it = it->nextiter)
+                it->Removed(e, prev);
             *pp = e->next;
             num--;
             return 1;
         }
         if (!e->next) lastelem = *pp;
+        prev = *pp;
     }
     return 0;
 }
@@ -155,13 +164,44 @@ int AList::Num()
     return num;
 }
 
-/// No idea what this one does.
-int AList::NextLive(AListElem **copy, int size, int pos)
+/// Start a safe iteration over a list
+AListSafeIterator::AListSafeIterator(AList *l)
 {
-    while (++pos < size) {
-        for (AListElem *elem = First(); elem; elem = elem->next) {
-            if (elem == copy[pos]) return pos;
+    list = l;
+    next = l->list;
+    stop = l->lastelem;
+    nextiter = l->iterators;
+    l->iterators = this;
+}
+
+/// Finish a safe iteration, detaching it from its list
+AListSafeIterator::~AListSafeIterator()
+{
+    for (AListSafeIterator **pp = &list->iterators; *pp;
+            pp = &((*pp)->nextiter)) {
+        if (*pp == this) {
+            *pp = nextiter;
+            break;
         }
     }
-    return pos;
+}
+
+/// Return the next element to visit, or 0 when done
+AListElem * AListSafeIterator::Next()
+{
+    AListElem *e = next;
+    if (!e) return 0;
+    next = (e == stop) ? 0 : e->next;
+    return e;
+}
+
+/// Called by the list just before e (which follows prev) is unlinked
+void AListSafeIterator::Removed(AListElem *e, AListElem *prev)
+{
+    if (next == e) next = (e == stop) ? 0 : e->next;
+    if (stop == e) {
+        // Everything up to the new last element is still to come
+        stop = prev;
+        if (!prev) next = 0;
+    }
 }
@@ -27,6 +27,7 @@
 
 class AListElem;
 class AList;
+class AListSafeIterator;
 
 /// This represents an element of a list.
 /** 
@@ -56,15 +57,40 @@ class AList {
         AListElem * First();
         int Num();
 
-        /* Helper function for forlist_safe */
-        int NextLive(AListElem **copy, int size, int pos);
-
     private:
+        friend class AListSafeIterator;
+
         AListElem *list;        ///< The first element of the list
         AListElem *lastelem;    ///< The last element of the list
+        AListSafeIterator *iterators; ///< Safe iterations in progress
         int num;
 };
 
+/// Iterate over a list while it is being changed.
+/**
+Visits the elements that were in the list when the iteration started, in
+order, skipping any that have been removed by the time they are reached.
+Elements added during the iteration are not visited.  The list tells each
+iterator in progress about removals, so no copy of the list is needed.
+*/
+class AListSafeIterator {
+    public:
+        AListSafeIterator(AList *);
+        ~AListSafeIterator();
+
+        AListElem * Next();
+
+    private:
+        friend class AList;
+
+        void Removed(AListElem *e, AListElem *prev);
+
+        AList *list;
+        AListElem *next;        ///< The next element to visit
+        AListElem *stop;        ///< The last element to visit
+        AListSafeIterator *nextiter;
+};
+
 /// Iterate over a list
 #define forlist(l) \
     AListElem * elem, * _elem2; \
@@ -82,17 +108,9 @@ class AList {
             elem = _elem2, \
             _elem2 = (_elem2 ? ((l)->Next(_elem2)) : 0))
 
-/// Iterate over a list (without messing it up?)
+/// Iterate over a list whose elements may be removed by the loop body
 #define forlist_safe(l) \
-    int size = (l)->Num(); \
-    AListElem **copy = new AListElem*[size]; \
     AListElem *elem; \
-    int pos; \
-    for (pos = 0, elem = (l)->First(); elem; elem = elem->next, pos++) { \
-        copy[pos] = elem; \
-    } \
-    for (pos = 0; \
-            pos < size ? (elem = copy[pos], 1) : (delete [] copy, 0); \
-            pos = (l)->NextLive(copy, size, pos))
+    for (AListSafeIterator _safeiter(l); (elem = _safeiter.Next()); )
 
 #endif
@@ -27,6 +27,8 @@
 #include <string.h>
 #include "game.h"
 #include "gamedata.h"
+#include "lookup.h"
+#include "threadpool.h"
 
 Location *GetUnit(AList *list, int n)
 {
@@ -117,6 +119,11 @@ ARegion::ARegion()
     town = 0;
     development = 0;
     habitat = 0;
+    elevation = 0;
+    humidity = 0;
+    temperature = 0;
+    vegetation = 0;
+    culture = 0;
     immigrants = 0;
     emigrants = 0;
     improvement = 0;
@@ -125,12 +132,20 @@ ARegion::ARegion()
     for (int i=0; i<NDIRS; i++)
         neighbors[i] = 0;
     visited = 0;
+    battlecount = 0;
+    distancesearch = 0;
+    sightfacs = 0;
+    numsightfacs = 0;
+    sightunits = 0;
+    sightvalid = 0;
 }
 
 ARegion::~ARegion()
 {
     if (name) delete name;
     if (town) delete town;
+    delete [] sightfacs;
+    delete [] sightunits;
 }
 
 void ARegion::ZeroNeighbors()
@@ -770,8 +785,7 @@ void ARegion::Kill(Unit *u)
 
     if (first) {
         // give u's stuff to first
-        forlist(&u->items) {
-            Item *i = (Item *) elem;
+        forlist_items(&u->items, i) {
             if (ItemDefs[i->type].type & IT_SHIP &&
                     first->items.GetNum(i->type) > 0) {
                 if (first->items.GetNum(i->type) > i->num)
@@ -846,6 +860,7 @@ void ARegion::CheckFleets()
             // aboard when they're not at sea.
             if (TerrainDefs[type].similar_type != R_OCEAN) alive = 1;
             if ((alive == 0) || (bail == 1)) {
+                InvalidateSight();
                 objects.Remove(o);
                 delete o;
             }
@@ -855,19 +870,23 @@ void ARegion::CheckFleets()
 
 Unit *ARegion::GetUnit(int num)
 {
-    forlist((&objects)) {
-        Object *obj = (Object *) elem;
-        Unit *u = obj->GetUnit(num);
-        if (u) {
-            return(u);
-        }
-    }
+    Unit *u = AllUnits.GetUnit(num);
+    if (u && u->object && u->object->region == this) return u;
     return 0;
 }
 
 Location *ARegion::GetLocation(UnitId *id, int faction)
 {
     Unit *retval = 0;
+    if (id && id->unitnum) {
+        retval = GetUnit(id->unitnum);
+        if (!retval) return 0;
+        Location *l = new Location;
+        l->region = this;
+        l->obj = retval->object;
+        l->unit = retval;
+        return l;
+    }
     forlist(&objects) {
         Object *o = (Object *) elem;
         retval = o->GetUnitId(id, faction);
@@ -897,6 +916,7 @@ Unit *ARegion::GetUnitAlias(int alias, int faction)
 Unit *ARegion::GetUnitId(UnitId *id, int faction)
 {
     Unit *retval = 0;
+    if (id && id->unitnum) return GetUnit(id->unitnum);
     forlist(&objects) {
         Object *o = (Object *) elem;
         retval = o->GetUnitId(id, faction);
@@ -948,12 +968,7 @@ Location *ARegionList::GetUnitId(UnitId *id, int faction, ARegion *cur)
 
 int ARegion::Present(Faction *f)
 {
-    forlist((&objects)) {
-        Object *obj = (Object *) elem;
-        forlist((&obj->units))
-            if (((Unit *) elem)->faction == f) return 1;
-    }
-    return 0;
+    return GetSight(f) != 0;
 }
 
 AList *ARegion::PresentFactions()
@@ -975,6 +990,7 @@ AList *ARegion::PresentFactions()
 
 void ARegion::Writeout(Aoutfile *f)
 {
+    f->StartSection(SECTION_REGION);
     f->PutStr(*name);
     f->PutInt(num);
     if (type != -1) f->PutStr(TerrainDefs[type].type);
@@ -1016,6 +1032,7 @@ void ARegion::Writeout(Aoutfile *f)
 
     f->PutInt(objects.Num());
     forlist ((&objects)) ((Object *) elem)->Writeout(f);
+    f->EndSection();
 }
 
 int LookupRegionType(AString *token)
@@ -1026,23 +1043,29 @@ int LookupRegionType(AString *token)
     return -1;
 }
 
-void ARegion::Readin(Ainfile *f, AList *facs, ATL_VER v)
+int LookupRegionType(char const *token)
 {
-    AString *temp;
+    if (!token) return -1;
+    for (int i = 0; i < R_NUM; i++) {
+        if (TerrainDefs[i].type &&
+                LookupTable::Same(token, TerrainDefs[i].type))
+            return i;
+    }
+    return -1;
+}
 
+void ARegion::Readin(Ainfile *f, AList *facs, ATL_VER v)
+{
+    f->StartSection(SECTION_REGION);
     name = f->GetStr();
 
     num = f->GetInt();
-    temp = f->GetStr();
-    type = LookupRegionType(temp);
-    delete temp;
+    type = LookupRegionType(f->GetView());
     buildingseq = f->GetInt();
     gate = f->GetInt();
     if (gate > 0) gatemonth = f->GetInt();
 
-    temp = f->GetStr();
-    race = LookupItem(temp);
-    delete temp;
+    race = LookupItem(f->GetView());
 
     population = f->GetInt();
     basepopulation = f->GetInt();
@@ -1086,6 +1109,7 @@ void ARegion::Readin(Ainfile *f, AList *facs, ATL_VER v)
     }
     fleetalias = 1;
     newfleets.clear();
+    f->EndSection();
 }
 
 int ARegion::CanMakeAdv(Faction *fac, int item)
@@ -1454,15 +1478,8 @@ void ARegion::WriteReport(Areport *f, Faction *fac, int month,
             passobs = 10;
         }
 
-        forlist (&objects) {
-            Object *o = (Object *) elem;
-            forlist(&o->units) {
-                Unit *u = (Unit *) elem;
-                if (u->faction == fac && u->GetSkill(S_MIND_READING) > 2) {
-                    detfac = 1;
-                }
-            }
-        }
+        FactionSight *fs = GetSight(fac);
+        if (fs && fs->detfac) detfac = 1;
         if (Globals->IMPROVED_FARSIGHT && farsight) {
             forlist(&farsees) {
                 Farsight *watcher = (Farsight *)elem;
@@ -1652,16 +1669,8 @@ int ARegion::GetTrueSight(Faction *f, int usepassers)
         }
     }
 
-    forlist ((&objects)) {
-        Object *obj = (Object *) elem;
-        forlist ((&obj->units)) {
-            Unit *u = (Unit *) elem;
-            if (u->faction == f) {
-                int temp = u->GetSkill(S_TRUE_SEEING);
-                if (temp>truesight) truesight = temp;
-            }
-        }
-    }
+    FactionSight *fs = GetSight(f);
+    if (fs && fs->truesight > truesight) truesight = fs->truesight;
     return truesight;
 }
 
@@ -1691,17 +1700,152 @@ int ARegion::GetObservation(Faction *f, int usepassers)
         }
     }
 
-    forlist ((&objects)) {
-        Object *obj = (Object *) elem;
-        forlist ((&obj->units)) {
-            Unit *u = (Unit *) elem;
-            if (u->faction == f) {
-                int temp = u->GetAttribute("observation");
-                if (temp>obs) obs = temp;
+    FactionSight *fs = GetSight(f);
+    if (fs && fs->observation > obs) obs = fs->observation;
+    return obs;
+}
+
+void ARegion::InvalidateSight()
+{
+    sightvalid = 0;
+}
+
+// Works out every faction's figures now rather than on first use.
+void ARegion::UpdateSight()
+{
+    if (!sightvalid) {
+        BuildSight();
+        return;
+    }
+    for (int i = 0; i < numsightfacs; i++)
+        RefreshSight(&sightfacs[i]);
+}
+
+// Returns the sight summary for the faction's units here, or 0 if it
+// has none.  A faction whose units have changed skills, items or state
+// since the summary was taken gets its figures worked out again.
+FactionSight *ARegion::GetSight(Faction *f)
+{
+    if (!sightvalid) BuildSight();
+
+    int lo = 0;
+    int hi = numsightfacs - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        FactionSight *fs = &sightfacs[mid];
+        if (fs->factionnum < f->num) {
+            lo = mid + 1;
+        } else if (fs->factionnum > f->num) {
+            hi = mid - 1;
+        } else {
+            for (int i = fs->first; i < fs->first + fs->count; i++) {
+                SightUnit *s = &sightunits[i];
+                Unit *u = s->unit;
+                if (s->items != u->items.version ||
+                        s->skills != u->skills.version ||
+                        s->flags != u->flags || s->guard != u->guard ||
+                        s->type != u->type) {
+                    RefreshSight(fs);
+                    break;
+                }
             }
+            return fs;
         }
     }
-    return obs;
+    return 0;
+}
+
+// Groups the units here by faction, keeping their order within each
+// faction, and works out every faction's figures.
+void ARegion::BuildSight()
+{
+    int n = 0;
+    forlist(&objects) {
+        Object *o = (Object *) elem;
+        n += o->units.Num();
+    }
+
+    delete [] sightfacs;
+    delete [] sightunits;
+    sightfacs = new FactionSight[n];
+    sightunits = new SightUnit[n];
+    numsightfacs = 0;
+
+    // Sorted list of the factions present, with a unit count for each
+    {
+        forlist(&objects) {
+            Object *o = (Object *) elem;
+            forlist(&o->units) {
+                int fnum = ((Unit *) elem)->faction->num;
+                int lo = 0;
+                int hi = numsightfacs;
+                while (lo < hi) {
+                    int mid = (lo + hi) / 2;
+                    if (sightfacs[mid].factionnum < fnum) lo = mid + 1;
+                    else hi = mid;
+                }
+                if (lo == numsightfacs || sightfacs[lo].factionnum != fnum) {
+                    for (int i = numsightfacs; i > lo; i--)
+                        sightfacs[i] = sightfacs[i - 1];
+                    sightfacs[lo].factionnum = fnum;
+                    sightfacs[lo].count = 0;
+                    numsightfacs++;
+                }
+                sightfacs[lo].count++;
+            }
+        }
+    }
+
+    int first = 0;
+    for (int i = 0; i < numsightfacs; i++) {
+        sightfacs[i].first = first;
+        first += sightfacs[i].count;
+        sightfacs[i].count = 0;
+    }
+
+    {
+        forlist(&objects) {
+            Object *o = (Object *) elem;
+            forlist(&o->units) {
+                Unit *u = (Unit *) elem;
+                int lo = 0;
+                int hi = numsightfacs;
+                while (lo < hi) {
+                    int mid = (lo + hi) / 2;
+                    if (sightfacs[mid].factionnum < u->faction->num)
+                        lo = mid + 1;
+                    else hi = mid;
+                }
+                FactionSight *fs = &sightfacs[lo];
+                sightunits[fs->first + fs->count].unit = u;
+                fs->count++;
+            }
+        }
+    }
+
+    for (int i = 0; i < numsightfacs; i++)
+        RefreshSight(&sightfacs[i]);
+    sightvalid = 1;
+}
+
+void ARegion::RefreshSight(FactionSight *fs)
+{
+    fs->detfac = 0;
+    for (int i = fs->first; i < fs->first + fs->count; i++) {
+        SightUnit *s = &sightunits[i];
+        Unit *u = s->unit;
+        int obs = u->GetAttribute(AT_OBSERVATION);
+        int truesight = u->GetSkill(S_TRUE_SEEING);
+        if (i == fs->first || obs > fs->observation) fs->observation = obs;
+        if (i == fs->first || truesight > fs->truesight)
+            fs->truesight = truesight;
+        if (u->GetSkill(S_MIND_READING) > 2) fs->detfac = 1;
+        s->items = u->items.version;
+        s->skills = u->skills.version;
+        s->flags = u->flags;
+        s->guard = u->guard;
+        s->type = u->type;
+    }
 }
 
 void ARegion::SetWeather(int newWeather)
@@ -1907,6 +2051,7 @@ int ARegion::ForbiddenShip(Object *ship)
 
 void ARegion::DefaultOrders()
 {
+    battlecount = 0;
     forlist((&objects)) {
         Object *obj = (Object *) elem;
         forlist ((&obj->units))
@@ -1978,6 +2123,9 @@ ARegionList::ARegionList()
     pRegionArrays = 0;
     numLevels = 0;
     numberofgates = 0;
+    pRegionIndex = 0;
+    numIndexed = 0;
+    planarSearch = 0;
 }
 
 ARegionList::~ARegionList()
@@ -1990,9 +2138,10 @@ ARegionList::~ARegionList()
 
         delete pRegionArrays;
     }
+    if (pRegionIndex) delete pRegionIndex;
 }
 
-void ARegionList::WriteRegions(Aoutfile *f)
+void ARegionList::WriteRegions(Aoutfile *f, ThreadPool *pool)
 {
     f->PutInt(Num());
 
@@ -2011,7 +2160,11 @@ void ARegionList::WriteRegions(Aoutfile *f)
     }
 
     f->PutInt(numberofgates);
-    forlist(this) ((ARegion *) elem)->Writeout(f);
+    if (f->binary || pool) {
+        WriteRegionBlocks(f, pool);
+    } else {
+        forlist(this) ((ARegion *) elem)->Writeout(f);
+    }
     {
         f->PutStr("Neighbors");
         forlist(this) {
@@ -2027,7 +2180,159 @@ void ARegionList::WriteRegions(Aoutfile *f)
     }
 }
 
-int ARegionList::ReadRegions(Ainfile *f, AList *factions, ATL_VER v)
+// Regions are handed to the threads this many at a time
+#define REGION_CHUNK 64
+
+struct RegionJob {
+    ARegion **regions;
+    int count;
+    Aoutfile *parts;
+    int binary;
+
+    Ainfile *file;
+    long base;
+    long *offsets;
+    AList *factions;
+    ATL_VER v;
+    int *damaged; // One for each chunk of regions
+};
+
+void ARegionList::WriteRegionJob(int n, void *arg)
+{
+    RegionJob *job = (RegionJob *) arg;
+    Aoutfile *part = &job->parts[n];
+    int last = (n + 1) * REGION_CHUNK;
+    if (last > job->count) last = job->count;
+    part->OpenBuffer(job->binary);
+    for (int i = n * REGION_CHUNK; i < last; i++) {
+        job->regions[i]->Writeout(part);
+        job->offsets[i + 1] = part->Size();
+    }
+}
+
+// Each run of regions is written to a buffer of its own, so they can
+// all be written at once, and the buffers are then copied into the file
+// in order.  Binary files get a table of where each region starts.
+void ARegionList::WriteRegionBlocks(Aoutfile *f, ThreadPool *pool)
+{
+    RegionJob job;
+    int chunks = (Num() + REGION_CHUNK - 1) / REGION_CHUNK;
+    int i = 0;
+    job.count = Num();
+    job.regions = new ARegion *[job.count];
+    job.offsets = new long[job.count + 1];
+    job.parts = new Aoutfile[chunks];
+    job.binary = f->binary;
+    forlist(this) {
+        job.regions[i++] = (ARegion *) elem;
+    }
+
+    if (pool) {
+        pool->Run(chunks, WriteRegionJob, &job);
+    } else {
+        for (i = 0; i < chunks; i++) WriteRegionJob(i, &job);
+    }
+
+    if (f->binary) {
+        // The jobs counted from the start of their own buffers
+        long base = 0;
+        job.offsets[0] = 0;
+        for (i = 0; i < job.count; i++) {
+            if (i && !(i % REGION_CHUNK))
+                base += job.parts[i / REGION_CHUNK - 1].Size();
+            job.offsets[i + 1] += base;
+        }
+        f->StartSection(SECTION_REGIONTABLE);
+        f->PutInt(job.count);
+        for (i = 0; i <= job.count; i++) f->PutInt(job.offsets[i]);
+        f->EndSection();
+    }
+    for (i = 0; i < chunks; i++) {
+        f->Append(&job.parts[i]);
+        job.parts[i].Close();
+    }
+
+    delete [] job.parts;
+    delete [] job.offsets;
+    delete [] job.regions;
+}
+
+// A region only reads into itself and its own objects and units, so
+// each can be read from its own part of the file at the same time.
+void ARegionList::ReadRegionJob(int n, void *arg)
+{
+    RegionJob *job = (RegionJob *) arg;
+    Ainfile part;
+    int last = (n + 1) * REGION_CHUNK;
+    if (last > job->count) last = job->count;
+    for (int i = n * REGION_CHUNK; i < last; i++) {
+        part.OpenPart(job->file, job->base + job->offsets[i],
+                job->base + job->offsets[i + 1]);
+        job->regions[i]->Readin(&part, job->factions, job->v);
+        if (part.damaged) job->damaged[n] = 1;
+        part.Close();
+    }
+}
+
+int ARegionList::ReadRegionBlocks(Ainfile *f, AList *factions, ATL_VER v,
+        int num, ThreadPool *pool)
+{
+    RegionJob job;
+    int chunks = (num + REGION_CHUNK - 1) / REGION_CHUNK;
+    int i;
+
+    f->StartSection(SECTION_REGIONTABLE);
+    if (f->GetInt() != num) return 0;
+    job.offsets = new long[num + 1];
+    for (i = 0; i <= num; i++) job.offsets[i] = f->GetInt();
+    f->EndSection();
+    job.base = f->Tell();
+    for (i = 0; i < num; i++) {
+        if (job.offsets[i] < 0 || job.offsets[i] > job.offsets[i + 1])
+            break;
+    }
+    if (i < num || job.base + job.offsets[num] > f->Size()) {
+        Awrite("The region table is damaged!");
+        delete [] job.offsets;
+        return 0;
+    }
+
+    job.count = num;
+    job.regions = new ARegion *[num];
+    for (i = 0; i < num; i++) job.regions[i] = new ARegion;
+    job.file = f;
+    job.factions = factions;
+    job.v = v;
+    job.damaged = new int[chunks];
+    for (i = 0; i < chunks; i++) job.damaged[i] = 0;
+
+    if (pool) {
+        pool->Run(chunks, ReadRegionJob, &job);
+    } else {
+        for (i = 0; i < chunks; i++) ReadRegionJob(i, &job);
+    }
+    f->Seek(job.base + job.offsets[num]);
+    for (i = 0; i < chunks; i++) {
+        if (job.damaged[i]) f->damaged = 1;
+    }
+    delete [] job.damaged;
+
+    for (i = 0; i < num; i++) {
+        ARegion *temp = job.regions[i];
+        pRegionIndex->SetRegion(temp->num, temp);
+        Add(temp);
+
+        pRegionArrays[temp->zloc]->SetRegion(temp->xloc, temp->yloc,
+                                                temp);
+    }
+
+    delete [] job.regions;
+    delete [] job.offsets;
+    return 1;
+}
+
+int ARegionList::ReadRegions(Ainfile *f, AList *factions, ATL_VER v,
+        ThreadPool *pool)
 {
     int num = f->GetInt();
 
@@ -2051,28 +2356,35 @@ int ARegionList::ReadRegions(Ainfile *f, AList *factions, ATL_VER v)
 
     numberofgates = f->GetInt();
 
-    ARegionFlatArray fa(num);
+    if (pRegionIndex) delete pRegionIndex;
+    pRegionIndex = new ARegionFlatArray(num);
 
     Awrite("Reading the regions...");
-    for (i = 0; i < num; i++) {
-        ARegion *temp = new ARegion;
-        temp->Readin(f, factions, v);
-        fa.SetRegion(temp->num, temp);
-        Add(temp);
+    if (f->version >= 2) {
+        if (!ReadRegionBlocks(f, factions, v, num, pool)) return 0;
+    } else {
+        for (i = 0; i < num; i++) {
+            ARegion *temp = new ARegion;
+            temp->Readin(f, factions, v);
+            pRegionIndex->SetRegion(temp->num, temp);
+            Add(temp);
 
-        pRegionArrays[temp->zloc]->SetRegion(temp->xloc, temp->yloc,
-                                                temp);
+            pRegionArrays[temp->zloc]->SetRegion(temp->xloc, temp->yloc,
+                                                    temp);
+        }
     }
 
+    numIndexed = Num();
+
     Awrite("Setting up the neighbors...");
     {
-        delete f->GetStr();
+        f->GetView();
         forlist(this) {
             ARegion *reg = (ARegion *) elem;
             for (i = 0; i < NDIRS; i++) {
                 int j = f->GetInt();
                 if (j != -1) {
-                    reg->neighbors[i] = fa.GetRegion(j);
+                    reg->neighbors[i] = pRegionIndex->GetRegion(j);
                 } else {
                     reg->neighbors[i] = 0;
                 }
@@ -2084,10 +2396,29 @@ int ARegionList::ReadRegions(Ainfile *f, AList *factions, ATL_VER v)
 
 ARegion *ARegionList::GetRegion(int n)
 {
+    // Regions are only ever appended (world creation or loading),
+    // so a change in the count is all that can invalidate the index.
+    if (!pRegionIndex || numIndexed != Num()) IndexRegions();
+
+    if (n < 0 || n >= pRegionIndex->size) return 0;
+    return pRegionIndex->GetRegion(n);
+}
+
+void ARegionList::IndexRegions()
+{
+    int size = 0;
     forlist(this) {
-        if (((ARegion *) elem)->num == n) return ((ARegion *) elem);
+        ARegion *reg = (ARegion *) elem;
+        if (reg->num >= size) size = reg->num + 1;
     }
-    return 0;
+
+    if (pRegionIndex) delete pRegionIndex;
+    pRegionIndex = new ARegionFlatArray(size);
+    forlist_reuse(this) {
+        ARegion *reg = (ARegion *) elem;
+        if (reg->num >= 0) pRegionIndex->SetRegion(reg->num, reg);
+    }
+    numIndexed = Num();
 }
 
 ARegion *ARegionList::GetRegion(int x, int y, int z)
@@ -2105,23 +2436,14 @@ ARegion *ARegionList::GetRegion(int x, int y, int z)
 
 Location *ARegionList::FindUnit(int i)
 {
-    forlist(this) {
-        ARegion *reg = (ARegion *) elem;
-        forlist((&reg->objects)) {
-            Object *obj = (Object *) elem;
-            forlist((&obj->units)) {
-                Unit *u = (Unit *) elem;
-                if (u->num == i) {
-                    Location *retval = new Location;
-                    retval->unit = u;
-                    retval->region = reg;
-                    retval->obj = obj;
-                    return retval;
-                }
-            }
-        }
-    }
-    return 0;
+    Unit *u = AllUnits.GetUnit(i);
+    if (!u || !u->object || !u->object->region) return 0;
+
+    Location *retval = new Location;
+    retval->unit = u;
+    retval->region = u->object->region;
+    retval->obj = u->object;
+    return retval;
 }
 
 void ARegionList::NeighSetup(ARegion *r, ARegionArray *ar)
@@ -2562,23 +2884,51 @@ int ARegionList::GetPlanarDistance(ARegion *one, ARegion *two,
             return 10000000;
         }
 
-        forlist(this) {
-            ARegion *r = (ARegion *) elem;
-            r->distance = -1;
-            r->next = 0;
-        }
-        
         zdist = (one->zloc - two->zloc);
         if (zdist < 0) zdist = -zdist;
-        start->distance = zdist * penalty;
+        int base = zdist * penalty;
+        if (maxdist != -1 && base > maxdist) return base;
+
+        // The surface doesn't change during a turn, so answer from an
+        // earlier search if one got far enough
+        pair<int, int> key(start->num, target->num);
+        map< pair<int, int>, int >::iterator known = planarDistances.find(key);
+        if (known != planarDistances.end()) {
+            int found = known->second;
+            if (found >= 0) {
+                if (maxdist == -1 || base + found <= maxdist)
+                    return base + found;
+                return maxdist + 1;
+            }
+            if (maxdist != -1 && maxdist - base <= -1 - found)
+                return maxdist + 1;
+        }
+
+        // Only regions stamped with this search count as visited, so
+        // nothing needs resetting beforehand and the search touches
+        // no more hexes than it reaches
+        planarSearch++;
+        start->distancesearch = planarSearch;
+        start->distance = base;
+        start->next = 0;
         queue = start;
         while (maxdist == -1 || start->distance <= maxdist) {
-            if (start->xloc == two_x && start->yloc == two_y) {
+            if (start == target) {
                 // found our target within range
+                planarDistances[key] = start->distance - base;
                 return start->distance;
             }
             // add neighbours to the search list
-            queue = FindConnectedRegions(start, queue, 0);
+            for (int i = 0; i < NDIRS; i++) {
+                ARegion *r = start->neighbors[i];
+                if (r && r->distancesearch != planarSearch) {
+                    r->distancesearch = planarSearch;
+                    r->distance = start->distance + 1;
+                    r->next = 0;
+                    queue->next = r;
+                    queue = r;
+                }
+            }
             start = start->next;
             if (start == 0)
             {
@@ -2594,6 +2944,7 @@ int ARegionList::GetPlanarDistance(ARegion *one, ARegion *two,
                 return 10000000;
             }
         }
+        planarDistances[key] = -1 - (maxdist - base);
         // didn't find the target within range
         return start->distance;
     } else {
@@ -2679,11 +3030,14 @@ ARegionFlatArray::ARegionFlatArray(int s)
 {
     size = s;
     regions = new ARegion *[s];
+
+    int i;
+    for (i = 0; i < s; i++) regions[i] = 0;
 }
 
 ARegionFlatArray::~ARegionFlatArray()
 {
-    if (regions) delete regions;
+    if (regions) delete [] regions;
 }
 
 void ARegionFlatArray::SetRegion(int x, ARegion *r) {
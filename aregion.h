@@ -33,6 +33,7 @@
 class ARegion;
 class ARegionList;
 class ARegionArray;
+class ThreadPool;
 
 #include "gamedefs.h"
 #include "gameio.h"
@@ -131,6 +132,33 @@ class Farsight : public AListElem
 
 Farsight *GetFarsight(AList *, Faction *);
 
+// The best observation and true sight among one faction's units in a
+// region, and whether any of them can read minds.  The units themselves
+// are sightunits[first] .. sightunits[first + count - 1] of the region.
+class FactionSight
+{
+    public:
+        int factionnum;
+        int observation;
+        int truesight;
+        int detfac;
+        int first;
+        int count;
+};
+
+// A unit counted in a region's sight summary, along with the item and
+// skill versions and state its figures were taken under.
+class SightUnit
+{
+    public:
+        Unit *unit;
+        int items;
+        int skills;
+        int flags;
+        int guard;
+        int type;
+};
+
 enum {
     TOWN_VILLAGE,
     TOWN_TOWN,
@@ -204,6 +232,9 @@ class ARegion : public AListElem
         AList *PresentFactions();
         int GetObservation(Faction *, int);
         int GetTrueSight(Faction *, int);
+        FactionSight *GetSight(Faction *);
+        void InvalidateSight();
+        void UpdateSight();
 
         Object *GetObject(int);
         Object *GetDummy();
@@ -333,10 +364,21 @@ class ARegion : public AListElem
         MarketList markets;
         int xloc, yloc, zloc;
         int visited;
+        // Battles fought here this turn, numbering their random streams
+        int battlecount;
 
         // Used for calculating distances using an A* search
         int distance;
         ARegion *next;
+        // Which GetPlanarDistance search distance and next belong to
+        int distancesearch;
+
+        // Per-faction sight summary, rebuilt by GetSight after units
+        // enter, leave or change faction
+        FactionSight *sightfacs;
+        int numsightfacs;
+        SightUnit *sightunits;
+        int sightvalid;
 
         // Editing functions
         void UpdateEditRegion();
@@ -356,6 +398,8 @@ class ARegion : public AListElem
         void AddTown(int, AString *);
         void MakeLair(int);
         void LairCheck();
+        void BuildSight();
+        void RefreshSight(FactionSight *);
 
 };
 
@@ -430,8 +474,10 @@ class ARegionList : public AList
 
         ARegion *GetRegion(int);
         ARegion *GetRegion(int, int, int);
-        int ReadRegions(Ainfile *f, AList *, ATL_VER v);
-        void WriteRegions(Aoutfile *f);
+        // With a thread pool, regions are read and written several at
+        // a time.
+        int ReadRegions(Ainfile *f, AList *, ATL_VER v, ThreadPool * = 0);
+        void WriteRegions(Aoutfile *f, ThreadPool * = 0);
         Location *FindUnit(int);
         Location *GetUnitId(UnitId *id, int faction, ARegion *cur);
 
@@ -449,6 +495,16 @@ class ARegionList : public AList
         int numLevels;
         ARegionArray **pRegionArrays;
 
+        // Region number -> region lookup, kept in step with the list
+        ARegionFlatArray *pRegionIndex;
+        int numIndexed;
+
+        // Surface distances found by GetPlanarDistance, keyed on the
+        // start and target region numbers.  A negative entry -1 - n
+        // means the target is known to be more than n hexes away.
+        map< pair<int, int>, int > planarDistances;
+        int planarSearch;
+
     public:
         //
         // Public world creation stuff
@@ -488,6 +544,14 @@ class ARegionList : public AList
         int GetLevelYScale(int level);
 
     private:
+        void IndexRegions();
+
+        void WriteRegionBlocks(Aoutfile *f, ThreadPool *pool);
+        int ReadRegionBlocks(Ainfile *f, AList *, ATL_VER v, int num,
+                ThreadPool *pool);
+        static void WriteRegionJob(int, void *);
+        static void ReadRegionJob(int, void *);
+
         //
         // Private world creation stuff
         //
@@ -523,6 +587,7 @@ class ARegionList : public AList
 };
 
 int LookupRegionType(AString *);
+int LookupRegionType(char const *);
 int ParseTerrain(AString *);
 
 #endif
@@ -26,38 +26,50 @@
 #include "gameio.h"
 #include "gamedata.h"
 
+#include <math.h>
+
 enum {
     WIN_NO_DEAD,
     WIN_DEAD,
     LOSS
 };
 
-Soldier::Soldier(Unit * u,Object * o,int regtype,int r,int ass)
+// Army::Army copies the first soldier set up for each race of a unit to
+// the rest (see SetupModel); anything new that Setup takes from or does
+// to the unit must be known there too.  Build with -DCHECK_SETUP_MODEL
+// to have every copy checked against a real Setup.
+void Soldier::Setup(SoldierInfo *si,Object * o,int regtype,int r,int ass)
 {
     AString abbr;
     int i, item, armorType;
+    Unit *unit = si->unit;
 
+    info = si;
     race = r;
-    unit = u;
     building = 0;
 
-    healing = 0;
-    healtype = 0;
-    healitem = -1;
-    canbehealed = 1;
-    regen = 0;
+    info->healing = 0;
+    info->healtype = 0;
+    info->healitem = -1;
+    info->canbehealed = 1;
+    info->regen = 0;
 
     armor = -1;
+    armortype = NULL;
     riding = -1;
     weapon = -1;
 
     attacks = 1;
     attacktype = ATTACK_COMBAT;
+    weaponflags = 0;
+    weaponclass = SLASHING;
+    mountbonus = 0;
 
     special = NULL;
     slevel = 0;
 
     askill = 0;
+    effects = 0;
 
     dskill[ATTACK_COMBAT] = 0;
     dskill[ATTACK_ENERGY] = -2;
@@ -68,19 +80,18 @@ Soldier::Soldier(Unit * u,Object * o,int regtype,int r,int ass)
     for (int i=0; i<NUM_ATTACK_TYPES; i++)
         protection[i] = 0;
     damage = 0;
-    hits = unit->GetAttribute("toughness");
+    hits = unit->GetAttribute(AT_TOUGHNESS);
     if (hits < 1) hits = 1;
     maxhits = hits;
     amuletofi = 0;
-    battleItems = 0;
+    info->battleItems = 0;
 
     /* Special case to allow protection from ships */
     if (o->IsFleet() && o->capacity < 1 && o->shipno < o->ships.Num()) {
         int objectno;
 
         i = 0;
-        forlist(&o->ships) {
-            Item *ship = (Item *) elem;
+        forlist_items(&o->ships, ship) {
             if (o->shipno == i) {
                 abbr = ItemDefs[ship->type].name;
                 objectno = LookupObject(&abbr);
@@ -115,10 +126,6 @@ Soldier::Soldier(Unit * u,Object * o,int regtype,int r,int ass)
     if (ItemDefs[r].type & IT_MONSTER) {
         MonType *mp = FindMonster(ItemDefs[r].abr,
                 (ItemDefs[r].type & IT_ILLUSION));
-        if (u->type == U_WMON)
-            name = AString(mp->name) + " in " + *(unit->name);
-        else
-            name = AString(mp->name) + " controlled by " + *(unit->name);
         askill = mp->attackLevel;
         dskill[ATTACK_COMBAT] += mp->defense[ATTACK_COMBAT];
         if (mp->defense[ATTACK_ENERGY] > dskill[ATTACK_ENERGY]) {
@@ -141,14 +148,12 @@ Soldier::Soldier(Unit * u,Object * o,int regtype,int r,int ass)
         special = mp->special;
         slevel = mp->specialLevel;
         if (Globals->MONSTER_BATTLE_REGEN) {
-            regen = mp->regen;
-            if (regen < 0) regen = 0;
+            info->regen = mp->regen;
+            if (info->regen < 0) info->regen = 0;
         }
         return;
     }
 
-    name = *(unit->name);
-
     SetupHealing();
 
     SetupSpell();
@@ -176,6 +181,7 @@ Soldier::Soldier(Unit * u,Object * o,int regtype,int r,int ass)
             }
         }
     }
+    if (armor > 0) armortype = FindArmor(ItemDefs[armor].abr);
 
     //
     // Check if this unit is mounted
@@ -235,10 +241,16 @@ Soldier::Soldier(Unit * u,Object * o,int regtype,int r,int ass)
     // If we did not get a weapon, set attack and defense bonuses to
     // combat skill (and riding bonus if applicable).
     if (weapon == -1) {
-        attackBonus = unit->GetAttribute("combat") + ridingBonus;
+        attackBonus = unit->GetAttribute(AT_COMBAT) + ridingBonus;
         defenseBonus = attackBonus;
         numAttacks = 1;
     } else {
+        WeaponType *pWep = FindWeapon(ItemDefs[weapon].abr);
+        attacktype = pWep->attackType;
+        weaponflags = pWep->flags;
+        weaponclass = pWep->weapClass;
+        mountbonus = pWep->mountBonus;
+
         // Okay.  We got a weapon.  If this weapon also has a special
         // and we don't have a special set, use that special.
         // Weapons (like Runeswords) which are both weapons and battle
@@ -251,7 +263,7 @@ Soldier::Soldier(Unit * u,Object * o,int regtype,int r,int ass)
         }
     }
 
-    unit->PracticeAttribute("combat");
+    unit->PracticeAttribute(AT_COMBAT);
 
     // Set the attack and defense skills
     // These will include the riding bonus if they should be included.
@@ -260,8 +272,24 @@ Soldier::Soldier(Unit * u,Object * o,int regtype,int r,int ass)
     attacks = numAttacks;
 }
 
+AString Soldier::Name()
+{
+    Unit *unit = info->unit;
+
+    if (ItemDefs[race].type & IT_MONSTER) {
+        MonType *mp = FindMonster(ItemDefs[race].abr,
+                (ItemDefs[race].type & IT_ILLUSION));
+        if (unit->type == U_WMON)
+            return AString(mp->name) + " in " + *(unit->name);
+        return AString(mp->name) + " controlled by " + *(unit->name);
+    }
+    return *(unit->name);
+}
+
 void Soldier::SetupSpell()
 {
+    Unit *unit = info->unit;
+
     if (unit->type != U_MAGE && unit->type != U_GUARDMAGE) return;
 
     if (unit->combat != -1) {
@@ -292,12 +320,12 @@ void Soldier::SetupCombatItems()
 {
     int battleType;
     int exclusive = 0;
+    Unit *unit = info->unit;
 
     for (battleType = 1; battleType < NUMBATTLEITEMS; battleType++) {
         BattleItemType *pBat = &BattleItemDefs[battleType];
 
-        AString abbr = pBat->abbr;
-        int item = unit->GetBattleItem(abbr);
+        int item = unit->GetBattleItem(pBat->item);
         if (item == -1) continue;
 
         // If we are using the ready command, skip this item unless
@@ -342,7 +370,7 @@ void Soldier::SetupCombatItems()
                 amuletofi = 1;
             }
 
-            SET_BIT(battleItems, battleType);
+            SET_BIT(info->battleItems, battleType);
 
             if (pBat->flags & BattleItemType::SPECIAL) {
                 special = pBat->special;
@@ -373,20 +401,19 @@ void Soldier::SetupCombatItems()
     }
 }
 
-int Soldier::HasEffect(char const *eff)
+int Soldier::HasEffect(int eff)
 {
-    if (eff == NULL) return 0;
+    if (eff == -1) return 0;
 
-    return effects[eff];
+    return (effects >> eff) & 1;
 }
 
-void Soldier::SetEffect(char const *eff)
+void Soldier::SetEffect(int eff)
 {
-    if (eff == NULL) return;
+    if (eff == -1) return;
     int i;
 
-    EffectType *e = FindEffect(eff);
-    if (e == NULL) return;
+    EffectType *e = &EffectDefs[eff];
 
     askill += e->attackVal;
 
@@ -395,18 +422,17 @@ void Soldier::SetEffect(char const *eff)
             dskill[e->defMods[i].type] += e->defMods[i].val;
     }
 
-    if (e->cancelEffect != NULL) ClearEffect(e->cancelEffect);
+    if (e->cancelnum != -1) ClearEffect(e->cancelnum);
 
-    if (!(e->flags & EffectType::EFF_NOSET)) effects[eff] = 1;
+    if (!(e->flags & EffectType::EFF_NOSET)) effects |= 1u << eff;
 }
 
-void Soldier::ClearEffect(char const *eff)
+void Soldier::ClearEffect(int eff)
 {
-    if (eff == NULL) return;
+    if (eff == -1) return;
     int i;
 
-    EffectType *e = FindEffect(eff);
-    if (e == NULL) return;
+    EffectType *e = &EffectDefs[eff];
 
     askill -= e->attackVal;
 
@@ -415,16 +441,21 @@ void Soldier::ClearEffect(char const *eff)
             dskill[e->defMods[i].type] -= e->defMods[i].val;
     }
 
-    effects[eff] = 0;
+    effects &= ~(1u << eff);
 }
 
-void Soldier::ClearOneTimeEffects(void)
+int Soldier::ClearOneTimeEffects(void)
 {
+    int cleared = 0;
+
+    if (!effects) return 0;
     for (int i = 0; i < NUMEFFECTS; i++) {
-        if (HasEffect(EffectDefs[i].name) &&
-                (EffectDefs[i].flags & EffectType::EFF_ONESHOT))
-            ClearEffect(EffectDefs[i].name);
+        if (HasEffect(i) && (EffectDefs[i].flags & EffectType::EFF_ONESHOT)) {
+            ClearEffect(i);
+            cleared++;
+        }
     }
+    return cleared;
 }
 
 int Soldier::ArmorProtect(int weaponClass)
@@ -432,8 +463,7 @@ int Soldier::ArmorProtect(int weaponClass)
     //
     // Return 1 if the armor is successful
     //
-    ArmorType *pArm = NULL;
-    if (armor > 0) pArm = FindArmor(ItemDefs[armor].abr);
+    ArmorType *pArm = armortype;
     if (pArm == NULL) return 0;
     int chance = pArm->saves[weaponClass];
 
@@ -445,6 +475,10 @@ int Soldier::ArmorProtect(int weaponClass)
 
 void Soldier::RestoreItems()
 {
+    Unit *unit = info->unit;
+    int healing = info->healing;
+    int healitem = info->healitem;
+
     if (healing && healitem != -1) {
         if (healitem == I_HERBS) {
             unit->items.SetNum(healitem,
@@ -465,9 +499,8 @@ void Soldier::RestoreItems()
     for (battleType = 1; battleType < NUMBATTLEITEMS; battleType++) {
         BattleItemType *pBat = &BattleItemDefs[ battleType ];
 
-        if (GET_BIT(battleItems, battleType)) {
-            AString itm(pBat->abbr);
-            int item = LookupItem(&itm);
+        if (GET_BIT(info->battleItems, battleType)) {
+            int item = pBat->item;
             unit->items.SetNum(item, unit->items.GetNum(item) + 1);
         }
     }
@@ -475,6 +508,8 @@ void Soldier::RestoreItems()
 
 void Soldier::Alive(int state)
 {
+    Unit *unit = info->unit;
+
     RestoreItems();
 
     if (state == LOSS) {
@@ -499,9 +534,213 @@ void Soldier::Dead()
 {
     RestoreItems();
 
-    unit->SetMen(race,unit->GetMen(race) - 1);
+    info->unit->SetMen(race,info->unit->GetMen(race) - 1);
 }
 
+TargetSet::TargetSet(SpecialType *sp, int n)
+{
+    special = sp;
+    size = n;
+    for (top = 1; top * 2 <= size; top *= 2)
+        ;
+    tree = new int[size + 1];
+    valid = new char[size];
+    for (int i = 0; i <= size; i++) tree[i] = 0;
+    for (int i = 0; i < size; i++) valid[i] = 0;
+}
+
+TargetSet::~TargetSet()
+{
+    delete [] tree;
+    delete [] valid;
+}
+
+void TargetSet::Set(int place, int v)
+{
+    if (valid[place] == v) return;
+    valid[place] = v;
+    int diff = v ? 1 : -1;
+    for (int i = place + 1; i <= size; i += i & -i)
+        tree[i] += diff;
+}
+
+int TargetSet::Before(int place)
+{
+    int n = 0;
+    for (int i = place; i > 0; i -= i & -i)
+        n += tree[i];
+    return n;
+}
+
+int TargetSet::Find(int n)
+{
+    int place = 0;
+    for (int step = top; step; step >>= 1) {
+        if (place + step <= size && tree[place + step] <= n) {
+            place += step;
+            n -= tree[place];
+        }
+    }
+    return place;
+}
+
+// Whether having fewer of an item could change what Soldier::Setup gives
+// the unit's other soldiers, through an attribute or a granted skill
+static int ItemChangesUnit(int item)
+{
+    if (ItemDefs[item].grantSkill &&
+            LookupSkill(ItemDefs[item].grantSkill) != -1)
+        return 1;
+    for (int a = 0; a < NUMATTRIBMODS; a++) {
+        for (int i = 0; i < 5; i++) {
+            AttribModItem *mod = &AttribDefs[a].mods[i];
+            if ((mod->flags & AttribModItem::ITEM) &&
+                    LookupItem(mod->ident) == item)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+#define MAX_TAKEN (4 + (int) sizeof(BITFIELD) * 8)
+
+//
+// A soldier just set up, and the items Setup took from its unit for it.
+// While the unit has enough of those left, and the object's protection
+// holds out the same way, Setup would give the unit's next soldier of
+// the same race exactly the same, so it is copied instead; Setup is
+// most of the cost of raising a large army.
+//
+class SetupModel {
+    public:
+        SetupModel() { model = 0; }
+
+        // Takes s as the model, unless its Setup practised a skill or
+        // dropped the unit's combat spell, which could change the next
+        void Start(Soldier *s, int skills, int combat);
+        int Fits(Object *o);
+        void Copy(Soldier *s, SoldierInfo *si, Object *o);
+#ifdef CHECK_SETUP_MODEL
+        void Check(Army *army, Soldier *s, SoldierInfo *si, Object *o,
+                int regtype, int race);
+#endif
+
+        Soldier *model;
+
+    private:
+        void Take(int item, int num);
+
+        int items[MAX_TAKEN];
+        int nums[MAX_TAKEN];
+        int count;
+};
+
+void SetupModel::Take(int item, int num)
+{
+    if (item < 0 || num < 1) return;
+    for (int i = 0; i < count; i++) {
+        if (items[i] == item) {
+            nums[i] += num;
+            return;
+        }
+    }
+    items[count] = item;
+    nums[count++] = num;
+}
+
+void SetupModel::Start(Soldier *s, int skills, int combat)
+{
+    Unit *u = s->info->unit;
+    SoldierInfo *si = s->info;
+
+    model = 0;
+    if (u->skills.version != skills || u->combat != combat) return;
+
+    // What Soldier::RestoreItems gives back
+    count = 0;
+    Take(s->weapon, 1);
+    Take(s->armor, 1);
+    Take(s->riding, 1);
+    if (si->healitem == I_HERBS) Take(I_HERBS, si->healing);
+    else if (si->healitem == I_HEALPOTION) Take(I_HEALPOTION, 1);
+    for (int bt = 1; bt < NUMBATTLEITEMS; bt++) {
+        if (GET_BIT(si->battleItems, bt))
+            Take(BattleItemDefs[bt].item, 1);
+    }
+    for (int i = 0; i < count; i++) {
+        if (ItemChangesUnit(items[i])) return;
+    }
+    model = s;
+}
+
+int SetupModel::Fits(Object *o)
+{
+    if (!model) return 0;
+    Unit *u = model->info->unit;
+
+    // Setup would turn a ship into protection, or protection runs out
+    if (o->IsFleet() && o->capacity < 1 && o->shipno < o->ships.Num())
+        return 0;
+    if ((o->capacity != 0) != (model->building != 0)) return 0;
+    for (int i = 0; i < count; i++) {
+        if (u->items.GetNum(items[i]) < nums[i]) return 0;
+    }
+    return 1;
+}
+
+void SetupModel::Copy(Soldier *s, SoldierInfo *si, Object *o)
+{
+    Unit *u = model->info->unit;
+    SoldierInfo *mi = model->info;
+
+    *s = *model;
+    s->info = si;
+    si->healing = mi->healing;
+    si->healtype = mi->healtype;
+    si->healitem = mi->healitem;
+    si->canbehealed = mi->canbehealed;
+    si->regen = mi->regen;
+    si->battleItems = mi->battleItems;
+    for (int i = 0; i < count; i++)
+        u->items.SetNum(items[i], u->items.GetNum(items[i]) - nums[i]);
+    if (s->building) o->capacity--;
+}
+
+#ifdef CHECK_SETUP_MODEL
+// Sets s up with a real Setup, and reports it if Copy would have given
+// a different soldier or taken something different from the unit
+void SetupModel::Check(Army *army, Soldier *s, SoldierInfo *si, Object *o,
+        int regtype, int race)
+{
+    Unit *u = model->info->unit;
+    SoldierInfo *mi = model->info;
+
+    int *expect = new int[NITEMS];
+    for (int i = 0; i < NITEMS; i++) expect[i] = u->items.GetNum(i);
+    for (int i = 0; i < count; i++) expect[items[i]] -= nums[i];
+    int capacity = o->capacity - (model->building ? 1 : 0);
+    int skills = u->skills.version;
+    int combat = u->combat;
+
+    s->Setup(si, o, regtype, race);
+
+    int same = army->SameProfile(s, model) && s->slevel == model->slevel &&
+        s->damage == model->damage && si->healing == mi->healing &&
+        si->healtype == mi->healtype && si->healitem == mi->healitem &&
+        si->canbehealed == mi->canbehealed && si->regen == mi->regen &&
+        si->battleItems == mi->battleItems && o->capacity == capacity &&
+        u->skills.version == skills && u->combat == combat;
+    for (int i = 0; i < NITEMS; i++) {
+        if (u->items.GetNum(i) != expect[i]) same = 0;
+    }
+    if (!same) {
+        Awrite(AString("Copied soldier of unit ") + u->num +
+                " differs from Setup");
+    }
+    delete [] expect;
+}
+#endif
+
 Army::Army(Unit * ldr,AList * locs,int regtype,int ass)
 {
     int tacspell = 0;
@@ -509,9 +748,14 @@ Army::Army(Unit * ldr,AList * locs,int regtype,int ass)
 
     leader = ldr;
     round = 0;
-    tac = ldr->GetAttribute("tactics");
+    tac = ldr->GetAttribute(AT_TACTICS);
     count = 0;
     hitstotal = 0;
+    groups = 0;
+    numgroups = 0;
+    loners = 0;
+    actors = 0;
+    numactors = 0;
 
     if (ass) {
         count = 1;
@@ -521,7 +765,7 @@ Army::Army(Unit * ldr,AList * locs,int regtype,int ass)
             Unit * u = ((Location *) elem)->unit;
             count += u->GetSoldiers();
             u->losses = 0;
-            int temp = u->GetAttribute("tactics");
+            int temp = u->GetAttribute(AT_TACTICS);
             if (temp > tac) {
                 tac = temp;
                 tactician = u;
@@ -534,52 +778,66 @@ Army::Army(Unit * ldr,AList * locs,int regtype,int ass)
     if (Globals->TACTICS_NEEDS_WAR && (tactician->skills.Num() != 0)) {
         int currskill = tactician->skills.GetDays(S_TACTICS)/tactician->GetMen();
         if (currskill < 450 - Globals->SKILL_PRACTICE_AMOUNT) {
-            tactician->PracticeAttribute("tactics");
+            tactician->PracticeAttribute(AT_TACTICS);
         }
     } else { // Only Globals->TACTICS_NEEDS_WAR == 0
-        tactician->PracticeAttribute("tactics");
+        tactician->PracticeAttribute(AT_TACTICS);
     }
-    soldiers = new SoldierPtr[count];
+    soldiers = new Soldier[count];
+    info = new SoldierInfo[count];
     int x = 0;
     int y = count;
+    int n = 0;
 
     forlist(locs) {
         Unit * u = ((Location *) elem)->unit;
         Object * obj = ((Location *) elem)->obj;
         if (ass) {
-            forlist(&u->items) {
-                Item * it = (Item *) elem;
+            forlist_items(&u->items, it) {
                 if (it) {
                     if (ItemDefs[ it->type ].type & IT_MAN) {
-                            soldiers[x] = new Soldier(u, obj, regtype,
+                            info[n].unit = u;
+                            info[n].place = x;
+                            soldiers[x].Setup(&info[n++], obj, regtype,
                                     it->type, ass);
-                            hitstotal = soldiers[x]->hits;
+                            hitstotal = soldiers[x].hits;
                             ++x;
                             goto finished_army;
                     }
                 }
             }
         } else {
-            Item *it = (Item *) u->items.First();
-            do {
+            forlist_items(&u->items, it) {
                 if (IsSoldier(it->type)) {
+                    SetupModel model;
                     for (int i = 0; i < it->num; i++) {
+                        int pos;
                         if ((ItemDefs[ it->type ].type & IT_MAN) &&
                                 u->GetFlag(FLAG_BEHIND)) {
-                            --y;
-                            soldiers[y] = new Soldier(u, obj, regtype,
-                                    it->type);
-                            hitstotal += soldiers[y]->hits;
+                            pos = --y;
                         } else {
-                            soldiers[x] = new Soldier(u, obj, regtype,
+                            pos = x++;
+                        }
+                        info[n].unit = u;
+                        info[n].place = pos;
+                        if (model.Fits(obj)) {
+#ifdef CHECK_SETUP_MODEL
+                            model.Check(this, &soldiers[pos], &info[n++],
+                                    obj, regtype, it->type);
+#else
+                            model.Copy(&soldiers[pos], &info[n++], obj);
+#endif
+                        } else {
+                            int skills = u->skills.version;
+                            int combat = u->combat;
+                            soldiers[pos].Setup(&info[n++], obj, regtype,
                                     it->type);
-                            hitstotal += soldiers[x]->hits;
-                            ++x;
+                            model.Start(&soldiers[pos], skills, combat);
                         }
+                        hitstotal += soldiers[pos].hits;
                     }
                 }
-                it = (Item *) u->items.Next(it);
-            } while(it);
+            }
         }
     }
 
@@ -597,11 +855,17 @@ finished_army:
         canfront = canbehind;
         notfront = notbehind;
     }
+
+    if (Globals->GROUPED_COMBAT > 0 && !ass) SetupGroups();
 }
 
 Army::~Army()
 {
     delete [] soldiers;
+    delete [] info;
+    delete [] groups;
+    delete loners;
+    delete [] actors;
 }
 
 void Army::Reset() {
@@ -616,9 +880,9 @@ void Army::WriteLosses(Battle * b) {
     if (notbehind != count) {
         AList units;
         for (int i=notbehind; i<count; i++) {
-            if (!GetUnitList(&units,soldiers[i]->unit)) {
+            if (!GetUnitList(&units,soldiers[i].info->unit)) {
                 UnitPtr *u = new UnitPtr;
-                u->ptr = soldiers[i]->unit;
+                u->ptr = soldiers[i].info->unit;
                 units.Add(u);
             }
         }
@@ -705,11 +969,11 @@ void Army::GetMonSpoils(ItemList *spoils,int monitem, int free)
 void Army::Regenerate(Battle *b)
 {
     for (int i = 0; i < count; i++) {
-        Soldier *s = soldiers[i];
+        Soldier *s = &soldiers[i];
         if (i<notbehind) {
             int diff = s->maxhits - s->hits;
             if (diff > 0) {
-                AString aName = s->name;
+                AString aName = s->Name();
 
                 if (s->damage != 0) {
                     b->AddLine(aName + " takes " + s->damage +
@@ -720,8 +984,8 @@ void Army::Regenerate(Battle *b)
                     b->AddLine(aName + " takes no hits leaving it at " +
                             s->hits + "/" + s->maxhits + ".");
                 }
-                if (s->regen) {
-                    int regen = s->regen;
+                if (s->info->regen) {
+                    int regen = s->info->regen;
                     if (regen > diff) regen = diff;
                     s->hits += regen;
                     b->AddLine(aName + " regenerates " + regen +
@@ -737,15 +1001,15 @@ void Army::Lose(Battle *b,ItemList *spoils)
 {
     WriteLosses(b);
     for (int i=0; i<count; i++) {
-        Soldier * s = soldiers[i];
+        Soldier * s = &soldiers[i];
+        Unit * u = s->info->unit;
         if (i<notbehind) {
             s->Alive(LOSS);
         } else {
-            if ((s->unit->type==U_WMON) && (ItemDefs[s->race].type&IT_MONSTER))
-                GetMonSpoils(spoils,s->race,s->unit->free);
+            if ((u->type==U_WMON) && (ItemDefs[s->race].type&IT_MONSTER))
+                GetMonSpoils(spoils,s->race,u->free);
             s->Dead();
         }
-        delete s;
     }
 }
 
@@ -753,21 +1017,19 @@ void Army::Tie(Battle * b)
 {
     WriteLosses(b);
     for (int x=0; x<count; x++) {
-        Soldier * s = soldiers[x];
+        Soldier * s = &soldiers[x];
         if (x<NumAlive()) {
             s->Alive(WIN_DEAD);
         } else {
             s->Dead();
         }
-        delete s;
     }
 }
 
 int Army::CanBeHealed()
 {
     for (int i=notbehind; i<count; i++) {
-        Soldier * temp = soldiers[i];
-        if (temp->canbehealed) return 1;
+        if (soldiers[i].info->canbehealed) return 1;
     }
     return 0;
 }
@@ -786,7 +1048,7 @@ void Army::DoHealLevel(Battle *b, int type, int useItems)
     int rate = HealDefs[type].rate;
 
     for (int i=0; i<NumAlive(); i++) {
-        Soldier * s = soldiers[i];
+        SoldierInfo * s = soldiers[i].info;
         int n = 0;
         if (!CanBeHealed()) break;
         if (s->healtype <= 0) continue;
@@ -804,13 +1066,12 @@ void Army::DoHealLevel(Battle *b, int type, int useItems)
         while (s->healing) {
             if (!CanBeHealed()) break;
             int j = getrandom(count - NumAlive()) + notbehind;
-            Soldier * temp = soldiers[j];
+            SoldierInfo * temp = soldiers[j].info;
             if (temp->canbehealed) {
                 s->healing--;
                 if (getrandom(100) < rate) {
                     n++;
-                    soldiers[j] = soldiers[notbehind];
-                    soldiers[notbehind] = temp;
+                    Swap(j, notbehind);
                     notbehind++;
                 } else
                     temp->canbehealed = 0;
@@ -836,13 +1097,12 @@ void Army::Win(Battle * b,ItemList * spoils)
     AList units;
 
     for (int x = 0; x < count; x++) {
-        Soldier * s = soldiers[x];
+        Soldier * s = &soldiers[x];
         if (x<NumAlive()) s->Alive(wintype);
         else s->Dead();
     }
 
-    forlist(spoils) {
-        Item *i = (Item *) elem;
+    forlist_items(spoils, i) {
         if (i && na) {
             Unit *u;
             UnitPtr *up;
@@ -852,7 +1112,7 @@ void Army::Win(Battle * b,ItemList * spoils)
                 units.DeleteAll();
                 // Make a list of units who can get this type of spoil
                 for (int x = 0; x < na; x++) {
-                    u = soldiers[x]->unit;
+                    u = soldiers[x].info->unit;
                     if (u->CanGetSpoil(i)) {
                         up = new UnitPtr;
                         up->ptr = u;
@@ -910,11 +1170,6 @@ void Army::Win(Battle * b,ItemList * spoils)
             } while (ns > 0 && i->num > 0);
         }
     }
-
-    for (int x = 0; x < count; x++) {
-        Soldier * s = soldiers[x];
-        delete s;
-    }
 }
 
 int Army::Broken()
@@ -932,7 +1187,7 @@ int Army::NumSpoilers()
     int na = NumAlive();
     int count = 0;
     for (int x=0; x<na; x++) {
-        Unit * u = soldiers[x]->unit;
+        Unit * u = soldiers[x].info->unit;
         if (!(u->flags & FLAG_NOSPOILS)) count++;
     }
     return count;
@@ -953,25 +1208,44 @@ int Army::NumFront()
     return (canfront + notfront - canbehind);
 }
 
+void Army::Swap(int i, int j)
+{
+    if (i == j) return;
+    Soldier temp = soldiers[i];
+    soldiers[i] = soldiers[j];
+    soldiers[j] = temp;
+    if (groups) {
+        soldiers[i].info->place = i;
+        soldiers[j].info->place = j;
+    }
+
+    forlist(&targetsets) {
+        TargetSet *ts = (TargetSet *) elem;
+        int v = ts->Get(i);
+        if (v != ts->Get(j)) {
+            ts->Set(i, ts->Get(j));
+            ts->Set(j, v);
+        }
+    }
+}
+
 Soldier * Army::GetAttacker(int i,int &behind)
 {
-    Soldier * retval = soldiers[i];
     if (i<canfront) {
-        soldiers[i] = soldiers[canfront-1];
-        soldiers[canfront-1] = soldiers[canbehind-1];
-        soldiers[canbehind-1] = retval;
+        // Rotate i -> canbehind-1 -> canfront-1 -> i
+        Swap(i, canfront-1);
+        Swap(canfront-1, canbehind-1);
         canfront--;
         canbehind--;
         behind = 0;
-        return retval;
+        return &soldiers[canbehind];
     }
-    soldiers[i] = soldiers[canbehind-1];
-    soldiers[canbehind-1] = soldiers[notfront-1];
-    soldiers[notfront-1] = retval;
+    Swap(i, canbehind-1);
+    Swap(canbehind-1, notfront-1);
     canbehind--;
     notfront--;
     behind = 1;
-    return retval;
+    return &soldiers[notfront];
 }
 
 int Army::GetTargetNum(char const *special)
@@ -987,31 +1261,15 @@ int Army::GetTargetNum(char const *special)
     SpecialType *sp = FindSpecial(special);
 
     if (sp && sp->targflags) {
-        int validtargs = 0;
-        int i, start = -1;
-
-        for (i = 0; i < canfront; i++) {
-            if (CheckSpecialTarget(special, i)) {
-                validtargs++;
-                // slight scan optimisation - skip empty initial sequences
-                if (start == -1) start = i;
-            }
-        }
-        for (i = canbehind; i < notfront; i++) {
-            if (CheckSpecialTarget(special, i)) {
-                validtargs++;
-                // slight scan optimisation - skip empty initial sequences
-                if (start == -1) start = i;
-            }
-        }
+        // Pick among the valid targets at the front, in battle order
+        TargetSet *ts = GetTargetSet(sp);
+        int front = ts->Before(canfront);
+        int skipped = ts->Before(canbehind);
+        int validtargs = front + ts->Before(notfront) - skipped;
         if (validtargs) {
             int targ = getrandom(validtargs);
-            for (i = start; i < notfront; i++) {
-                if (i == canfront) i = canbehind;
-                if (CheckSpecialTarget(special, i)) {
-                    if (!targ--) return i;
-                }
-            }
+            if (targ >= front) targ += skipped - front;
+            return ts->Find(targ);
         }
     } else {
         int i = getrandom(tars);
@@ -1022,20 +1280,54 @@ int Army::GetTargetNum(char const *special)
     return -1;
 }
 
-int Army::GetEffectNum(char const *effect)
+TargetSet *Army::GetTargetSet(SpecialType *sp)
+{
+    forlist(&targetsets) {
+        TargetSet *ts = (TargetSet *) elem;
+        if (ts->special == sp) return ts;
+    }
+    TargetSet *ts = new TargetSet(sp, count);
+    for (int i = 0; i < count; i++)
+        ts->Set(i, CheckSpecialTarget(sp, i));
+    targetsets.Add(ts);
+    return ts;
+}
+
+void Army::EffectsChanged(int i)
+{
+    // A grouped soldier that no longer fights like its group has to
+    // fight on its own
+    SoldierInfo *si = soldiers[i].info;
+    if (groups && si->group != -1 &&
+            !SameProfile(&soldiers[i], &groups[si->group].profile)) {
+        int ready = si->slot < groups[si->group].ready;
+        Unlist(si);
+        si->group = -1;
+        Enlist(loners, si - info, ready);
+    }
+
+    forlist(&targetsets) {
+        TargetSet *ts = (TargetSet *) elem;
+        if (ts->special->targflags &
+                (SpecialType::HIT_EFFECTIF | SpecialType::HIT_EFFECTEXCEPT))
+            ts->Set(i, CheckSpecialTarget(ts->special, i));
+    }
+}
+
+int Army::GetEffectNum(int effect)
 {
     int validtargs = 0;
     int i, start = -1;
 
     for (i = 0; i < canfront; i++) {
-        if (soldiers[i]->HasEffect(effect)) {
+        if (soldiers[i].HasEffect(effect)) {
             validtargs++;
             // slight scan optimisation - skip empty initial sequences
             if (start == -1) start = i;
         }
     }
     for (i = canbehind; i < notfront; i++) {
-        if (soldiers[i]->HasEffect(effect)) {
+        if (soldiers[i].HasEffect(effect)) {
             validtargs++;
             // slight scan optimisation - skip empty initial sequences
             if (start == -1) start = i;
@@ -1045,7 +1337,7 @@ int Army::GetEffectNum(char const *effect)
         int targ = getrandom(validtargs);
         for (i = start; i < notfront; i++) {
             if (i == canfront) i = canbehind;
-            if (soldiers[i]->HasEffect(effect)) {
+            if (soldiers[i].HasEffect(effect)) {
                 if (!targ--) return i;
             }
         }
@@ -1055,7 +1347,7 @@ int Army::GetEffectNum(char const *effect)
 
 Soldier * Army::GetTarget(int i)
 {
-    return soldiers[i];
+    return &soldiers[i];
 }
 
 int pow(int b,int p)
@@ -1079,7 +1371,7 @@ int Hits(int a,int d)
     return 0;
 }
 
-int Army::RemoveEffects(int num, char const *effect)
+int Army::RemoveEffects(int num, int effect)
 {
     int ret = 0;
     for (int i = 0; i < num; i++) {
@@ -1094,13 +1386,14 @@ int Army::RemoveEffects(int num, char const *effect)
         // Remove the effect
         //
         tar->ClearEffect(effect);
+        EffectsChanged(tarnum);
         ret++;
     }
     return(ret);
 }
 
 int Army::DoAnAttack(char const *special, int numAttacks, int attackType,
-        int attackLevel, int flags, int weaponClass, char const *effect,
+        int attackLevel, int flags, int weaponClass, int effect,
         int mountBonus, Soldier *attacker)
 {
     /* 1. Check against Global effects (not sure how yet) */
@@ -1133,7 +1426,7 @@ int Army::DoAnAttack(char const *special, int numAttacks, int attackType,
                 return -1;
             }
 
-            if (effect != NULL && !combat) {
+            if (effect != -1 && !combat) {
                 /* We got through shield... if killing spell, destroy shield */
                 shields.Remove(hi);
                 delete hi;
@@ -1149,89 +1442,102 @@ int Army::DoAnAttack(char const *special, int numAttacks, int attackType,
         /* 3. Get the target */
         int tarnum = GetTargetNum(special);
         if (tarnum == -1) continue;
-        Soldier * tar = GetTarget(tarnum);
-        int tarFlags = 0;
-        if (tar->weapon != -1) {
-            WeaponType *pw = FindWeapon(ItemDefs[tar->weapon].abr);
-            tarFlags = pw->flags;
-        }
+        ret += HitSoldier(tarnum, special, attackType, attackLevel, flags,
+                weaponClass, effect, mountBonus, attacker);
+    }
+    return ret;
+}
 
-        /* 4. Add in any effects, if applicable */
-        int tlev = 0;
-        if (attackType != NUM_ATTACK_TYPES)
-            tlev = tar->dskill[ attackType ];
-        if (special != NULL) {
-            SpecialType *sp = FindSpecial(special);
-            if ((sp->effectflags & SpecialType::FX_NOBUILDING) && tar->building)
-                tlev -= 2;
-        }
+//
+// One attack on the soldier at tarnum: returns 1 if it killed (or
+// wounded) the soldier or gave it the effect.  The bonuses the attack
+// gets against this soldier stay added to attackLevel, for the
+// remaining attacks of the same DoAnAttack.
+//
+int Army::HitSoldier(int tarnum, char const *special, int attackType,
+        int &attackLevel, int flags, int weaponClass, int effect,
+        int mountBonus, Soldier *attacker)
+{
+    Soldier * tar = GetTarget(tarnum);
+    int tarFlags = tar->weaponflags;
+
+    /* 4. Add in any effects, if applicable */
+    int tlev = 0;
+    if (attackType != NUM_ATTACK_TYPES)
+        tlev = tar->dskill[ attackType ];
+    if (special != NULL) {
+        SpecialType *sp = FindSpecial(special);
+        if ((sp->effectflags & SpecialType::FX_NOBUILDING) && tar->building)
+            tlev -= 2;
+    }
 
-        /* 4.1 Check whether defense is allowed against this weapon */
-        if ((flags & WeaponType::NODEFENSE) && (tlev > 0)) tlev = 0;
-
-        if (!(flags & WeaponType::RANGED)) {
-            /* 4.2 Check relative weapon length */
-            int attLen = 1;
-            int defLen = 1;
-            if (flags & WeaponType::LONG) attLen = 2;
-            else if (flags & WeaponType::SHORT) attLen = 0;
-            if (tarFlags & WeaponType::LONG) defLen = 2;
-            else if (tarFlags & WeaponType::SHORT) defLen = 0;
-            if (attLen > defLen) attackLevel++;
-            else if (defLen > attLen) tlev++;
-        }
+    /* 4.1 Check whether defense is allowed against this weapon */
+    if ((flags & WeaponType::NODEFENSE) && (tlev > 0)) tlev = 0;
+
+    if (!(flags & WeaponType::RANGED)) {
+        /* 4.2 Check relative weapon length */
+        int attLen = 1;
+        int defLen = 1;
+        if (flags & WeaponType::LONG) attLen = 2;
+        else if (flags & WeaponType::SHORT) attLen = 0;
+        if (tarFlags & WeaponType::LONG) defLen = 2;
+        else if (tarFlags & WeaponType::SHORT) defLen = 0;
+        if (attLen > defLen) attackLevel++;
+        else if (defLen > attLen) tlev++;
+    }
 
-        /* 4.3 Add bonuses versus mounted */
-        if (tar->riding != -1) attackLevel += mountBonus;
+    /* 4.3 Add bonuses versus mounted */
+    if (tar->riding != -1) attackLevel += mountBonus;
 
-        /* 5. Attack soldier */
-        if (attackType != NUM_ATTACK_TYPES) {
-            if (!(flags & WeaponType::ALWAYSREADY)) {
-                int failchance = 2;
-                if (Globals->ADVANCED_FORTS) {
-                    failchance += (tar->protection[attackType]+1)/2;
-                }
-                if (getrandom(failchance)) {
-                    continue;
-                }
+    /* 5. Attack soldier */
+    if (attackType != NUM_ATTACK_TYPES) {
+        if (!(flags & WeaponType::ALWAYSREADY)) {
+            int failchance = 2;
+            if (Globals->ADVANCED_FORTS) {
+                failchance += (tar->protection[attackType]+1)/2;
             }
-
-            if (!Hits(attackLevel,tlev)) {
-                continue;
+            if (getrandom(failchance)) {
+                return 0;
             }
         }
 
-        /* 6. If attack got through, apply effect, or kill */
-        if (effect == NULL) {
-            /* 7. Last chance... Check armor */
-            if (tar->ArmorProtect(weaponClass)) {
-                continue;
-            }
+        if (!Hits(attackLevel,tlev)) {
+            return 0;
+        }
+    }
 
-            /* 8. Seeya! */
-            Kill(tarnum);
-            ret++;
-            if ((ItemDefs[tar->race].type & IT_MAN) &&
-                (ItemDefs[attacker->race].type & IT_UNDEAD)) {
-                if (getrandom(100) < Globals->UNDEATH_CONTAGION) {
-                    attacker->unit->raised++;
-                    tar->canbehealed = 0;
-                }
-            }
-        } else {
-            if (tar->HasEffect(effect)) {
-                continue;
+    /* 6. If attack got through, apply effect, or kill */
+    if (effect == -1) {
+        /* 7. Last chance... Check armor */
+        if (tar->ArmorProtect(weaponClass)) {
+            return 0;
+        }
+
+        /* 8. Seeya! */
+        // Kill may move the target's record, so keep what we need
+        int tarRace = tar->race;
+        SoldierInfo *tarInfo = tar->info;
+        Kill(tarnum);
+        if ((ItemDefs[tarRace].type & IT_MAN) &&
+            (ItemDefs[attacker->race].type & IT_UNDEAD)) {
+            if (getrandom(100) < Globals->UNDEATH_CONTAGION) {
+                attacker->info->unit->raised++;
+                tarInfo->canbehealed = 0;
             }
-            tar->SetEffect(effect);
-            ret++;
         }
+    } else {
+        if (tar->HasEffect(effect)) {
+            return 0;
+        }
+        tar->SetEffect(effect);
+        EffectsChanged(tarnum);
     }
-    return ret;
+    return 1;
 }
 
 void Army::Kill(int killed)
 {
-    Soldier *temp = soldiers[killed];
+    Soldier *temp = &soldiers[killed];
 
     if (temp->amuletofi) return;
 
@@ -1240,7 +1546,8 @@ void Army::Kill(int killed)
     temp->hits--;
     temp->damage++;
     if (temp->hits > 0) return;
-    temp->unit->losses++;
+    temp->info->unit->losses++;
+    if (groups) Unlist(temp->info);
     if (Globals->ARMY_ROUT == GameDefs::ARMY_ROUT_HITS_FIGURE) {
         if (ItemDefs[temp->race].type & IT_MONSTER) {
             MonType *mp = FindMonster(ItemDefs[temp->race].abr,
@@ -1254,27 +1561,428 @@ void Army::Kill(int killed)
     }
 
     if (killed < canfront) {
-        soldiers[killed] = soldiers[canfront-1];
-        soldiers[canfront-1] = temp;
+        Swap(killed, canfront-1);
         killed = canfront - 1;
         canfront--;
     }
 
     if (killed < canbehind) {
-        soldiers[killed] = soldiers[canbehind-1];
-        soldiers[canbehind-1] = temp;
+        Swap(killed, canbehind-1);
         killed = canbehind-1;
         canbehind--;
     }
 
     if (killed < notfront) {
-        soldiers[killed] = soldiers[notfront-1];
-        soldiers[notfront-1] = temp;
+        Swap(killed, notfront-1);
         killed = notfront-1;
         notfront--;
     }
 
-    soldiers[killed] = soldiers[notbehind-1];
-    soldiers[notbehind-1] = temp;
+    Swap(killed, notbehind-1);
     notbehind--;
 }
+
+SoldierGroup::SoldierGroup()
+{
+    members = 0;
+    size = 0;
+    ready = 0;
+    acting = 0;
+}
+
+SoldierGroup::~SoldierGroup()
+{
+    delete [] members;
+}
+
+//
+// The number of successes in n tries that each succeed with chance p,
+// from a single random draw.  The search for it starts at the most
+// likely number and works outwards, so takes about as many steps as the
+// standard deviation.
+//
+static int Binomial(int n, double p)
+{
+    if (n <= 0 || p <= 0) return 0;
+    if (p >= 1) return n;
+
+    double q = 1 - p;
+    double u = (getrandom(1 << 30) + 0.5) / (1 << 30);
+    int mode = (int) ((n + 1) * p);
+    if (mode > n) mode = n;
+    // lgamma_r rather than lgamma, which sets the global signgam; battles
+    // can be fought on several threads at once
+    int sign;
+    double pmode = exp(lgamma_r(n + 1.0, &sign) -
+            lgamma_r(mode + 1.0, &sign) - lgamma_r(n - mode + 1.0, &sign) +
+            mode * log(p) + (n - mode) * log(q));
+
+    u -= pmode;
+    if (u <= 0) return mode;
+    int lo = mode, hi = mode;
+    double plo = pmode, phi = pmode;
+    while (lo > 0 || hi < n) {
+        if (lo > 0) {
+            plo *= lo / (n - lo + 1.0) * q / p;
+            lo--;
+            u -= plo;
+            if (u <= 0) return lo;
+        }
+        if (hi < n) {
+            phi *= (n - hi) / (hi + 1.0) * p / q;
+            hi++;
+            u -= phi;
+            if (u <= 0) return hi;
+        }
+    }
+    // Only rounding can get here
+    return mode;
+}
+
+// The chance that Hits(a, d) succeeds
+static double HitChance(int a, int d)
+{
+    int tohit = 1, tomiss = 1;
+    if (a > d) {
+        tohit = pow(2, a - d);
+    } else if (d > a) {
+        tomiss = pow(2, d - a);
+    }
+    return (double) tohit / (tohit + tomiss);
+}
+
+//
+// Sorts the soldiers into groups for GROUPED_COMBAT.  Soldiers with a
+// special, more than one hit or anything else that sets them apart from
+// the soldiers around them are left to fight as loners.
+//
+void Army::SetupGroups()
+{
+    int *first = new int[count];
+    int *sizes = new int[count];
+    int unitgroups = 0;
+
+    numgroups = 0;
+    for (int n = 0; n < count; n++) {
+        Soldier *s = &soldiers[info[n].place];
+        info[n].group = -1;
+        // Only soldiers of the same unit are grouped together
+        if (n && info[n].unit != info[n - 1].unit) unitgroups = numgroups;
+        if (s->special || s->amuletofi || s->maxhits != 1 || s->effects ||
+                info[n].regen) continue;
+        if (s->riding != -1 &&
+                FindMount(ItemDefs[s->riding].abr)->mountSpecial) continue;
+
+        int g;
+        for (g = unitgroups; g < numgroups; g++) {
+            SoldierInfo *other = &info[first[g]];
+            if (SameProfile(s, &soldiers[other->place]) &&
+                    info[n].healing == other->healing &&
+                    info[n].healtype == other->healtype &&
+                    info[n].healitem == other->healitem &&
+                    info[n].battleItems == other->battleItems)
+                break;
+        }
+        if (g == numgroups) {
+            first[g] = n;
+            sizes[g] = 0;
+            numgroups++;
+        }
+        info[n].group = g;
+        sizes[g]++;
+    }
+
+    groups = new SoldierGroup[numgroups];
+    for (int g = 0; g < numgroups; g++) {
+        groups[g].profile = soldiers[info[first[g]].place];
+        groups[g].members = new int[sizes[g]];
+    }
+    // Grouped soldiers may become loners later in the battle
+    loners = new SoldierGroup;
+    loners->members = new int[count];
+    actors = new int[count];
+    for (int n = 0; n < count; n++) {
+        if (info[n].group == -1) Enlist(loners, n, 1);
+        else Enlist(&groups[info[n].group], n, 1);
+    }
+
+    delete [] first;
+    delete [] sizes;
+}
+
+//
+// Whether two soldiers of this army fight exactly alike, so that it
+// doesn't matter which of them attacks or is killed.
+//
+int Army::SameProfile(Soldier *a, Soldier *b)
+{
+    if (a->info->unit != b->info->unit || a->race != b->race ||
+            a->riding != b->riding || a->building != b->building ||
+            a->weapon != b->weapon || a->attacktype != b->attacktype ||
+            a->weaponflags != b->weaponflags ||
+            a->weaponclass != b->weaponclass ||
+            a->mountbonus != b->mountbonus || a->askill != b->askill ||
+            a->attacks != b->attacks || a->special != b->special ||
+            a->armor != b->armor || a->armortype != b->armortype ||
+            a->hits != b->hits || a->maxhits != b->maxhits ||
+            a->amuletofi != b->amuletofi || a->effects != b->effects)
+        return 0;
+    for (int i = 0; i < NUM_ATTACK_TYPES; i++) {
+        if (a->dskill[i] != b->dskill[i] ||
+                a->protection[i] != b->protection[i])
+            return 0;
+    }
+    return 1;
+}
+
+// Adds soldier n (an index in info) to a group
+void Army::Enlist(SoldierGroup *g, int n, int ready)
+{
+    int slot = g->size++;
+    if (ready) {
+        if (g->ready < slot) Move(g, g->ready, slot);
+        slot = g->ready++;
+    }
+    g->members[slot] = n;
+    info[n].slot = slot;
+}
+
+// Takes a soldier out of its group, when it dies or becomes a loner
+void Army::Unlist(SoldierInfo *si)
+{
+    SoldierGroup *g = (si->group == -1) ? loners : &groups[si->group];
+    int slot = si->slot;
+    if (slot < g->ready) {
+        g->ready--;
+        Move(g, g->ready, slot);
+        slot = g->ready;
+    }
+    g->size--;
+    Move(g, g->size, slot);
+}
+
+void Army::Move(SoldierGroup *g, int from, int to)
+{
+    g->members[to] = g->members[from];
+    info[g->members[to]].slot = to;
+}
+
+int Army::InFront(int place)
+{
+    return place < canfront || (place >= canbehind && place < notfront);
+}
+
+// Every living soldier gets to attack once in each round
+void Army::ReadyGroups()
+{
+    for (int g = 0; g < numgroups; g++) {
+        groups[g].ready = groups[g].size;
+        groups[g].acting = 0;
+    }
+    loners->ready = loners->size;
+    numactors = 0;
+}
+
+//
+// Picks the soldiers that attack in the next volley, when there are
+// volleysleft volleys to go in the round.  Each soldier yet to attack
+// is as likely to attack in any of them, as each is as likely to be
+// picked at any point of a normal round.  The loners that are picked
+// go in actors.
+//
+void Army::ChooseVolley(int volleysleft)
+{
+    double chance = 1.0 / volleysleft;
+    for (int g = 0; g < numgroups; g++) {
+        SoldierGroup *sg = &groups[g];
+        sg->acting = Binomial(sg->ready, chance);
+        sg->ready -= sg->acting;
+    }
+
+    numactors = 0;
+    int num = Binomial(loners->ready, chance);
+    while (num--) {
+        int i = getrandom(loners->ready);
+        int n = loners->members[i];
+        actors[numactors++] = n;
+        loners->ready--;
+        Move(loners, loners->ready, i);
+        loners->members[loners->ready] = n;
+        info[n].slot = loners->ready;
+    }
+}
+
+//
+// Grouped soldiers stay in the part of soldiers that can attack, while
+// the loners that attacked were moved on as in a normal round.  Marks
+// them all as having attacked, so that Reset can be used as normal.
+//
+void Army::FinishVolleys()
+{
+    // Bring the front loners that attacked next to the rest of the front
+    for (int i = canbehind; i < notfront; i++) {
+        Swap(i, canfront);
+        canfront++;
+        canbehind++;
+    }
+    notfront = canfront;
+    canfront = 0;
+    canbehind = 0;
+}
+
+// The chosen groups of this army attack def all at once
+void Army::GroupVolley(Army *def)
+{
+    for (int g = 0; g < numgroups && def->NumAlive(); g++) {
+        SoldierGroup *sg = &groups[g];
+        if (!sg->acting) continue;
+        Soldier *a = &sg->profile;
+        int attacks = a->attacks;
+        if (attacks < 0) attacks = (round % -attacks == 1);
+        // Grouped soldiers never leave the part of soldiers that can
+        // attack, so this says whether the group is behind
+        if (info[sg->members[0]].place >= canfront &&
+                !(a->weaponflags & WeaponType::RANGED))
+            attacks = 0;
+        def->TakeVolley(a, sg->acting * attacks);
+        sg->acting = 0;
+    }
+}
+
+//
+// Takes a number of normal attacks from soldiers like attacker.  Each
+// goes at a random soldier at the front, as in DoAnAttack.  How many
+// land on each group, and how many of those kill, is drawn in one go;
+// attacks on loners are still made one at a time.  Attacks that would
+// have gone to soldiers already killed go round again.
+//
+void Army::TakeVolley(Soldier *attacker, int attacks)
+{
+    int attackType = attacker->attacktype;
+    if (attackType == ATTACK_RANGED || attackType == ATTACK_ENERGY ||
+            attackType == ATTACK_WEATHER || attackType == ATTACK_SPIRIT) {
+        Shield *hi = shields.GetHighShield(attackType);
+        if (hi) {
+            attacks = Binomial(attacks,
+                    HitChance(attacker->askill, hi->shieldskill));
+        }
+    }
+
+    int *front = new int[loners->size + 1];
+    while (attacks > 0 && NumAlive()) {
+        if (!NumFront()) {
+            canfront = canbehind;
+            notfront = notbehind;
+        }
+
+        int targets = 0;
+        for (int g = 0; g < numgroups; g++) {
+            if (groups[g].size && InFront(info[groups[g].members[0]].place))
+                targets += groups[g].size;
+        }
+        int numfront = 0;
+        for (int i = 0; i < loners->size; i++) {
+            if (InFront(info[loners->members[i]].place))
+                front[numfront++] = loners->members[i];
+        }
+        targets += numfront;
+
+        int left = attacks;
+        int again = 0;
+        for (int g = 0; g < numgroups && left; g++) {
+            SoldierGroup *sg = &groups[g];
+            if (!sg->size || !InFront(info[sg->members[0]].place)) continue;
+            int num = Binomial(left, (double) sg->size / targets);
+            targets -= sg->size;
+            left -= num;
+            if (!num) continue;
+
+            int kills = Binomial(num, KillChance(attacker, &sg->profile));
+            if (kills > sg->size) {
+                again += num * (kills - sg->size) / kills;
+                kills = sg->size;
+            }
+            int raised = 0;
+            if ((ItemDefs[sg->profile.race].type & IT_MAN) &&
+                    (ItemDefs[attacker->race].type & IT_UNDEAD)) {
+                raised = Binomial(kills, Globals->UNDEATH_CONTAGION / 100.0);
+                attacker->info->unit->raised += raised;
+            }
+            while (kills--) {
+                // Those yet to attack are as likely to be hit as the
+                // rest, and those about to attack stop short
+                int n;
+                int r = getrandom(sg->size);
+                if (r < sg->ready) {
+                    n = sg->members[sg->ready - 1];
+                } else {
+                    if (r - sg->ready < sg->acting) sg->acting--;
+                    n = sg->members[sg->size - 1];
+                }
+                if (raised) {
+                    info[n].canbehealed = 0;
+                    raised--;
+                }
+                Kill(info[n].place);
+            }
+        }
+
+        while (left && numfront) {
+            int t = getrandom(numfront);
+            int n = front[t];
+            int attackLevel = attacker->askill;
+            HitSoldier(info[n].place, NULL, attackType, attackLevel,
+                    attacker->weaponflags, attacker->weaponclass, -1,
+                    attacker->mountbonus, attacker);
+            if (info[n].place >= notbehind) front[t] = front[--numfront];
+            left--;
+        }
+        attacks = again + left;
+    }
+    delete [] front;
+}
+
+// The chance that one normal attack by attacker kills target
+double Army::KillChance(Soldier *attacker, Soldier *target)
+{
+    int attackType = attacker->attacktype;
+    int flags = attacker->weaponflags;
+    int attackLevel = attacker->askill;
+    int tlev = 0;
+    if (attackType != NUM_ATTACK_TYPES)
+        tlev = target->dskill[attackType];
+    if ((flags & WeaponType::NODEFENSE) && (tlev > 0)) tlev = 0;
+
+    if (!(flags & WeaponType::RANGED)) {
+        int attLen = 1;
+        int defLen = 1;
+        if (flags & WeaponType::LONG) attLen = 2;
+        else if (flags & WeaponType::SHORT) attLen = 0;
+        if (target->weaponflags & WeaponType::LONG) defLen = 2;
+        else if (target->weaponflags & WeaponType::SHORT) defLen = 0;
+        if (attLen > defLen) attackLevel++;
+        else if (defLen > attLen) tlev++;
+    }
+
+    if (target->riding != -1) attackLevel += attacker->mountbonus;
+
+    double chance = 1;
+    if (attackType != NUM_ATTACK_TYPES) {
+        if (!(flags & WeaponType::ALWAYSREADY)) {
+            int failchance = 2;
+            if (Globals->ADVANCED_FORTS) {
+                failchance += (target->protection[attackType]+1)/2;
+            }
+            chance /= failchance;
+        }
+        chance *= HitChance(attackLevel, tlev);
+    }
+
+    ArmorType *pArm = target->armortype;
+    if (pArm) {
+        int saves = pArm->saves[attacker->weaponclass];
+        if (saves > pArm->from) saves = pArm->from;
+        if (saves > 0) chance *= 1 - (double) saves / pArm->from;
+    }
+    return chance;
+}
@@ -26,11 +26,11 @@
 #define ARMY_CLASS
 
 #include <functional>
-#include <map>
 using namespace std;
 
 class Soldier;
 class Army;
+class SpecialType;
 
 #include "unit.h"
 #include "alist.h"
@@ -39,9 +39,40 @@ class Army;
 #include "shields.h"
 #include "helper.h"
 
+//
+// The parts of a soldier that the combat rounds never look at: who it
+// belongs to, its healing and the battle items to hand back afterwards.
+// Each Army keeps these in a side table so that its Soldier records stay
+// small and close together.
+//
+class SoldierInfo {
+    public:
+        Unit * unit;
+
+        /* Healing information */
+        int healing;
+        int healtype;
+        int healitem;
+        int canbehealed;
+        int regen;
+
+        BITFIELD battleItems;
+
+        /* With GROUPED_COMBAT, see SoldierGroup */
+        int group;      // Index in Army::groups, or -1 for a loner
+        int slot;       // Index in the group's members
+        int place;      // Index in Army::soldiers
+};
+
+//
+// The combat state of a single figure.  An Army holds these by value in
+// one array, which the rounds shuffle around as soldiers attack and die,
+// so a Soldier must stay cheap to copy.
+//
 class Soldier {
     public:
-        Soldier(Unit *unit, Object *object, int regType, int race, int ass=0);
+        void Setup(SoldierInfo *info, Object *object, int regType, int race,
+                int ass=0);
 
         void SetupSpell();
         void SetupCombatItems();
@@ -51,33 +82,31 @@ class Soldier {
         //
         void SetupHealing();
 
-        int HasEffect(char const *);
-        void SetEffect(char const *);
-        void ClearEffect(char const *);
-        void ClearOneTimeEffects(void);
+        // The name used for this soldier in the battle report
+        AString Name();
+
+        // Effects are numbers in EffectDefs; -1 is no effect
+        int HasEffect(int);
+        void SetEffect(int);
+        void ClearEffect(int);
+        int ClearOneTimeEffects(void);
         int ArmorProtect(int weaponClass );
 
         void RestoreItems();
         void Alive(int);
         void Dead();
 
-        /* Unit info */
-        AString name;
-        Unit * unit;
+        SoldierInfo * info;
         int race;
         int riding;
         int building;
 
-        /* Healing information */
-        int healing;
-        int healtype;
-        int healitem;
-        int canbehealed;
-        int regen;
-
         /* Attack info */
         int weapon;
         int attacktype;
+        int weaponflags;
+        int weaponclass;
+        int mountbonus;
         int askill;
         int attacks;
         char const *special;
@@ -87,18 +116,67 @@ class Soldier {
         int dskill[NUM_ATTACK_TYPES];
         int protection[NUM_ATTACK_TYPES];
         int armor;
+        ArmorType *armortype;
         int hits;
         int maxhits;
         int damage;
 
-        BITFIELD battleItems;
         int amuletofi;
 
-        /* Effects */
-        map< char const *, int > effects;
+        /* Effects, a bit for each of EffectDefs */
+        BITFIELD effects;
+};
+
+//
+// The soldiers of an army that one targeted special can hit.  Whether
+// each place in Army::soldiers holds such a soldier is kept in a Fenwick
+// tree, so that the valid targets in a range of places can be counted,
+// and the n'th of them found, without looking at every soldier.
+//
+class TargetSet : public AListElem
+{
+    public:
+        TargetSet(SpecialType *, int size);
+        ~TargetSet();
+
+        void Set(int place, int valid);
+        int Get(int place) { return valid[place]; }
+        // The number of valid targets before this place
+        int Before(int place);
+        // The place of the valid target with n others before it
+        int Find(int n);
+
+        SpecialType *special;
+
+    private:
+        int size;
+        int top;
+        int *tree;
+        char *valid;
 };
 
-typedef Soldier * SoldierPtr;
+//
+// With GROUPED_COMBAT, the soldiers of an army are sorted into groups of
+// the same unit that fight exactly alike (see Army::SameProfile), so
+// that a whole group's attacks in a volley can be resolved at once.
+// members holds the group's living soldiers as indexes in Army::info;
+// the first ready of them have yet to attack this round.  Soldiers that
+// can't be grouped, or stop fitting their group, are kept in the same
+// way in Army::loners and fight one at a time.
+//
+class SoldierGroup {
+    public:
+        SoldierGroup();
+        ~SoldierGroup();
+
+        Soldier profile;
+        int *members;
+        int size;
+        int ready;
+
+        // Chosen to attack in the current volley
+        int acting;
+};
 
 class Army
 {
@@ -123,22 +201,50 @@ class Army
         int CanAttack();
         int NumFront();
         Soldier *GetAttacker( int, int & );
-        int GetEffectNum(char const *effect);
+        int GetEffectNum(int effect);
         int GetTargetNum(char const *special = NULL);
+        TargetSet *GetTargetSet(SpecialType *);
+        void EffectsChanged(int);
         Soldier *GetTarget( int );
-        int RemoveEffects(int num, char const *effect);
+        int RemoveEffects(int num, int effect);
         int DoAnAttack(char const *special, int numAttacks, int attackType,
-                int attackLevel, int flags, int weaponClass, char const *effect,
+                int attackLevel, int flags, int weaponClass, int effect,
                 int mountBonus, Soldier *attacker);
         void Kill(int);
+        void Swap(int, int);
         void Reset();
 
+        int HitSoldier(int tarnum, char const *special, int attackType,
+                int &attackLevel, int flags, int weaponClass, int effect,
+                int mountBonus, Soldier *attacker);
+
+        //
+        // Grouped combat; see SoldierGroup and Battle::GroupedAttacks
+        //
+        void SetupGroups();
+        int SameProfile(Soldier *, Soldier *);
+        void Enlist(SoldierGroup *, int, int ready);
+        void Unlist(SoldierInfo *);
+        void Move(SoldierGroup *, int from, int to);
+        int InFront(int place);
+        void ReadyGroups();
+        void ChooseVolley(int volleysleft);
+        void FinishVolleys();
+        void GroupVolley(Army *def);
+        void TakeVolley(Soldier *attacker, int attacks);
+        double KillChance(Soldier *attacker, Soldier *target);
+
         //
         // These funcs are in specials.cpp
         //
-        int CheckSpecialTarget(char const *,int);
+        int CheckSpecialTarget(SpecialType *,int);
 
-        SoldierPtr * soldiers;
+        // The soldiers in battle order; see GetAttacker and Kill
+        Soldier * soldiers;
+        // One per soldier, in the order they were set up
+        SoldierInfo * info;
+        // TargetSets for the targeted specials used against this army
+        AList targetsets;
         Unit * leader;
         ShieldList shields;
         int round;
@@ -151,6 +257,14 @@ class Army
 
         int hitsalive; // current number of "living hits"
         int hitstotal; // Number of hits at start of battle.
+
+        // Only set up with GROUPED_COMBAT
+        SoldierGroup * groups;
+        int numgroups;
+        SoldierGroup * loners;
+        // The loners chosen to attack in the current volley
+        int * actors;
+        int numactors;
 };
 
 #endif
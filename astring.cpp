@@ -51,6 +51,15 @@ AString::AString(const char *s)
     if (s) strcpy(str,s);
 }
 
+// The first n characters of s, which need not be terminated
+AString::AString(const char *s, int n)
+{
+    len = n;
+    str = new char[len + 1];
+    memcpy(str, s, len);
+    str[len] = '\0';
+}
+
 AString::AString(int l)
 {
     char buf[16];
@@ -105,6 +114,7 @@ AString & AString::operator=(const char *c)
     if (c) len = strlen(c);
     if (str) delete[] str;
     str = new char[len + 1];
+    str[0] = '\0';
     if (c) strcpy(str,c);
     return *this;
 }
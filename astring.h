@@ -38,6 +38,7 @@ public:
     AString();
     AString(char *);
     AString(const char *);
+    AString(const char *, int);
     AString(int);
     AString(unsigned int);
     AString(char);
@@ -2105,8 +2105,8 @@ void Game::CreateWorld()
     if (Globals->MULTI_HEX_NEXUS) {
         ny = 2;
         while(nx <= 0) {
-            Awrite("How many hexes should the nexus region be?");
-            nx = Agetint();
+            nx = WorldSize(newnexus,
+                    "How many hexes should the nexus region be?");
             if (nx == 1) ny = 1;
             else if (nx % 2) {
                 nx = 0;
@@ -2119,8 +2119,7 @@ void Game::CreateWorld()
 
     int xx = 0;
     while (xx <= 0) {
-        Awrite("How wide should the map be? ");
-        xx = Agetint();
+        xx = WorldSize(newwidth, "How wide should the map be? ");
         if ( xx % 8 ) {
             xx = 0;
             Awrite( "The width must be a multiple of 8." );
@@ -2128,8 +2127,7 @@ void Game::CreateWorld()
     }
     int yy = 0;
     while (yy <= 0) {
-        Awrite("How tall should the map be? ");
-        yy = Agetint();
+        yy = WorldSize(newheight, "How tall should the map be? ");
         if ( yy % 8 ) {
             yy = 0;
             Awrite( "The height must be a multiple of 8." );
@@ -29,9 +29,16 @@
 #include "gamedata.h"
 #include "quests.h"
 
+#include <mutex>
+
+// Guards the game's battle list and the quest list when battles in
+// separate regions run at the same time
+static std::mutex battleshared;
+
 Battle::Battle()
 {
     asstext = 0;
+    rounds = 0;
 }
 
 Battle::~Battle()
@@ -61,11 +68,15 @@ void Battle::FreeRound(Army * att,Army * def, int ass)
 
     /* Run attacks until done */
     int alv = def->NumAlive();
-    while (att->CanAttack() && def->NumAlive()) {
-        int num = getrandom(att->CanAttack());
-        int behind;
-        Soldier * a = att->GetAttacker(num, behind);
-        DoAttack(att->round, a, att, def, behind, ass);
+    if (att->groups && def->groups) {
+        GroupedAttacks(att, def, 0);
+    } else {
+        while (att->CanAttack() && def->NumAlive()) {
+            int num = getrandom(att->CanAttack());
+            int behind;
+            Soldier * a = att->GetAttacker(num, behind);
+            DoAttack(att->round, a, att, def, behind, ass);
+        }
     }
 
     /* Write losses */
@@ -96,14 +107,14 @@ void Battle::DoAttack(int round, Soldier *a, Army *attackers, Army *def,
                 num = def->DoAnAttack(pMt->mountSpecial, realtimes,
                         spd->damage[i].type, pMt->specialLev,
                         spd->damage[i].flags, spd->damage[i].dclass,
-                        spd->damage[i].effect, 0, a);
+                        spd->damage[i].effectnum, 0, a);
                 if (num != -1) {
                     if (tot == -1) tot = num;
                     else tot += num;
                 }
             }
             if (tot != -1) {
-                AddLine(a->name + " " + spd->spelldesc + ", " +
+                AddLine(a->Name() + " " + spd->spelldesc + ", " +
                         spd->spelldesc2 + tot + spd->spelltarget + ".");
             }
         }
@@ -122,31 +133,15 @@ void Battle::DoAttack(int round, Soldier *a, Army *attackers, Army *def,
     }
 
     for (int i = 0; i < numAttacks; i++) {
-        WeaponType *pWep = NULL;
-        if (a->weapon != -1)
-            pWep = FindWeapon(ItemDefs[a->weapon].abr);
-
-        if (behind) {
-            if (!pWep) break;
-            if (!( pWep->flags & WeaponType::RANGED)) break;
-        }
-
-        int flags = 0;
-        int attackType = ATTACK_COMBAT;
-        int mountBonus = 0;
-        int attackClass = SLASHING;
-        if (pWep) {
-            flags = pWep->flags;
-            attackType = pWep->attackType;
-            mountBonus = pWep->mountBonus;
-            attackClass = pWep->weapClass;
-        }
-        def->DoAnAttack(NULL, 1, attackType, a->askill, flags, attackClass,
-                NULL, mountBonus, a);
+        if (behind && !(a->weaponflags & WeaponType::RANGED)) break;
+
+        def->DoAnAttack(NULL, 1, a->attacktype, a->askill, a->weaponflags,
+                a->weaponclass, -1, a->mountbonus, a);
         if (!def->NumAlive()) break;
     }
 
-    a->ClearOneTimeEffects();
+    if (a->ClearOneTimeEffects())
+        attackers->EffectsChanged(a - attackers->soldiers);
 }
 
 void Battle::NormalRound(int round,Army * a,Army * b)
@@ -169,7 +164,12 @@ void Battle::NormalRound(int round,Army * a,Army * b)
     int batt = b->CanAttack();
 
     /* Run attacks until done */
-    while (aalive && balive && (aatt || batt))
+    if (a->groups && b->groups) {
+        GroupedAttacks(a, b, 1);
+        aalive = a->NumAlive();
+        balive = b->NumAlive();
+    }
+    else while (aalive && balive && (aatt || batt))
     {
         int num = getrandom(aatt + batt);
         int behind;
@@ -202,6 +202,57 @@ void Battle::NormalRound(int round,Army * a,Army * b)
     b->Reset();
 }
 
+//
+// The attacks of a round with GROUPED_COMBAT.  The round is split into
+// volleys; in each, the groups chosen to attack are resolved all at
+// once, and the loners chosen attack one at a time in a random order,
+// as in a normal round.  If both is 0, only a attacks.
+//
+void Battle::GroupedAttacks(Army *a, Army *b, int both)
+{
+    int volleys = Globals->GROUPED_COMBAT;
+    a->ReadyGroups();
+    if (both) b->ReadyGroups();
+
+    for (int v = 0; v < volleys; v++) {
+        if (!a->NumAlive() || !b->NumAlive()) break;
+        a->ChooseVolley(volleys - v);
+        if (both) b->ChooseVolley(volleys - v);
+
+        if (both && (v % 2)) {
+            b->GroupVolley(a);
+            if (a->NumAlive()) a->GroupVolley(b);
+        } else {
+            a->GroupVolley(b);
+            if (both && b->NumAlive()) b->GroupVolley(a);
+        }
+
+        int na = a->numactors;
+        int nb = both ? b->numactors : 0;
+        while (na + nb && a->NumAlive() && b->NumAlive()) {
+            int num = getrandom(na + nb);
+            Army *att = a;
+            Army *def = b;
+            if (num >= na) {
+                att = b;
+                def = a;
+                num = --nb;
+            } else {
+                num = --na;
+            }
+            SoldierInfo *si = &att->info[att->actors[num]];
+            // It may have been killed since the volley began
+            if (si->place >= att->notbehind) continue;
+            int behind;
+            Soldier *s = att->GetAttacker(si->place, behind);
+            DoAttack(att->round, s, att, def, behind);
+        }
+    }
+
+    a->FinishVolleys();
+    if (both) b->FinishVolleys();
+}
+
 void Battle::GetSpoils(AList * losers, ItemList *spoils, int ass)
 {
     ItemList *ships = new ItemList;
@@ -210,12 +261,12 @@ void Battle::GetSpoils(AList * losers, ItemList *spoils, int ass)
         int numalive = u->GetSoldiers();
         int numdead = u->losses;
         if (!numalive) {
+            std::lock_guard<std::mutex> guard(battleshared);
             if (quests.CheckQuestKillTarget(u, spoils)) {
                 AddLine("Quest completed!");
             }
         }
-        forlist(&u->items) {
-            Item * i = (Item *) elem;
+        forlist_items(&u->items, i) {
             if (IsSoldier(i->type)) continue;
             // ignore incomplete ships
             if (ItemDefs[i->type].type & IT_SHIP) continue;
@@ -227,9 +278,9 @@ void Battle::GetSpoils(AList * losers, ItemList *spoils, int ass)
             // incomplete ships:
             if (ItemDefs[i->type].type & IT_SHIP) {
                 if (getrandom(100) < percent) {
-                    u->items.SetNum(i->type, 0);
                     if (i->num < ships->GetNum(i->type))
                         ships->SetNum(i->type, i->num);
+                    u->items.SetNum(i->type, 0);
                 }
             } else {
                 int num = (int)(i->num * percent);
@@ -251,6 +302,7 @@ void Battle::GetSpoils(AList * losers, ItemList *spoils, int ass)
             spoils->SetNum(sh, ships->GetNum(sh));
         }
     }
+    delete ships;
 }
 
 int Battle::Run( ARegion * region,
@@ -280,6 +332,7 @@ int Battle::Run( ARegion * region,
     while (!armies[0]->Broken() && !armies[1]->Broken() && round < 101) {
         NormalRound(round++,armies[0],armies[1]);
     }
+    rounds = round - 1;
 
     if ((armies[0]->Broken() && !armies[1]->Broken()) ||
         (!armies[0]->NumAlive() && armies[1]->NumAlive())) {
@@ -295,6 +348,11 @@ int Battle::Run( ARegion * region,
         ItemList *spoils = new ItemList;
         armies[0]->Lose(this, spoils);
         GetSpoils(atts, spoils, ass);
+        {
+            forlist_items(spoils, i) {
+                taken.SetNum(i->type, i->num);
+            }
+        }
         if (spoils->Num()) {
             temp = AString("Spoils: ") + spoils->Report(2,0,1) + ".";
         } else {
@@ -329,6 +387,11 @@ int Battle::Run( ARegion * region,
         ItemList *spoils = new ItemList;
         armies[1]->Lose(this, spoils);
         GetSpoils(defs, spoils, ass);
+        {
+            forlist_items(spoils, i) {
+                taken.SetNum(i->type, i->num);
+            }
+        }
         if (spoils->Num()) {
             temp = AString("Spoils: ") + spoils->Report(2,0,1) + ".";
         } else {
@@ -379,7 +442,7 @@ void Battle::WriteSides(ARegion * r,
     int aobs = 0;
     {
         forlist(defs) {
-            int a = ((Location *)elem)->unit->GetAttribute("observation");
+            int a = ((Location *)elem)->unit->GetAttribute(AT_OBSERVATION);
             if (a > dobs) dobs = a;
         }
     }
@@ -387,7 +450,7 @@ void Battle::WriteSides(ARegion * r,
     AddLine("Attackers:");
     {
         forlist(atts) {
-            int a = ((Location *)elem)->unit->GetAttribute("observation");
+            int a = ((Location *)elem)->unit->GetAttribute(AT_OBSERVATION);
             if (a > aobs) aobs = a;
             AString * temp = ((Location *) elem)->unit->BattleReport(dobs);
             AddLine(*temp);
@@ -748,6 +811,7 @@ int Game::RunBattle(ARegion * r,Unit * attacker,Unit * target,int ass,
     AList atts,defs;
     FactionPtr * p;
     int result;
+    RandomStream stream(r->num, RANDOM_BATTLE + r->battlecount++);
 
     if (ass) {
         if (attacker->GetAttitude(r,target) == A_ALLY) {
@@ -791,18 +855,20 @@ int Game::RunBattle(ARegion * r,Unit * attacker,Unit * target,int ass,
         return BATTLE_IMPOSSIBLE;
     }
 
+    ProfileCount(PROFILE_BATTLES);
     Battle * b = new Battle;
     b->WriteSides(r,attacker,target,&atts,&defs,ass, &regions );
 
-    battles.Add(b);
+    {
+        std::lock_guard<std::mutex> guard(battleshared);
+        battles.Add(b);
+    }
     {
         forlist(&factions) {
             Faction * f = (Faction *) elem;
             if (GetFaction2(&afacs,f->num) || GetFaction2(&dfacs,f->num) ||
                     r->Present(f)) {
-                BattlePtr * p = new BattlePtr;
-                p->ptr = b;
-                f->battles.Add(p);
+                f->AddBattle(b);
             }
         }
     }
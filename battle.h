@@ -65,6 +65,7 @@ class Battle : public AListElem
                 ARegionList *pRegs);
         void FreeRound(Army *,Army *, int ass = 0);
         void NormalRound(int,Army *,Army *);
+        void GroupedAttacks(Army *a, Army *b, int both);
         void DoAttack(int round, Soldier *a, Army *attackers, Army *def,
                 int behind, int ass = 0);
 
@@ -84,6 +85,10 @@ class Battle : public AListElem
         Faction * attacker; /* Only matters in the case of an assassination */
         AString * asstext;
         AList text;
+
+        // Set by Run: the normal rounds fought and what the winners took
+        int rounds;
+        ItemList taken;
 };
 
 #endif
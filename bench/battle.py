@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+
+# Times one very large battle.
+#
+# This sets up a single hex with two factions of --soldiers figures each,
+# one all men armed with swords, plate armour and crossbows, the other
+# half men and half undead, and orders every unit of the second side to
+# attack the first.  The battle turn is then run --repeat times
+# with each engine named on the command line, and the median and fastest
+# wall time of the "Running Combat" phase from turnprofile.json printed.
+#
+# The battle is kept under --work and used again by later runs with the
+# same settings, so two builds fight exactly the same battle.  As the
+# random number generator is seeded from the game, every engine should
+# also write exactly the same battle report; a warning is printed when
+# they do not.
+#
+#   python3 bench/battle.py                      # standard/standard
+#   python3 bench/battle.py old/standard standard/standard
+
+import argparse
+import hashlib
+import json
+import os
+import re
+import shutil
+import sys
+
+import bench
+
+PHASE = 'Running Combat'
+
+
+def sides(soldiers):
+    """The units of the two sides, as lists of (item, count) lists."""
+    half = soldiers // 2
+    rest = soldiers - half
+    a = [[('VIKI', half), ('SWOR', half), ('PARM', half)],
+         [('PLAI', rest), ('XBOW', rest)]]
+    b = [[('UNDE', half)],
+         [('BARB', rest), ('SWOR', rest), ('LBOW', rest), ('PARM', rest)]]
+    return a, b
+
+
+def prepare(binary, wdir, opts):
+    """Makes the battle, or finds the one made before."""
+    battle = os.path.join(wdir, 'battle')
+    if os.path.exists(os.path.join(battle, 'game.in')):
+        return battle
+
+    shutil.rmtree(wdir, ignore_errors=True)
+    setup = os.path.join(wdir, 'setup')
+    os.makedirs(setup)
+    print('making a battle of %d against %d' % (opts.soldiers,
+                                                opts.soldiers))
+    bench.new_world(binary, setup, 200, opts.seed)
+    land = bench.surface_land(binary, setup)
+    x, y = land[len(land) // 2]
+    with open(os.path.join(setup, 'players.in'), 'a') as f:
+        for n, units in enumerate(sides(opts.soldiers)):
+            f.write('Faction: new\n')
+            f.write('Name: Side %d\n' % (n + 1))
+            f.write('Email: side%d@example.com\n' % (n + 1))
+            f.write('Password: side%d\n' % (n + 1))
+            for k, items in enumerate(units):
+                f.write('Loc: %d %d 1\n' % (x, y))
+                f.write('NewUnit: %d\n' % (k + 1))
+                for item, num in items:
+                    f.write('Item: gm%d %d %s\n' % (k + 1, num, item))
+    bench.run(binary, ['run'], setup)
+
+    # The first unit in each report is the faction's leader, left out of
+    # the fight
+    def units(fac):
+        report = os.path.join(setup, 'report.%d' % fac)
+        with open(report) as f:
+            return re.findall(r'^\* .*?\((\d+)\)', f.read(), re.M)[1:]
+    defenders, attackers = units(3), units(4)
+    if not defenders or not attackers:
+        sys.exit('could not find the units of both sides in %s' % setup)
+    pw = bench.passwords(setup)
+    bench.next_turn(setup)
+
+    os.makedirs(battle)
+    for name in ('game.in', 'players.in'):
+        shutil.copy(os.path.join(setup, name), battle)
+    with open(os.path.join(battle, 'orders.4'), 'w') as f:
+        f.write('#atlantis 4 "%s"\n' % pw[4])
+        for u in attackers:
+            f.write('unit %s\nattack %s\n' % (u, ' '.join(defenders)))
+        f.write('#end\n')
+    shutil.rmtree(setup)
+    return battle
+
+
+def fight(binary, battle, rundir):
+    """Runs the battle turn once; returns the combat time and report."""
+    shutil.rmtree(rundir, ignore_errors=True)
+    shutil.copytree(battle, rundir)
+    bench.run(binary, ['run'], rundir)
+    with open(os.path.join(rundir, 'turnprofile.json')) as f:
+        profile = json.load(f)
+    ms = sum(p['wall_ms'] for p in profile['phases'] if p['name'] == PHASE)
+    with open(os.path.join(rundir, 'report.3'), 'rb') as f:
+        digest = hashlib.sha1(f.read()).hexdigest()
+    return ms, profile['total']['battles'], digest
+
+
+def main():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    parser = argparse.ArgumentParser(
+        description='Time one battle between two large armies.')
+    parser.add_argument('engines', nargs='*',
+                        default=[bench.engine(root, 'standard')],
+                        help='engines to time (default: standard/standard)')
+    parser.add_argument('--soldiers', type=int, default=10000,
+                        help='figures on each side (default 10000)')
+    parser.add_argument('--repeat', type=int, default=5,
+                        help='times to run the battle with each engine '
+                        '(default 5)')
+    parser.add_argument('--seed', type=int, default=1,
+                        help='seed for the world the battle is in')
+    parser.add_argument('--work', default=os.path.join(root, 'bench', 'work'),
+                        help='where the battle is kept')
+    opts = parser.parse_args()
+
+    for binary in opts.engines:
+        if not os.access(binary, os.X_OK):
+            sys.exit('%s has not been built' % binary)
+
+    wdir = os.path.join(opts.work, 'battle-n%d-s%d' % (opts.soldiers,
+                                                       opts.seed))
+    battle = prepare(opts.engines[0], wdir, opts)
+    rundir = os.path.join(wdir, 'run')
+
+    reports = set()
+    for binary in opts.engines:
+        times = []
+        for _ in range(opts.repeat):
+            ms, battles, digest = fight(binary, battle, rundir)
+            if battles != 1:
+                sys.exit('%s fought %d battles, not 1' % (binary, battles))
+            times.append(ms)
+            reports.add(digest)
+        print('%s: %s median %.1f ms, fastest %.1f ms' %
+              (binary, PHASE, bench.median(times), min(times)))
+    shutil.rmtree(rundir, ignore_errors=True)
+    if len(reports) > 1:
+        print('warning: the battle reports were not all the same')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,512 @@
+#!/usr/bin/env python3
+
+# Benchmarks full turns of the engine on large synthetic worlds.
+#
+# For each ruleset named on the command line this:
+#
+# 1. makes a new world of about --hexes surface hexes with `atlantis new`,
+#    seeded with --seed so the same settings give the same world on any
+#    machine; several rulesets' worlds are made at once (--jobs)
+# 2. adds --factions factions to players.in, each given units spread over
+#    the land of the surface through the gamemaster Loc:/NewUnit:/Item:
+#    lines, --units units to a populated region with --items kinds of
+#    item each
+# 3. runs a setup turn to bring them into the game
+# 4. runs --turns timed turns, with orders made up from each faction's
+#    template and report: moving, working, taxing, producing, studying,
+#    trading and now and then attacking; or, with --mix study, only
+#    studying, teaching and producing.  --skills gives every unit some
+#    skills to begin with.
+#
+# Worlds and orders are kept under --work and used again by later runs
+# with the same settings, so two builds can be timed on exactly the same
+# input.  The times of each turn, and of each phase of it as written to
+# turnprofile.json by `atlantis run`, go to a JSON results file.  Two
+# results files can be set side by side with --compare.
+#
+# `make bench` builds every ruleset and runs this on all of them.
+
+import argparse
+import concurrent.futures
+import json
+import math
+import os
+import random
+import re
+import shutil
+import subprocess
+import sys
+import time
+
+RULESETS = ['standard', 'basic', 'fracas', 'kingdoms', 'havilah']
+
+# Items every ruleset has switched on; giving a unit a disabled item
+# from players.in is not safe.
+MEN = ['VIKI', 'PLAI', 'BARB', 'HDWA']
+ITEMS = ['HORS', 'WOOD', 'IRON', 'STON', 'GRAI', 'LIVE', 'FISH', 'SWOR',
+         'PARM', 'HERB', 'FUR', 'XBOW', 'LBOW']
+
+DIRS = ['n', 'ne', 'se', 's', 'sw', 'nw']
+PRODUCE = ['WOOD', 'IRON', 'STON', 'GRAI', 'LIVE', 'HORS', 'FISH', 'HERB']
+STUDY = ['COMB', 'OBSE', 'STEA', 'TACT', 'MINI', 'LUMB', 'FARM', 'HORS',
+         'WEAP', 'ARMO', 'BUIL', 'ENTE', 'HEAL', 'RIDI', 'XBOW', 'LBOW']
+
+
+def engine(root, game):
+    return os.path.join(root, game, game)
+
+
+def run(binary, args, cwd, stdin=''):
+    """Runs the engine, returning its output and the wall time taken."""
+    start = time.perf_counter()
+    p = subprocess.run([binary] + args, cwd=cwd, input=stdin,
+                       stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                       universal_newlines=True)
+    elapsed = time.perf_counter() - start
+    if p.returncode:
+        sys.exit('%s %s failed in %s:\n%s' % (binary, ' '.join(args), cwd,
+                                              p.stdout[-2000:]))
+    return p.stdout, elapsed
+
+
+def new_world(binary, wdir, hexes, seed):
+    # The surface has width * height / 2 hexes; both must be multiples
+    # of 8.
+    side = max(8, int(round(math.sqrt(2 * hexes) / 8)) * 8)
+    run(binary, ['new', '--seed', str(seed), '--width', str(side),
+                 '--height', str(side), '--nexus', '1'], wdir)
+    os.rename(os.path.join(wdir, 'game.out'), os.path.join(wdir, 'game.in'))
+    os.rename(os.path.join(wdir, 'players.out'),
+              os.path.join(wdir, 'players.in'))
+
+
+def surface_land(binary, wdir):
+    """The coordinates of the land hexes on the surface, from `map geo`."""
+    run(binary, ['map', 'geo', 'map.geo'], wdir)
+    land = []
+    rows = None
+    with open(os.path.join(wdir, 'map.geo')) as f:
+        for line in f:
+            line = line.rstrip('\n')
+            if line.startswith('Level '):
+                rows = [] if line.endswith(': Surface') else None
+            elif rows is not None and not line.startswith('Map ('):
+                if not line.strip():
+                    break
+                rows.append(line)
+    for y, row in enumerate(rows or []):
+        # Each hex takes four characters; odd rows are shifted by two
+        shift = 2 if y % 2 else 0
+        for i in range(0, (len(row) - shift + 3) // 4):
+            c = row[shift + 4 * i:shift + 4 * i + 1]
+            if c and c not in '- ':
+                land.append((2 * i + shift // 2, y))
+    os.remove(os.path.join(wdir, 'map.geo'))
+    return land
+
+
+def add_factions(wdir, land, opts, rng):
+    """Appends the benchmark factions and their units to players.in."""
+    nfac = opts.factions
+    blocks = [[] for _ in range(nfac)]
+    alias = [0] * nfac
+    populated = land[:]
+    rng.shuffle(populated)
+    populated = populated[:max(1, int(len(land) * opts.coverage))]
+    for n, (x, y) in enumerate(populated):
+        for k in range(opts.units):
+            # Neighbouring units belong to different factions, so there
+            # is someone to fight
+            f = (n + k) % nfac
+            alias[f] += 1
+            a = alias[f]
+            b = blocks[f]
+            b.append('Loc: %d %d 1' % (x, y))
+            b.append('NewUnit: %d' % a)
+            # Only leaders keep more than one skill
+            men = 'LEAD' if opts.skills > 1 else rng.choice(MEN)
+            b.append('Item: gm%d %d %s' % (a, rng.randint(2, 10), men))
+            for skill in rng.sample(STUDY, min(opts.skills, len(STUDY))):
+                b.append('Skill: gm%d %s %d' % (a, skill,
+                                                rng.choice([30, 90, 180])))
+            b.append('Item: gm%d %d SILV' % (a, rng.randint(200, 2000)))
+            for item in rng.sample(ITEMS, min(opts.items, len(ITEMS))):
+                b.append('Item: gm%d %d %s' % (a, rng.randint(1, 20), item))
+    with open(os.path.join(wdir, 'players.in'), 'a') as f:
+        for i, b in enumerate(blocks):
+            f.write('Faction: new\n')
+            f.write('Name: Bench %d\n' % (i + 1))
+            f.write('Email: bench%d@example.com\n' % (i + 1))
+            f.write('Password: bench%d\n' % (i + 1))
+            f.write('\n'.join(b) + '\n')
+    return len(populated) * opts.units
+
+
+def passwords(rundir):
+    """Faction numbers and passwords, from players.out."""
+    found = {}
+    fac = None
+    for line in read_lines(os.path.join(rundir, 'players.out')):
+        if line.startswith('Faction: '):
+            fac = line[9:].strip()
+        elif line.startswith('Password: ') and fac and fac.isdigit():
+            found[int(fac)] = line[10:].strip()
+    return found
+
+
+def study_orders(u, mine, where, rng):
+    """Orders for the study mix: studying, teaching and production."""
+    r = rng.random()
+    if r < 0.2:
+        pupils = [p for p in mine if p != u and where.get(p) == where.get(u)]
+        if pupils:
+            return ['teach ' + ' '.join(str(p) for p in
+                                        rng.sample(pupils,
+                                                   min(3, len(pupils))))]
+    if r < 0.55:
+        return ['produce ' + rng.choice(PRODUCE)]
+    return ['study ' + rng.choice(STUDY)]
+
+
+def make_orders(turn, fac, password, template, report, rng, mix):
+    """Made up orders for one faction, from its template and report."""
+    mine = []
+    for line in template:
+        m = re.match(r'unit (\d+)', line)
+        if m:
+            mine.append(int(m.group(1)))
+    # Where our units are, and the units of others in each region
+    where = {}
+    others = {}
+    region = None
+    for line in report:
+        if re.match(r'^[a-z].*\(\d+,\d+', line):
+            region = line
+        m = re.match(r'^\s*([-*]) .*?\((\d+)\)', line)
+        if m and region:
+            if m.group(1) == '*':
+                where[int(m.group(2))] = region
+            else:
+                others.setdefault(region, []).append(int(m.group(2)))
+
+    out = ['#atlantis %d "%s"' % (fac, password)]
+    for u in mine:
+        out.append('unit %d' % u)
+        if mix == 'study':
+            out += study_orders(u, mine, where, rng)
+            continue
+        r = rng.random()
+        if r < 0.2:
+            out.append('move ' + ' '.join(rng.choice(DIRS)
+                                           for _ in range(rng.randint(1, 2))))
+        elif r < 0.3:
+            out.append('tax')
+        elif r < 0.4:
+            out.append('work')
+        elif r < 0.45:
+            out.append('entertain')
+        elif r < 0.65:
+            out.append('produce ' + rng.choice(PRODUCE))
+        elif r < 0.85:
+            out.append('study ' + rng.choice(STUDY))
+        if rng.random() < 0.2:
+            out.append('buy %d %s' % (rng.randint(1, 5), rng.choice(MEN)))
+        if rng.random() < 0.1:
+            out.append('sell all ' + rng.choice(ITEMS))
+        near = others.get(where.get(u), [])
+        if near and turn > 1 and rng.random() < 0.05:
+            out.append('attack %d' % rng.choice(near))
+        if rng.random() < 0.05:
+            out.append('form 1')
+            out.append('  buy 1 ' + rng.choice(MEN))
+            out.append('  study ' + rng.choice(STUDY))
+            out.append('end')
+    out.append('#end')
+    return '\n'.join(out) + '\n'
+
+
+def read_lines(path):
+    try:
+        with open(path, errors='replace') as f:
+            return f.read().splitlines()
+    except IOError:
+        return []
+
+
+def write_orders(turn, rundir, odir, seed, mix):
+    os.makedirs(odir, exist_ok=True)
+    pw = passwords(rundir)
+    for name in sorted(os.listdir(rundir)):
+        if not name.startswith('template.'):
+            continue
+        fac = int(name.split('.')[1])
+        rng = random.Random(seed * 100003 + turn * 1009 + fac)
+        orders = make_orders(turn, fac, pw.get(fac, 'none'),
+                             read_lines(os.path.join(rundir, name)),
+                             read_lines(os.path.join(rundir,
+                                                     'report.%d' % fac)),
+                             rng, mix)
+        with open(os.path.join(odir, 'orders.%d' % fac), 'w') as f:
+            f.write(orders)
+
+
+def clear(rundir, prefixes):
+    for name in os.listdir(rundir):
+        if name.split('.')[0] in prefixes:
+            os.remove(os.path.join(rundir, name))
+
+
+def next_turn(rundir):
+    for name in ('game', 'players'):
+        os.replace(os.path.join(rundir, name + '.out'),
+                   os.path.join(rundir, name + '.in'))
+
+
+def world_name(opts):
+    name = 'h%d-f%d-u%d-i%d-c%g-s%d' % (opts.hexes, opts.factions,
+                                        opts.units, opts.items,
+                                        opts.coverage, opts.seed)
+    # Worlds made with the default mix keep their old names
+    if opts.skills:
+        name += '-k%d' % opts.skills
+    if opts.mix != 'all':
+        name += '-' + opts.mix
+    return name
+
+
+def prepare(game, binary, opts):
+    """Makes the world for a ruleset, or finds the one made before."""
+    wdir = os.path.join(opts.work, game, world_name(opts))
+    base = os.path.join(wdir, 'start')
+    if os.path.exists(os.path.join(base, 'game.in')):
+        with open(os.path.join(wdir, 'world.json')) as f:
+            return wdir, json.load(f)
+
+    shutil.rmtree(wdir, ignore_errors=True)
+    setup = os.path.join(wdir, 'setup')
+    os.makedirs(setup)
+    rng = random.Random(opts.seed)
+    print('%s: making a world of about %d hexes' % (game, opts.hexes))
+    new_world(binary, setup, opts.hexes, opts.seed)
+    land = surface_land(binary, setup)
+    units = add_factions(setup, land, opts, rng)
+    print('%s: bringing in %d factions with %d units' %
+          (game, opts.factions, units))
+    out, _ = run(binary, ['run'], setup)
+    if 'Must specify a valid' in out:
+        print('%s: some units could not be given their items' % game)
+    write_orders(1, setup, os.path.join(wdir, 'orders', '1'), opts.seed,
+                 opts.mix)
+    next_turn(setup)
+
+    os.makedirs(base)
+    for name in ('game.in', 'players.in'):
+        shutil.copy(os.path.join(setup, name), base)
+
+    info = {'land_hexes': len(land), 'units_placed': units,
+            'save_bytes': os.path.getsize(os.path.join(base, 'game.in'))}
+    with open(os.path.join(wdir, 'world.json'), 'w') as f:
+        json.dump(info, f, indent=2)
+    shutil.rmtree(setup)
+    return wdir, info
+
+
+def bench(game, root, opts):
+    binary = engine(root, game)
+    wdir, info = prepare(game, binary, opts)
+
+    rundir = os.path.join(wdir, 'run')
+    shutil.rmtree(rundir, ignore_errors=True)
+    os.makedirs(rundir)
+    for name in ('game.in', 'players.in'):
+        shutil.copy(os.path.join(wdir, 'start', name), rundir)
+
+    args = ['run']
+    if opts.threads > 1:
+        args += ['--threads', str(opts.threads)]
+    turns = []
+    for t in range(1, opts.turns + 1):
+        odir = os.path.join(wdir, 'orders', str(t))
+        clear(rundir, ('orders', 'report', 'template', 'turnprofile'))
+        for name in os.listdir(odir):
+            shutil.copy(os.path.join(odir, name), rundir)
+        _, elapsed = run(binary, args, rundir)
+        with open(os.path.join(rundir, 'turnprofile.json')) as f:
+            profile = json.load(f)
+        turns.append({'wall_s': round(elapsed, 4), 'profile': profile})
+        total = profile['total']
+        print('%s: turn %d took %.2fs (%d battles, %d unit moves)' %
+              (game, t, elapsed, total['battles'], total['units_moved']))
+        # Orders for the next turn are made once and kept, so other
+        # builds get the same ones
+        nodir = os.path.join(wdir, 'orders', str(t + 1))
+        if t < opts.turns and not os.path.isdir(nodir):
+            write_orders(t + 1, rundir, nodir, opts.seed, opts.mix)
+        next_turn(rundir)
+    shutil.rmtree(rundir)
+
+    return {
+        'world': info,
+        'turns': turns,
+        'summary': summarize(turns),
+    }
+
+
+def median(values):
+    values = sorted(values)
+    n = len(values)
+    if not n:
+        return 0
+    if n % 2:
+        return values[n // 2]
+    return round((values[n // 2 - 1] + values[n // 2]) / 2.0, 3)
+
+
+def summarize(turns):
+    """Median wall and CPU time of each phase over the turns."""
+    phases = {}
+    order = []
+    for t in turns:
+        for p in t['profile']['phases']:
+            if p['name'] not in phases:
+                phases[p['name']] = []
+                order.append(p['name'])
+            phases[p['name']].append(p)
+    summary = []
+    for name in order:
+        ps = phases[name]
+        summary.append({
+            'name': name,
+            'wall_ms': median([p['wall_ms'] for p in ps]),
+            'cpu_ms': median([p['cpu_ms'] for p in ps]),
+            'allocations': median([p['allocations'] for p in ps]),
+        })
+    summary.append({
+        'name': 'turn',
+        'wall_ms': median([t['wall_s'] * 1000.0 for t in turns]),
+        'cpu_ms': median([t['profile']['total']['cpu_ms'] for t in turns]),
+        'allocations': median([t['profile']['total']['allocations']
+                               for t in turns]),
+        'peak_rss_kb': max([t['profile']['total']['peak_rss_kb']
+                            for t in turns] or [0]),
+    })
+    return summary
+
+
+def describe_build(root):
+    try:
+        return subprocess.check_output(
+            ['git', 'describe', '--always', '--dirty'], cwd=root,
+            stderr=subprocess.DEVNULL, universal_newlines=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return 'unknown'
+
+
+def compare(old, new):
+    with open(old) as f:
+        a = json.load(f)
+    with open(new) as f:
+        b = json.load(f)
+    print('old: %s  new: %s' % (a.get('build'), b.get('build')))
+    if a.get('settings') != b.get('settings'):
+        print('warning: the two runs used different settings')
+    for game in b['rulesets']:
+        if game not in a['rulesets']:
+            continue
+        print('\n%s' % game)
+        print('%-40s %10s %10s %8s' % ('phase (median wall ms)', 'old',
+                                       'new', 'change'))
+        olds = dict((p['name'], p) for p in a['rulesets'][game]['summary'])
+        for p in b['rulesets'][game]['summary']:
+            o = olds.get(p['name'])
+            if not o:
+                continue
+            change = ''
+            if o['wall_ms'] > 0:
+                change = '%+.1f%%' % (100.0 * (p['wall_ms'] - o['wall_ms']) /
+                                      o['wall_ms'])
+            print('%-40s %10.2f %10.2f %8s' % (p['name'][:40], o['wall_ms'],
+                                              p['wall_ms'], change))
+
+
+def main():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    parser = argparse.ArgumentParser(
+        description='Time full turns on large synthetic worlds.')
+    parser.add_argument('rulesets', nargs='*', default=RULESETS,
+                        help='rulesets to run (default: all of them)')
+    parser.add_argument('--hexes', type=int, default=4000,
+                        help='surface hexes in the world (default 4000)')
+    parser.add_argument('--factions', type=int, default=40,
+                        help='player factions (default 40)')
+    parser.add_argument('--units', type=int, default=2,
+                        help='units in each populated region (default 2)')
+    parser.add_argument('--items', type=int, default=3,
+                        help='kinds of item per unit, besides men and '
+                        'silver (default 3)')
+    parser.add_argument('--coverage', type=float, default=0.5,
+                        help='share of the land hexes with units in them '
+                        '(default 0.5)')
+    parser.add_argument('--skills', type=int, default=0,
+                        help='skills each unit starts with; above 1 the '
+                        'units are leaders (default 0)')
+    parser.add_argument('--mix', choices=['all', 'study'], default='all',
+                        help='orders to give: a bit of everything, or only '
+                        'study, teach and produce (default all)')
+    parser.add_argument('--turns', type=int, default=3,
+                        help='turns to time (default 3)')
+    parser.add_argument('--threads', type=int, default=1,
+                        help='passed on to `atlantis run` (default 1)')
+    parser.add_argument('--seed', type=int, default=1,
+                        help='seed for the world, placing units and making '
+                        'orders')
+    parser.add_argument('--jobs', type=int, default=os.cpu_count(),
+                        help='worlds to make at once (default: one per '
+                        'CPU)')
+    parser.add_argument('--work', default=os.path.join(root, 'bench', 'work'),
+                        help='where worlds and orders are kept')
+    parser.add_argument('--output', default='bench-results.json',
+                        help='results file (default bench-results.json)')
+    parser.add_argument('--compare', nargs=2, metavar=('OLD', 'NEW'),
+                        help='compare two results files and stop')
+    opts = parser.parse_args()
+
+    if opts.compare:
+        compare(*opts.compare)
+        return
+    for game in opts.rulesets:
+        if game not in RULESETS and not os.path.isdir(os.path.join(root,
+                                                                   game)):
+            sys.exit('Unknown ruleset %s' % game)
+        if not os.access(engine(root, game), os.X_OK):
+            sys.exit('%s has not been built; try `make %s`' %
+                     (engine(root, game), game))
+
+    # Worlds not made before are made side by side, each in a directory
+    # of its own; the timed turns are run one at a time.
+    with concurrent.futures.ThreadPoolExecutor(opts.jobs) as pool:
+        made = [pool.submit(prepare, game, engine(root, game), opts)
+                for game in opts.rulesets]
+        for m in made:
+            m.result()
+
+    results = {
+        'build': describe_build(root),
+        'settings': {
+            'hexes': opts.hexes, 'factions': opts.factions,
+            'units': opts.units, 'items': opts.items,
+            'skills': opts.skills, 'mix': opts.mix,
+            'coverage': opts.coverage, 'turns': opts.turns,
+            'threads': opts.threads, 'seed': opts.seed,
+        },
+        'rulesets': {},
+    }
+    for game in opts.rulesets:
+        results['rulesets'][game] = bench(game, root, opts)
+    with open(opts.output, 'w') as f:
+        json.dump(results, f, indent=1)
+    print('Results written to %s' % opts.output)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+
+# Checks GROUPED_COMBAT against the normal per-soldier combat.
+#
+# Each of a handful of battles is fought --runs times with `atlantis
+# simbattle`, once soldier by soldier and once with --grouped, and the
+# results set side by side: how often each side won, and how many each
+# lost.  Grouped combat draws its results from the same distributions as
+# the normal rounds, so the two should only differ by chance; the
+# difference is given as a z score (a two-proportion test for the wins,
+# Welch's test for the losses), and the check fails if any is beyond
+# --limit.  The time each took is printed too.
+#
+#   python3 bench/grouped.py                     # standard/standard
+#   python3 bench/grouped.py --runs 2000 --volleys 8
+
+import argparse
+import math
+import os
+import re
+import sys
+
+import bench
+
+# name: (spec, runs as a share of --runs)
+BATTLES = {
+    'infantry': ("""; Swordsmen against a larger militia
+terrain plain
+attackers
+unit
+item 400 VIKI
+item 400 SWOR
+defenders
+unit
+item 600 PLAI
+item 600 SPEA
+""", 1),
+    'mixed': ("""; Swordsmen and archers against undead and a mage in a tower
+terrain forest
+attackers
+unit
+item 200 VIKI
+item 200 SWOR
+item 200 LARM
+skill COMB 2
+unit
+item 100 PLAI
+item 100 LBOW
+skill LBOW 3
+behind
+defenders
+unit
+item 300 SKEL
+unit
+item 1 LEAD
+skill FORC 3
+skill FIRE 3
+combat FIRE
+building tower
+""", 1),
+    'cavalry': ("""; Cavalry against longbows, some behind a fort wall
+terrain plain
+attackers
+unit
+item 300 BARB
+item 300 SWOR
+item 300 HORS
+skill COMB 2
+skill RIDI 2
+defenders
+unit
+item 200 HDWA
+item 200 LBOW
+skill LBOW 2
+building fort
+unit
+item 200 PLAI
+item 100 SPEA
+item 100 LARM
+""", 1),
+    'horde': ("""; A very large militia against as many skeletons
+terrain plain
+attackers
+unit
+item 10000 PLAI
+item 10000 SPEA
+skill COMB 1
+defenders
+unit
+item 10000 SKEL
+""", 0.1),
+}
+
+WON = re.compile(r'Attackers won ([\d.]+)%, defenders won ([\d.]+)%')
+LOST = re.compile(r'(\w+) lost ([\d.]+) of \d+ on average \(sd ([\d.]+)')
+TIME = re.compile(r'Fought \d+ battles in ([\d.]+) s')
+
+
+def fight(binary, spec, runs, seed, volleys, wdir):
+    """The results of simbattle, as a dict."""
+    args = ['simbattle', spec, '--runs', str(runs), '--seed', str(seed),
+            '--grouped', str(volleys)]
+    out, _ = bench.run(binary, args, wdir)
+    won = WON.search(out)
+    res = {'runs': runs, 'time': float(TIME.search(out).group(1)),
+           'Attackers won': float(won.group(1)) / 100,
+           'Defenders won': float(won.group(2)) / 100}
+    for side, mean, sd in LOST.findall(out):
+        res[side + ' lost'] = (float(mean), float(sd))
+    return res
+
+
+def wins_z(p1, p2, n):
+    """z of the difference of two shares of n tries each."""
+    p = (p1 + p2) / 2
+    se = math.sqrt(2 * p * (1 - p) / n)
+    return (p1 - p2) / se if se else 0.0
+
+
+def mean_z(a, b, n):
+    """z of the difference of two means of n samples each."""
+    se = math.sqrt((a[1] ** 2 + b[1] ** 2) / n)
+    return (a[0] - b[0]) / se if se else 0.0
+
+
+def main():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    parser = argparse.ArgumentParser(
+        description='Compare grouped combat with per-soldier combat.')
+    parser.add_argument('engine', nargs='?',
+                        default=bench.engine(root, 'standard'),
+                        help='engine to use (default: standard/standard)')
+    parser.add_argument('--runs', type=int, default=500,
+                        help='times to fight each battle (default 500)')
+    parser.add_argument('--volleys', type=int, default=16,
+                        help='GROUPED_COMBAT to check (default 16)')
+    parser.add_argument('--seed', type=int, default=1,
+                        help='seed for the battles')
+    parser.add_argument('--limit', type=float, default=3.0,
+                        help='largest z score that passes (default 3)')
+    parser.add_argument('--work', default=os.path.join(root, 'bench', 'work'),
+                        help='where the battle specs are written')
+    opts = parser.parse_args()
+
+    binary = os.path.abspath(opts.engine)
+    if not os.access(binary, os.X_OK):
+        sys.exit('%s has not been built' % binary)
+    wdir = os.path.join(opts.work, 'grouped')
+    os.makedirs(wdir, exist_ok=True)
+
+    worst = 0.0
+    for name, (text, share) in BATTLES.items():
+        spec = os.path.join(wdir, name + '.txt')
+        with open(spec, 'w') as f:
+            f.write(text)
+        runs = max(20, int(opts.runs * share))
+        one = fight(binary, spec, runs, opts.seed, 0, wdir)
+        grouped = fight(binary, spec, runs, opts.seed + 1, opts.volleys,
+                        wdir)
+        print('%s: %d battles, %.2f s soldier by soldier, %.2f s grouped' %
+              (name, runs, one['time'], grouped['time']))
+        for key in ('Attackers won', 'Defenders won'):
+            z = wins_z(one[key], grouped[key], runs)
+            worst = max(worst, abs(z))
+            print('  %-14s %6.1f%% %6.1f%%   z %5.2f' %
+                  (key, one[key] * 100, grouped[key] * 100, z))
+        for key in ('Attackers lost', 'Defenders lost'):
+            z = mean_z(one[key], grouped[key], runs)
+            worst = max(worst, abs(z))
+            print('  %-14s %7.1f %7.1f   z %5.2f' %
+                  (key, one[key][0], grouped[key][0], z))
+
+    if worst > opts.limit:
+        sys.exit('grouped combat differs from per-soldier combat '
+                 '(largest z %.2f)' % worst)
+    print('largest z %.2f, within %.1f' % (worst, opts.limit))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,286 @@
+// START A3HEADER
+//
+// This source file is part of the Atlantis PBM game program.
+// Copyright (C) 1995-1999 Geoff Dunbar
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program, in the file license.txt. If not, write
+// to the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+//
+// See the Atlantis Project web page for details:
+// http://www.prankster.com/project
+//
+// END A3HEADER
+
+//
+// Micro-benchmarks of the engine's data structures.  This is linked
+// with the engine and a ruleset by `make bench-micro`:
+//
+//   bench/micro                  every case at its usual sizes
+//   bench/micro regions 40000    one case at the sizes given
+//
+// Each case prints the time per operation.  The cases only use parts of
+// the engine that have been there a long time, so this file can also be
+// built against an older tree to compare before and after.
+//
+#include "aregion.h"
+#include "gamedata.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef void (*BenchFunc)(void *data, int times);
+
+static double Now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//
+// Runs func more and more times until it takes a fifth of a second;
+// returns the nanoseconds each time took.
+//
+static double Time(BenchFunc func, void *data)
+{
+    int times = 1;
+    for (;;) {
+        double start = Now();
+        func(data, times);
+        double took = Now() - start;
+        if (took > 0.2 || times >= (1 << 30)) return took * 1e9 / times;
+        times *= (took < 0.02) ? 10 : 2;
+    }
+}
+
+// Numbers that look random enough, the same on every run
+static unsigned int Next(unsigned int &seed)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+//
+// ARegionList::GetRegion(int), as used by order parsing, spells, gates
+// and the editor, on a list of n regions.
+//
+struct RegionsBench {
+    ARegionList *regions;
+    int num;
+    unsigned int seed;
+};
+
+static void LookupRegions(void *data, int times)
+{
+    RegionsBench *b = (RegionsBench *) data;
+    for (int i = 0; i < times; i++) {
+        ARegion *r = b->regions->GetRegion(Next(b->seed) % b->num);
+        if (!r) abort();
+    }
+}
+
+static void BenchRegions(int n)
+{
+    RegionsBench b;
+    b.regions = new ARegionList;
+    b.num = n;
+    b.seed = 1;
+    for (int i = 0; i < n; i++) {
+        ARegion *r = new ARegion;
+        r->num = i;
+        b.regions->Add(r);
+    }
+    printf("regions %6d: GetRegion %10.1f ns\n", n, Time(LookupRegions, &b));
+    delete b.regions;
+}
+
+//
+// A forlist_safe loop over n elements the size of a unit, as in the
+// steal and deletion phases: once just looking at each, and once taking
+// out every other one as it goes (they are put back afterwards).
+//
+class ListBenchElem : public AListElem {
+    public:
+        char data[400];
+};
+
+static void WalkSafe(void *data, int times)
+{
+    AList *list = (AList *) data;
+    for (int i = 0; i < times; i++) {
+        forlist_safe(list) {
+            ((ListBenchElem *) elem)->data[0]++;
+        }
+    }
+}
+
+static void RemoveSafe(void *data, int times)
+{
+    AList *list = (AList *) data;
+    AList removed;
+    for (int i = 0; i < times; i++) {
+        int odd = 0;
+        {
+            forlist_safe(list) {
+                if (odd) {
+                    list->Remove(elem);
+                    removed.Add(elem);
+                }
+                odd = !odd;
+            }
+        }
+        while (removed.First()) {
+            AListElem *e = removed.First();
+            removed.Remove(e);
+            list->Add(e);
+        }
+    }
+}
+
+static void BenchSafeList(int n)
+{
+    AList list;
+    for (int i = 0; i < n; i++) list.Add(new ListBenchElem);
+    double walk = Time(WalkSafe, &list) / n;
+    double remove = Time(RemoveSafe, &list) / n;
+    printf("safelist %5d: per element %8.1f ns, removing half %10.1f ns\n",
+            n, walk, remove);
+}
+
+//
+// ItemList::GetNum on lists of n items, looking for items that are in
+// the list half the time, and the heap used by 10000 such lists.
+//
+struct ItemsBench {
+    ItemList *items;
+    int num;
+    unsigned int seed;
+};
+
+static void GetItems(void *data, int times)
+{
+    ItemsBench *b = (ItemsBench *) data;
+    int total = 0;
+    for (int i = 0; i < times; i++) {
+        int type = (Next(b->seed) % (2 * b->num)) * 3 % NITEMS;
+        total += b->items->GetNum(type);
+    }
+    if (total < 0) abort();
+}
+
+static void BenchItems(int n)
+{
+    int numlists = 10000;
+    ItemList **lists = new ItemList *[numlists];
+    size_t before = mallinfo2().uordblks;
+    for (int l = 0; l < numlists; l++) {
+        lists[l] = new ItemList;
+        for (int i = 0; i < n; i++) lists[l]->SetNum(i * 3 % NITEMS, i + 1);
+    }
+    size_t used = mallinfo2().uordblks - before;
+
+    ItemsBench b;
+    b.items = lists[0];
+    b.num = n;
+    b.seed = 1;
+    printf("items %5d: GetNum %8.1f ns, %8.1f bytes per list\n", n,
+            Time(GetItems, &b), (double) used / numlists);
+    for (int l = 0; l < numlists; l++) delete lists[l];
+    delete [] lists;
+}
+
+//
+// SkillList::GetDays on lists of n skills, as in studying, teaching and
+// production, again looking for skills that are there half the time, and
+// the heap used by 10000 such lists.
+//
+struct SkillsBench {
+    SkillList *skills;
+    int num;
+    unsigned int seed;
+};
+
+static void GetSkills(void *data, int times)
+{
+    SkillsBench *b = (SkillsBench *) data;
+    int total = 0;
+    for (int i = 0; i < times; i++) {
+        int type = (Next(b->seed) % (2 * b->num)) * 3 % NSKILLS;
+        total += b->skills->GetDays(type);
+    }
+    if (total < 0) abort();
+}
+
+static void BenchSkills(int n)
+{
+    int numlists = 10000;
+    SkillList **lists = new SkillList *[numlists];
+    size_t before = mallinfo2().uordblks;
+    for (int l = 0; l < numlists; l++) {
+        lists[l] = new SkillList;
+        for (int i = 0; i < n; i++)
+            lists[l]->SetDays(i * 3 % NSKILLS, 30 * (i + 1));
+    }
+    size_t used = mallinfo2().uordblks - before;
+
+    SkillsBench b;
+    b.skills = lists[0];
+    b.num = n;
+    b.seed = 1;
+    printf("skills %4d: GetDays %8.1f ns, %8.1f bytes per list\n", n,
+            Time(GetSkills, &b), (double) used / numlists);
+    for (int l = 0; l < numlists; l++) delete lists[l];
+    delete [] lists;
+}
+
+struct BenchCase {
+    char const *name;
+    void (*run)(int n);
+    int sizes[4];
+};
+
+static BenchCase cases[] = {
+    { "regions", BenchRegions, { 1000, 10000, 40000, 0 } },
+    { "safelist", BenchSafeList, { 10, 100, 1000, 10000 } },
+    { "items", BenchItems, { 1, 2, 8, 32 } },
+    { "skills", BenchSkills, { 1, 3, 8, 20 } },
+};
+
+int main(int argc, char *argv[])
+{
+    int numcases = sizeof(cases) / sizeof(cases[0]);
+    int found = 0;
+    for (int c = 0; c < numcases; c++) {
+        if (argc > 1 && strcmp(argv[1], cases[c].name)) continue;
+        found = 1;
+        if (argc > 2) {
+            for (int i = 2; i < argc; i++) cases[c].run(atoi(argv[i]));
+        } else {
+            for (int i = 0; i < 4 && cases[c].sizes[i]; i++)
+                cases[c].run(cases[c].sizes[i]);
+        }
+    }
+    if (!found) {
+        fprintf(stderr, "usage: micro [case [size...]]\ncases:");
+        for (int c = 0; c < numcases; c++)
+            fprintf(stderr, " %s", cases[c].name);
+        fprintf(stderr, "\n");
+        return 1;
+    }
+    return 0;
+}
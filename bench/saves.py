@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+
+# Times loading and saving a large game in the text and binary formats.
+#
+# This makes a world the way bench.py does, converts its first turn to
+# both save formats with `atlantis convert`, and runs the turn --repeat
+# times from each.  A game is saved in the format it was read in, so
+# the median wall times of the "Reading the Game File" and "Saving the
+# Game File" phases of turnprofile.json give the load and save times of
+# each format.  They are printed with the size of each file.
+#
+# The binary file converted back to text must match the text file, and
+# the turn must write the same reports from either; a warning is printed
+# when they do not.
+#
+#   python3 bench/saves.py                       # standard/standard
+#   python3 bench/saves.py --hexes 40000 --units 4
+
+import argparse
+import hashlib
+import json
+import os
+import shutil
+import sys
+
+import bench
+
+LOAD = 'Reading the Game File'
+SAVE = 'Saving the Game File'
+
+
+def convert(binary, src, dst, fmt):
+    """Converts the game in src to fmt, leaving it as dst/game.in."""
+    shutil.rmtree(dst, ignore_errors=True)
+    shutil.copytree(src, dst)
+    bench.run(binary, ['convert', fmt], dst)
+    os.replace(os.path.join(dst, 'game.out'), os.path.join(dst, 'game.in'))
+
+
+def digest(path):
+    with open(path, 'rb') as f:
+        return hashlib.sha1(f.read()).hexdigest()
+
+
+def turn(binary, gdir, odir, rundir):
+    """Runs the turn once; returns the load and save times and a digest
+    of the reports."""
+    shutil.rmtree(rundir, ignore_errors=True)
+    shutil.copytree(gdir, rundir)
+    for name in os.listdir(odir):
+        shutil.copy(os.path.join(odir, name), rundir)
+    bench.run(binary, ['run'], rundir)
+    with open(os.path.join(rundir, 'turnprofile.json')) as f:
+        profile = json.load(f)
+    times = dict((p['name'], p['wall_ms']) for p in profile['phases'])
+    reports = hashlib.sha1()
+    for name in sorted(os.listdir(rundir)):
+        if name.startswith('report.'):
+            with open(os.path.join(rundir, name), 'rb') as f:
+                reports.update(f.read())
+    return times.get(LOAD, 0), times.get(SAVE, 0), reports.hexdigest()
+
+
+def main():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    parser = argparse.ArgumentParser(
+        description='Time loading and saving a game in each format.')
+    parser.add_argument('engine', nargs='?',
+                        default=bench.engine(root, 'standard'),
+                        help='engine to time (default: standard/standard)')
+    parser.add_argument('--repeat', type=int, default=3,
+                        help='times to run the turn from each format '
+                        '(default 3)')
+    parser.add_argument('--hexes', type=int, default=16000,
+                        help='surface hexes in the world (default 16000)')
+    parser.add_argument('--factions', type=int, default=40,
+                        help='player factions (default 40)')
+    parser.add_argument('--units', type=int, default=2,
+                        help='units in each populated region (default 2)')
+    parser.add_argument('--seed', type=int, default=1,
+                        help='seed for the world, placing units and making '
+                        'orders')
+    parser.add_argument('--work', default=os.path.join(root, 'bench', 'work'),
+                        help='where worlds and orders are kept')
+    opts = parser.parse_args()
+    # The rest of the world settings bench.py wants
+    opts.items = 3
+    opts.coverage = 0.5
+    opts.skills = 0
+    opts.mix = 'all'
+
+    if not os.access(opts.engine, os.X_OK):
+        sys.exit('%s has not been built' % opts.engine)
+
+    game = os.path.basename(opts.engine)
+    wdir, info = bench.prepare(game, opts.engine, opts)
+    start = os.path.join(wdir, 'start')
+    odir = os.path.join(wdir, 'orders', '1')
+    rundir = os.path.join(wdir, 'run')
+    formats = {}
+    for fmt in ('text', 'binary'):
+        formats[fmt] = os.path.join(wdir, fmt)
+        convert(opts.engine, start, formats[fmt], fmt)
+    back = os.path.join(wdir, 'back')
+    convert(opts.engine, formats['binary'], back, 'text')
+    same = (digest(os.path.join(back, 'game.in')) ==
+            digest(os.path.join(formats['text'], 'game.in')))
+    shutil.rmtree(back)
+
+    print('%s: %d units' % (game, info['units_placed']))
+    print('%-8s %12s %10s %10s' % ('format', 'bytes', 'load ms',
+                                   'save ms'))
+    reports = set()
+    for fmt in ('text', 'binary'):
+        loads, saves = [], []
+        for _ in range(opts.repeat):
+            load, save, d = turn(opts.engine, formats[fmt], odir, rundir)
+            loads.append(load)
+            saves.append(save)
+            reports.add(d)
+        size = os.path.getsize(os.path.join(formats[fmt], 'game.in'))
+        print('%-8s %12d %10.1f %10.1f' % (fmt, size, bench.median(loads),
+                                           bench.median(saves)))
+    shutil.rmtree(rundir, ignore_errors=True)
+    if not same:
+        print('warning: the binary game converted back to text is not the '
+              'same as the text game')
+    if len(reports) > 1:
+        print('warning: the two formats did not give the same reports')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+
+# Times the region-local phases of a turn with more and more threads.
+#
+# This makes a world the way bench.py does, by default a large one where
+# every unit studies, teaches or produces, and switches it over to
+# per-region random streams with `atlantis edit`, as `atlantis run
+# --threads` only spreads regions over threads in such games.  The first
+# turn is then run --repeat times at each of the --threads counts, and
+# the median wall time of the whole turn and of the phases that run on
+# the thread pool (PILLAGE, TAX and the month-long orders) printed with
+# the speedup over the first count.
+#
+# Every thread count must write exactly the same game and reports; a
+# warning is printed when they do not.  Running more threads than there
+# are CPUs cannot make the phases faster, so the CPU count is printed
+# too.
+#
+#   python3 bench/threads.py                     # 1, 2, 4 and 8 threads
+#   python3 bench/threads.py --threads 1,16 --hexes 40000
+
+import argparse
+import hashlib
+import json
+import os
+import shutil
+import sys
+
+import bench
+
+PHASES = ['Running PILLAGE Orders', 'Running TAX Orders',
+          'Running Month-long Orders']
+
+
+def streamed(binary, wdir):
+    """A copy of the world's first turn using per-region random streams."""
+    sdir = os.path.join(wdir, 'streams')
+    if os.path.exists(os.path.join(sdir, 'game.in')):
+        return sdir
+    shutil.rmtree(sdir, ignore_errors=True)
+    shutil.copytree(os.path.join(wdir, 'start'), sdir)
+    bench.run(binary, ['edit'], sdir, stdin='4\nx\n')
+    os.replace(os.path.join(sdir, 'game.out'), os.path.join(sdir, 'game.in'))
+    return sdir
+
+
+def turn(binary, sdir, odir, rundir, threads):
+    """Runs the turn once; returns its phase times and a digest of the
+    files it wrote."""
+    shutil.rmtree(rundir, ignore_errors=True)
+    shutil.copytree(sdir, rundir)
+    for name in os.listdir(odir):
+        shutil.copy(os.path.join(odir, name), rundir)
+    bench.run(binary, ['run', '--threads', str(threads)], rundir)
+    with open(os.path.join(rundir, 'turnprofile.json')) as f:
+        profile = json.load(f)
+    local = sum(p['wall_ms'] for p in profile['phases']
+                if p['name'] in PHASES)
+    digest = hashlib.sha1()
+    for name in sorted(os.listdir(rundir)):
+        if name == 'game.out' or name.startswith('report.'):
+            with open(os.path.join(rundir, name), 'rb') as f:
+                digest.update(f.read())
+    return profile['total']['wall_ms'], local, digest.hexdigest()
+
+
+def main():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    parser = argparse.ArgumentParser(
+        description='Time the threaded phases of a turn at several '
+        'thread counts.')
+    parser.add_argument('engine', nargs='?',
+                        default=bench.engine(root, 'standard'),
+                        help='engine to time (default: standard/standard)')
+    parser.add_argument('--threads', default='1,2,4,8',
+                        help='thread counts, comma separated (default '
+                        '1,2,4,8)')
+    parser.add_argument('--repeat', type=int, default=3,
+                        help='times to run the turn at each count '
+                        '(default 3)')
+    parser.add_argument('--hexes', type=int, default=16000,
+                        help='surface hexes in the world (default 16000)')
+    parser.add_argument('--factions', type=int, default=40,
+                        help='player factions (default 40)')
+    parser.add_argument('--units', type=int, default=4,
+                        help='units in each populated region (default 4)')
+    parser.add_argument('--mix', choices=['all', 'study'], default='study',
+                        help='orders to give, as for bench.py (default '
+                        'study)')
+    parser.add_argument('--seed', type=int, default=1,
+                        help='seed for the world, placing units and making '
+                        'orders')
+    parser.add_argument('--work', default=os.path.join(root, 'bench', 'work'),
+                        help='where worlds and orders are kept')
+    opts = parser.parse_args()
+    # The rest of the world settings bench.py wants
+    opts.items = 3
+    opts.coverage = 0.5
+    opts.skills = 0
+
+    if not os.access(opts.engine, os.X_OK):
+        sys.exit('%s has not been built' % opts.engine)
+    counts = [int(n) for n in opts.threads.split(',')]
+
+    game = os.path.basename(opts.engine)
+    wdir, info = bench.prepare(game, opts.engine, opts)
+    sdir = streamed(opts.engine, wdir)
+    odir = os.path.join(wdir, 'orders', '1')
+    rundir = os.path.join(wdir, 'run')
+
+    print('%s: %d units, %d CPUs' % (game, info['units_placed'],
+                                     os.cpu_count()))
+    print('%8s %12s %8s %14s %8s' % ('threads', 'turn ms', 'speedup',
+                                     'threaded ms', 'speedup'))
+    first = None
+    digests = set()
+    for n in counts:
+        walls, locals_ = [], []
+        for _ in range(opts.repeat):
+            wall, local, digest = turn(opts.engine, sdir, odir, rundir, n)
+            walls.append(wall)
+            locals_.append(local)
+            digests.add(digest)
+        wall, local = bench.median(walls), bench.median(locals_)
+        if first is None:
+            first = (wall, local)
+        print('%8d %12.1f %7.2fx %14.1f %7.2fx' %
+              (n, wall, first[0] / wall, local,
+               first[1] / local if local else 0))
+    shutil.rmtree(rundir, ignore_errors=True)
+    if len(digests) > 1:
+        print('warning: the thread counts did not all write the same game '
+              'and reports')
+
+
+if __name__ == '__main__':
+    main()
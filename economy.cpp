@@ -810,7 +810,8 @@ void ARegion::AddTown(int size, AString * name)
         if (obj->type == O_DUMMY) continue;
         if ((ObjectDefs[obj->type].monster != -1)
             && (!(ObjectDefs[obj->type].flags & ObjectType::CANENTER))) {
-                obj->units.Empty();
+                forlist(&obj->units)
+                    ((Unit *) elem)->MoveUnit(0);
                 objects.Remove(obj);
         }
     }
@@ -1099,11 +1100,14 @@ int ARegion::TownHabitat()
     forlist(&objects) {
         Object *obj = (Object *) elem;
         if (ObjectDefs[obj->type].protect > fort) fort = ObjectDefs[obj->type].protect;
-        if (ItemDefs[ObjectDefs[obj->type].productionAided].flags & IT_FOOD) farm++;
-        if (ObjectDefs[obj->type].productionAided == I_SILVER) inn++;
-        if (ObjectDefs[obj->type].productionAided == I_HERBS) temple++;
+        int aided = ObjectDefs[obj->type].productionAided;
+        // Most objects aid no production (-1)
+        if (aided < 0) continue;
+        if (ItemDefs[aided].flags & IT_FOOD) farm++;
+        if (aided == I_SILVER) inn++;
+        if (aided == I_HERBS) temple++;
         if ((ObjectDefs[obj->type].flags & ObjectType::TRANSPORT)
-            && (ItemDefs[ObjectDefs[obj->type].productionAided].flags & IT_MOUNT)) caravan++;
+            && (ItemDefs[aided].flags & IT_MOUNT)) caravan++;
     }
     int hab = 2;
     int step = 0;
@@ -22,6 +22,10 @@ int Game::EditGame(int *pSaveGame)
         Awrite("  1) Find a region...");
         Awrite("  2) Find a unit...");
         Awrite("  3) Create a new unit...");
+        if (randomstreams())
+            Awrite("  4) Use one game-wide random sequence.");
+        else
+            Awrite("  4) Use per-region random streams.");
         Awrite("  qq) Quit without saving.");
         Awrite("  x) Exit and save.");
         Awrite("> ");
@@ -43,6 +47,8 @@ int Game::EditGame(int *pSaveGame)
             EditGameFindUnit();
         } else if (*pStr == "3") {
             EditGameCreateUnit();            
+        } else if (*pStr == "4") {
+            setrandomstreams(!randomstreams());
         } else {
             Awrite("Select from the menu.");
         }
@@ -1260,7 +1266,11 @@ void Game::EditGameUnitDetails(Unit *pUnit)
                     }
                     
                     Faction *fac = GetFaction(&factions, fnum);
-                    if (fac) pUnit->faction = fac;
+                    if (fac) {
+                        pUnit->faction = fac;
+                        if (pUnit->object)
+                            pUnit->object->region->InvalidateSight();
+                    }
                     else Awrite("Cannot Find Faction");
                 }
                 else if (*pToken == "t") { 
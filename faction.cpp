@@ -54,6 +54,18 @@ char const *tp[] = {
 
 char const **TemplateStrs = tp;
 
+// The buffer faction output on this thread goes to, if any
+static thread_local FactionOutput *capturing = 0;
+
+class FactionRecord : public AListElem {
+public:
+    Faction *fac;
+    int type;
+    AString text;
+    int a, b, c;
+    Battle *battle;
+};
+
 int ParseTemplate(AString *token)
 {
     for (int i = 0; i < NTEMPLATES; i++)
@@ -130,6 +142,8 @@ Faction::Faction()
     temformat = TEMPLATE_OFF;
     quit = 0;
     defaultattitude = A_NEUTRAL;
+    attitudetable = 0;
+    attitudetablesize = 0;
     unclaimed = 0;
     pReg = NULL;
     pStartLoc = NULL;
@@ -153,6 +167,8 @@ Faction::Faction(int n)
     showunitattitudes = 0;
     temformat = TEMPLATE_LONG;
     defaultattitude = A_NEUTRAL;
+    attitudetable = 0;
+    attitudetablesize = 0;
     quit = 0;
     unclaimed = 0;
     pReg = NULL;
@@ -167,10 +183,12 @@ Faction::~Faction()
     if (address) delete address;
     if (password) delete password;
     attitudes.DeleteAll();
+    delete [] attitudetable;
 }
 
 void Faction::Writeout(Aoutfile *f)
 {
+    f->StartSection(SECTION_FACTION);
     f->PutInt(num);
 
     for (int i=0; i<NFACTYPES; i++) f->PutInt(type[i]);
@@ -190,10 +208,12 @@ void Faction::Writeout(Aoutfile *f)
     f->PutInt(defaultattitude);
     f->PutInt(attitudes.Num());
     forlist((&attitudes)) ((Attitude *) elem)->Writeout(f);
+    f->EndSection();
 }
 
 void Faction::Readin(Ainfile *f, ATL_VER v)
 {
+    f->StartSection(SECTION_FACTION);
     num = f->GetInt();
     int i;
 
@@ -218,12 +238,20 @@ void Faction::Readin(Ainfile *f, ATL_VER v)
     for (i=0; i<n; i++) {
         Attitude* a = new Attitude;
         a->Readin(f, v);
-        if (a->factionnum == num) delete a;
-        else attitudes.Add(a);
+        if (a->factionnum == num) {
+            delete a;
+        } else {
+            // Only the first of any duplicates counts, as it always has
+            if (a->factionnum < 0 || a->factionnum >= attitudetablesize ||
+                    attitudetable[a->factionnum] == -1)
+                SetAttitudeTable(a->factionnum, a->attitude);
+            attitudes.Add(a);
+        }
     }
 
     // if (skills.GetDays(S_BUILDING) > 1)
     //    shows.Add(new ShowSkill(S_BUILDING, 2));
+    f->EndSection();
 }
 
 void Faction::View()
@@ -639,6 +667,10 @@ void Faction::CheckExist(ARegionList* regs)
 void Faction::Error(const AString &s)
 {
     if (IsNPC()) return;
+    if (capturing) {
+        capturing->Add(this, FactionOutput::ERROR, &s);
+        return;
+    }
     if (errors.Num() > 1000) {
         if (errors.Num() == 1001) {
             errors.Add(new AString("Too many errors!"));
@@ -653,6 +685,10 @@ void Faction::Error(const AString &s)
 void Faction::Event(const AString &s)
 {
     if (IsNPC()) return;
+    if (capturing) {
+        capturing->Add(this, FactionOutput::EVENT, &s);
+        return;
+    }
     AString *temp = new AString(s);
     events.Add(temp);
 }
@@ -664,6 +700,7 @@ void Faction::RemoveAttitude(int f)
         if (a->factionnum == f) {
             attitudes.Remove(a);
             delete a;
+            ResetAttitudeTable(f);
             return;
         }
     }
@@ -672,12 +709,42 @@ void Faction::RemoveAttitude(int f)
 int Faction::GetAttitude(int n)
 {
     if (n == num) return A_ALLY;
+    if (n >= 0 && n < attitudetablesize && attitudetable[n] != -1)
+        return attitudetable[n];
+    return defaultattitude;
+}
+
+// Record a declared attitude (or -1 for none) in attitudetable
+void Faction::SetAttitudeTable(int n, int att)
+{
+    if (n < 0) return;
+    if (n >= attitudetablesize) {
+        if (att == -1) return;
+        int size = attitudetablesize ? attitudetablesize : 16;
+        while (size <= n) size *= 2;
+        int *temp = new int[size];
+        int i;
+        for (i = 0; i < attitudetablesize; i++) temp[i] = attitudetable[i];
+        for (; i < size; i++) temp[i] = -1;
+        delete [] attitudetable;
+        attitudetable = temp;
+        attitudetablesize = size;
+    }
+    attitudetable[n] = att;
+}
+
+// Set attitudetable from the first attitude to faction n still in the
+// list; a game file can hold more than one
+void Faction::ResetAttitudeTable(int n)
+{
     forlist((&attitudes)) {
         Attitude *a = (Attitude *) elem;
-        if (a->factionnum == n)
-            return a->attitude;
+        if (a->factionnum == n) {
+            SetAttitudeTable(n, a->attitude);
+            return;
+        }
     }
-    return defaultattitude;
+    SetAttitudeTable(n, -1);
 }
 
 void Faction::SetAttitude(int num, int att)
@@ -688,11 +755,12 @@ void Faction::SetAttitude(int num, int att)
             if (att == -1) {
                 attitudes.Remove(a);
                 delete a;
-                return;
+                ResetAttitudeTable(num);
             } else {
                 a->attitude = att;
-                return;
+                SetAttitudeTable(num, att);
             }
+            return;
         }
     }
     if (att != -1) {
@@ -700,6 +768,7 @@ void Faction::SetAttitude(int num, int att)
         a->factionnum = num;
         a->attitude = att;
         attitudes.Add(a);
+        SetAttitudeTable(num, att);
     }
 }
 
@@ -722,56 +791,51 @@ int Faction::CanCatch(ARegion *r, Unit *t)
 
 int Faction::CanSee(ARegion* r, Unit* u, int practice)
 {
-    int detfac = 0;
+    ProfileCount(PROFILE_CANSEE);
     if (u->faction == this) return 2;
     if (u->reveal == REVEAL_FACTION) return 2;
     int retval = 0;
     if (u->reveal == REVEAL_UNIT) retval = 1;
     if (u->guard == GUARD_GUARD) retval = 1;
-    forlist((&r->objects)) {
-        Object* obj = (Object *) elem;
-        int dummy = 0;
-        if (obj->type == O_DUMMY) dummy = 1;
-        forlist((&obj->units)) {
-            Unit* temp = (Unit *) elem;
-            if (u == temp && dummy == 0) retval = 1;
-
-            // penalty of 2 to stealth if assassinating and 1 if stealing
-            // TODO: not sure about the reasoning behind the IMPROVED_AMTS part
-            int stealpenalty = 0;
-            if (Globals->HARDER_ASSASSINATION && u->stealorders){
-                if (u->stealorders->type == O_STEAL) {
-                    stealpenalty = 1;
-                } else if (u->stealorders->type == O_ASSASSINATE) {
-                    if (Globals->IMPROVED_AMTS){
-                        stealpenalty = 1;
-                    } else {
-                        stealpenalty = 2;
-                    }
-                }
+    if (u->object && u->object->region == r && u->object->type != O_DUMMY)
+        retval = 1;
+
+    FactionSight *fs = r->GetSight(this);
+    if (!fs) return retval;
+
+    // penalty of 2 to stealth if assassinating and 1 if stealing
+    // TODO: not sure about the reasoning behind the IMPROVED_AMTS part
+    int stealpenalty = 0;
+    if (Globals->HARDER_ASSASSINATION && u->stealorders){
+        if (u->stealorders->type == O_STEAL) {
+            stealpenalty = 1;
+        } else if (u->stealorders->type == O_ASSASSINATE) {
+            if (Globals->IMPROVED_AMTS){
+                stealpenalty = 1;
+            } else {
+                stealpenalty = 2;
             }
+        }
+    }
+    int stealth = u->GetAttribute(AT_STEALTH) - stealpenalty;
 
-            if (temp->faction == this) {
-                if (temp->GetAttribute("observation") >
-                        u->GetAttribute("stealth") - stealpenalty) {
-                    if (practice) {
-                        temp->PracticeAttribute("observation");
-                        retval = 2;
-                    }
-                    else
-                        return 2;
-                } else {
-                    if (temp->GetAttribute("observation") ==
-                            u->GetAttribute("stealth") - stealpenalty) {
-                        if (practice) temp->PracticeAttribute("observation");
-                        if (retval < 1) retval = 1;
-                    }
-                }
-                if (temp->GetSkill(S_MIND_READING) > 2) detfac = 1;
-            }
+    if (fs->observation > stealth) {
+        if (!practice) return 2;
+        retval = 2;
+    } else if (fs->observation == stealth) {
+        if (retval < 1) retval = 1;
+    }
+
+    // Every unit that could see the target gets to practice
+    if (practice && fs->observation >= stealth) {
+        for (int i = fs->first; i < fs->first + fs->count; i++) {
+            Unit *temp = r->sightunits[i].unit;
+            if (temp->GetAttribute(AT_OBSERVATION) >= stealth)
+                temp->PracticeAttribute(AT_OBSERVATION);
         }
     }
-    if (retval == 1 && detfac) return 2;
+
+    if (retval == 1 && fs->detfac) return 2;
     return retval;
 }
 
@@ -822,6 +886,12 @@ void Faction::DiscoverItem(int item, int force, int full)
     int seen, skill, i;
     AString skname;
 
+    if (capturing) {
+        capturing->Add(this, FactionOutput::DISCOVER_ITEM, 0, item, force,
+                full);
+        return;
+    }
+
     seen = items.GetNum(item);
     if (!seen) {
         if (full) {
@@ -859,3 +929,101 @@ void Faction::DiscoverItem(int item, int force, int full)
         }
     }
 }
+
+// Note that the faction has seen the skill report for each level of
+// skill up to level
+void Faction::DiscoverSkill(int skill, int level)
+{
+    if (capturing) {
+        capturing->Add(this, FactionOutput::DISCOVER_SKILL, 0, skill, level);
+        return;
+    }
+
+    int shown = skills.GetDays(skill);
+    while (level > shown) {
+        shown++;
+        skills.SetDays(skill, shown);
+        shows.Add(new ShowSkill(skill, shown));
+    }
+}
+
+// Include the battle in the faction's report
+void Faction::AddBattle(Battle *b)
+{
+    if (capturing) {
+        capturing->AddBattle(this, b);
+        return;
+    }
+
+    BattlePtr *p = new BattlePtr;
+    p->ptr = b;
+    battles.Add(p);
+}
+
+FactionOutput::FactionOutput()
+{
+}
+
+FactionOutput::~FactionOutput()
+{
+    records.DeleteAll();
+}
+
+void FactionOutput::Capture()
+{
+    capturing = this;
+}
+
+void FactionOutput::Release()
+{
+    capturing = 0;
+}
+
+void FactionOutput::Add(Faction *fac, int type, const AString *text,
+        int a, int b, int c)
+{
+    FactionRecord *rec = new FactionRecord;
+    rec->fac = fac;
+    rec->type = type;
+    if (text) rec->text = *text;
+    rec->a = a;
+    rec->b = b;
+    rec->c = c;
+    rec->battle = 0;
+    records.Add(rec);
+}
+
+void FactionOutput::AddBattle(Faction *fac, Battle *b)
+{
+    FactionRecord *rec = new FactionRecord;
+    rec->fac = fac;
+    rec->type = BATTLE;
+    rec->a = rec->b = rec->c = 0;
+    rec->battle = b;
+    records.Add(rec);
+}
+
+void FactionOutput::Replay()
+{
+    forlist(&records) {
+        FactionRecord *rec = (FactionRecord *) elem;
+        switch (rec->type) {
+            case EVENT:
+                rec->fac->Event(rec->text);
+                break;
+            case ERROR:
+                rec->fac->Error(rec->text);
+                break;
+            case DISCOVER_ITEM:
+                rec->fac->DiscoverItem(rec->a, rec->b, rec->c);
+                break;
+            case DISCOVER_SKILL:
+                rec->fac->DiscoverSkill(rec->a, rec->b);
+                break;
+            case BATTLE:
+                rec->fac->AddBattle(rec->battle);
+                break;
+        }
+    }
+    records.DeleteAll();
+}
@@ -118,6 +118,37 @@ public:
     Faction * ptr;
 };
 
+//
+// Faction output held back while a region is processed on a worker
+// thread.  Between Capture() and Release(), Faction::Event, Error,
+// DiscoverItem, DiscoverSkill and AddBattle on that thread are recorded
+// here instead of changing the faction.  Replay() then applies them, so when the
+// buffers are replayed in region order the factions end up exactly as
+// if the regions had been run one after another.
+//
+class FactionOutput {
+public:
+    FactionOutput();
+    ~FactionOutput();
+
+    void Capture();
+    void Release();
+    void Replay();
+
+    enum {
+        EVENT,
+        ERROR,
+        DISCOVER_ITEM,
+        DISCOVER_SKILL,
+        BATTLE
+    };
+    void Add(Faction *, int type, const AString *, int a = 0, int b = 0,
+            int c = 0);
+    void AddBattle(Faction *, Battle *);
+
+    AList records;
+};
+
 class Faction : public AListElem
 {
 public:
@@ -147,6 +178,8 @@ public:
     /* if attitude == -1, clear it */
     int GetAttitude(int);
     void RemoveAttitude(int);
+    void SetAttitudeTable(int,int);
+    void ResetAttitudeTable(int);
     
     int CanCatch(ARegion *,Unit *);
     /* Return 1 if can see, 2 if can see faction */
@@ -159,6 +192,8 @@ public:
     int IsNPC();
 
     void DiscoverItem(int item, int force, int full);
+    void DiscoverSkill(int skill, int level);
+    void AddBattle(Battle *);
 
     int num;
 
@@ -195,6 +230,10 @@ public:
     
     int defaultattitude;
     AList attitudes;
+    // The declared attitudes again, indexed by faction number, with -1
+    // where there is none.  Kept in step with attitudes.
+    int *attitudetable;
+    int attitudetablesize;
     SkillList skills;
     ItemList items;
     
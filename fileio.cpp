@@ -27,37 +27,220 @@
 
 #include <iostream>
 #include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 using namespace std;
 
 #define F_ENDLINE '\n'
 
+// Value tags in the binary save format
+#define TAG_INT 'I'
+#define TAG_STR 'S'
+#define TAG_SECTION '{'
+
+#define BINARY_MAGIC_LEN ((int) sizeof(BINARY_SAVE_MAGIC))
+
 extern long _ftype,_fcreator;
 
-static char buf[1024];
+// Text files are read this much at a time
+#define TEXT_BLOCK 65536
+
+Abuffer::Abuffer()
+{
+    file = 0;
+    buf = 0;
+    size = 0;
+    start = 0;
+    end = 0;
+    eof = 0;
+}
+
+Abuffer::~Abuffer()
+{
+    delete [] buf;
+}
+
+void Abuffer::Reset()
+{
+    if (!buf) {
+        size = TEXT_BLOCK + 1;
+        buf = new char[size];
+    }
+    start = 0;
+    end = 0;
+    eof = 0;
+    buf[0] = '\0';
+}
+
+// Moves whatever is left to the front of the buffer and reads another
+// block after it, growing the buffer when a single line has filled it.
+// Returns 0 once there is nothing more to read.
+int Abuffer::Fill()
+{
+    if (eof) return 0;
+    if (start > 0) {
+        memmove(buf, buf + start, end - start);
+        end -= start;
+        start = 0;
+    }
+    if (end + 1 >= size) {
+        char *temp = new char[size * 2];
+        memcpy(temp, buf, end);
+        delete [] buf;
+        buf = temp;
+        size *= 2;
+    }
+    file->read(buf + end, size - end - 1);
+    long n = file->gcount();
+    if (n <= 0) {
+        eof = 1;
+        return 0;
+    }
+    end += n;
+    // Keep a terminator after the data for the number parser
+    buf[end] = '\0';
+    return 1;
+}
+
+// What Ainfile and Aorders skip before a line
+static inline int iswhite(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\0';
+}
+
+// What operator>> skips before a number
+static inline int isspacechar(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' ||
+        c == '\f';
+}
+
+char *Abuffer::GetLine(int skip)
+{
+    if (skip) {
+        for (;;) {
+            while (start < end && iswhite(buf[start])) start++;
+            if (start < end || !Fill()) break;
+        }
+    }
+    if (start >= end && !Fill()) return 0;
+
+    long scanned = 0;
+    for (;;) {
+        char *nl = (char *) memchr(buf + start + scanned, F_ENDLINE,
+                end - start - scanned);
+        if (nl) {
+            char *line = buf + start;
+            *nl = '\0';
+            start = nl - buf + 1;
+            return line;
+        }
+        scanned = end - start;
+        if (!Fill()) break;
+    }
+    // The last line had no end of line
+    char *line = buf + start;
+    buf[end] = '\0';
+    start = end;
+    return line;
+}
+
+int Abuffer::GetInt()
+{
+    for (;;) {
+        while (start < end && isspacechar(buf[start])) start++;
+        if (start < end || !Fill()) break;
+    }
+    // Make sure a whole number is in the buffer
+    if (end - start < 16) Fill();
+
+    char *p = buf + start;
+    int neg = 0;
+    if (*p == '-' || *p == '+') neg = (*p++ == '-');
+    unsigned int x = 0;
+    while (*p >= '0' && *p <= '9') x = x * 10 + (*p++ - '0');
+    start = p - buf;
+    return neg ? -(int) x : (int) x;
+}
+
+char *nexttoken(char **line)
+{
+    char *p = *line;
+    while (*p == ' ' || *p == '\t') p++;
+    if (!*p || *p == ';') {
+        *line = p;
+        return 0;
+    }
+    char *token = p;
+    while (*p && *p != ' ' && *p != '\t' && *p != ';') p++;
+    if (*p == ';') *p = '\0'; // The rest of the line is a comment
+    else if (*p) *p++ = '\0';
+    *line = p;
+    return token;
+}
+
+int tokenvalue(char const *token)
+{
+    int ret = 0;
+    while (*token >= '0' && *token <= '9') {
+        ret *= 10;
+        // As AString::value, give up rather than overflow
+        if (ret < 0) return 0;
+        ret += *token++ - '0';
+    }
+    return ret;
+}
 
 Aoutfile::Aoutfile()
 {
     file = new ofstream;
+    binary = 0;
+    buffered = 0;
+    data = 0;
+    size = 0;
+    space = 0;
+    depth = 0;
 }
 
 Aoutfile::~Aoutfile()
 {
+    delete [] data;
     delete file;
 }
 
 Ainfile::Ainfile()
 {
     file = new ifstream;
+    text.file = file;
+    binary = 0;
+    version = 0;
+    damaged = 0;
+    scratch = 0;
+    scratchsize = 0;
+    data = 0;
+    size = 0;
+    pos = 0;
+    mapped = 0;
+    shared = 0;
+    depth = 0;
 }
 
 Ainfile::~Ainfile()
 {
+    if (binary) Close();
+    delete [] scratch;
     delete file;
 }
 
 Aorders::Aorders()
 {
     file = new ifstream;
+    text.file = file;
 }
 
 Aorders::~Aorders()
@@ -97,10 +280,11 @@ void Aoutfile::Open(const AString &s)
     }
 }
 
-int Aoutfile::OpenByName(const AString &s)
+int Aoutfile::OpenByName(const AString &s, int bin)
 {
     AString temp = s;
-    file->open(temp.Str(), ios::out|ios::ate);
+    file->open(temp.Str(), bin ? ios::out|ios::ate|ios::binary :
+            ios::out|ios::ate);
     if (!file->rdbuf()->is_open()) return -1;
     // Handle a broke ios::ate implementation on some boxes
     file->seekp(0, ios::end);
@@ -108,9 +292,24 @@ int Aoutfile::OpenByName(const AString &s)
         file->close();
         return -1;
     }
+    binary = bin;
+    if (binary) {
+        size = 0;
+        depth = 0;
+        PutBytes(BINARY_SAVE_MAGIC, BINARY_MAGIC_LEN);
+        PutRaw(BINARY_SAVE_VERSION);
+    }
     return 0;
 }
 
+void Aoutfile::OpenBuffer(int bin)
+{
+    binary = bin;
+    buffered = 1;
+    size = 0;
+    depth = 0;
+}
+
 void Ainfile::Open(const AString &s)
 {
     while (!(file->rdbuf()->is_open())) {
@@ -118,23 +317,105 @@ void Ainfile::Open(const AString &s)
         file->open(name->Str(),ios::in);
         delete name;
     }
+    text.Reset();
 }
 
 int Ainfile::OpenByName(const AString &s)
 {
     AString temp = s;
+    int i = OpenBinary(temp.Str());
+    if (i) return (i == 1) ? 0 : -1;
     file->open(temp.Str(),ios::in);
     if (!(file->rdbuf()->is_open())) return -1;
+    text.Reset();
     return 0;
 }
 
+void Ainfile::OpenPart(Ainfile *whole, long start, long end)
+{
+    binary = 1;
+    version = whole->version;
+    data = whole->data;
+    size = (end < whole->size) ? end : whole->size;
+    pos = (start < size) ? start : size;
+    shared = 1;
+    depth = 0;
+    damaged = 0;
+}
+
+// Maps the file into memory if it is in the binary save format.  Returns
+// 1 if it was, 0 if it is some other file (or can't be opened) and -1 if
+// it is a binary file we can't read.
+int Ainfile::OpenBinary(char const *name)
+{
+    char magic[BINARY_MAGIC_LEN];
+    struct stat st;
+
+    int fd = open(name, O_RDONLY);
+    if (fd == -1) return 0;
+    if (fstat(fd, &st) == -1 || st.st_size < BINARY_MAGIC_LEN + 4 ||
+            read(fd, magic, BINARY_MAGIC_LEN) != BINARY_MAGIC_LEN ||
+            memcmp(magic, BINARY_SAVE_MAGIC, BINARY_MAGIC_LEN)) {
+        close(fd);
+        return 0;
+    }
+
+    size = st.st_size;
+    data = (char *) mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    mapped = (data != (char *) MAP_FAILED);
+    if (!mapped) {
+        // Fall back to reading the whole file
+        data = new char[size];
+        long got = 0;
+        lseek(fd, 0, SEEK_SET);
+        while (got < size) {
+            long n = read(fd, data + got, size - got);
+            if (n <= 0) break;
+            got += n;
+        }
+        size = got;
+    }
+    close(fd);
+
+    binary = 1;
+    depth = 0;
+    damaged = 0;
+    pos = BINARY_MAGIC_LEN;
+    version = GetRaw();
+    if (version > BINARY_SAVE_VERSION) {
+        Awrite(AString("Binary save format version ") + version +
+                " is newer than this engine can read!");
+        Close();
+        return -1;
+    }
+    return 1;
+}
+
 void Aoutfile::Close()
 {
+    if (buffered) {
+        buffered = 0;
+        binary = 0;
+        size = 0;
+        return;
+    }
+    if (binary) {
+        file->write(data, size);
+        binary = 0;
+    }
     file->close();
 }
 
 void Ainfile::Close()
 {
+    if (binary) {
+        if (shared) shared = 0;
+        else if (mapped) munmap(data, size);
+        else delete [] data;
+        data = 0;
+        binary = 0;
+        return;
+    }
     file->close();
 }
 
@@ -153,58 +434,268 @@ void Arules::Close()
     file->close();
 }
 
-void skipwhite(ifstream *f)
+// A little-endian four byte integer at the read position
+int Ainfile::GetRaw()
 {
-    if (f->eof()) return;
-    int ch = f->peek();
-    while((ch == ' ') || (ch == '\n') || (ch == '\t') ||
-            (ch == '\r') || (ch == '\0')) {
-        f->get();
-        if (f->eof()) return;
-        ch = f->peek();
+    if (pos + 4 > size) {
+        pos = size;
+        return 0;
     }
+    unsigned char *p = (unsigned char *) data + pos;
+    pos += 4;
+    return (int) (p[0] | (p[1] << 8) | (p[2] << 16) |
+            ((unsigned int) p[3] << 24));
+}
+
+// A variable-length integer: seven bits to a byte, low bits first, with
+// the sign folded into the lowest bit so small negatives stay short.
+int Ainfile::GetVarint()
+{
+    unsigned int u = 0;
+    int shift = 0;
+    while (pos < size && shift < 35) {
+        unsigned char c = data[pos++];
+        u |= (unsigned int) (c & 0x7f) << shift;
+        if (!(c & 0x80)) break;
+        shift += 7;
+    }
+    return (int) ((u >> 1) ^ (0 - (u & 1)));
 }
 
 AString * Ainfile::GetStr()
 {
-    skipwhite(file);
-    if (file->peek() == -1 || file->eof()) return 0;
-    file->getline(buf,1023,F_ENDLINE);
-    AString * s = new AString((char *) &(buf[0]));
-    return s;
+    if (binary) {
+        if (pos >= size) return 0;
+        if (data[pos] == TAG_INT) {
+            pos++;
+            return new AString(GetVarint());
+        }
+        if (data[pos] != TAG_STR) return 0;
+        pos++;
+        int len = GetVarint();
+        if (len < 0 || pos + len > size) {
+            pos = size;
+            return 0;
+        }
+        AString *s = new AString(data + pos, len);
+        pos += len;
+        return s;
+    }
+    char *line = text.GetLine(1);
+    if (!line) return 0;
+    return new AString(line);
 }
 
 AString * Ainfile::GetStrNoSkip()
 {
-    if (file->peek() == -1 || file->eof()) return 0;
-    file->getline(buf,1023,F_ENDLINE);
-    AString * s = new AString((char *) &(buf[0]));
-    return s;
+    if (binary) return GetStr();
+    char *line = text.GetLine(0);
+    if (!line) return 0;
+    return new AString(line);
+}
+
+char *Ainfile::GetView()
+{
+    if (!binary) return text.GetLine(1);
+
+    if (pos >= size) return 0;
+    if (data[pos] == TAG_INT) {
+        pos++;
+        Scratch(16);
+        sprintf(scratch, "%d", GetVarint());
+        return scratch;
+    }
+    if (data[pos] != TAG_STR) return 0;
+    pos++;
+    int len = GetVarint();
+    if (len < 0 || pos + len > size) {
+        pos = size;
+        return 0;
+    }
+    // The mapping is read only, and callers may split the string up
+    Scratch(len + 1);
+    memcpy(scratch, data + pos, len);
+    scratch[len] = '\0';
+    pos += len;
+    return scratch;
+}
+
+void Ainfile::Scratch(int n)
+{
+    if (n <= scratchsize) return;
+    delete [] scratch;
+    scratchsize = n + 64;
+    scratch = new char[scratchsize];
 }
 
 int Ainfile::GetInt()
 {
-    int x;
-    *file >> x;
-    return x;
+    if (binary) {
+        if (pos < size && data[pos] == TAG_INT) {
+            pos++;
+            return GetVarint();
+        }
+        // Read a string as the number it starts with, as a text file
+        // would be
+        AString *s = GetStr();
+        if (!s) return 0;
+        int x = atoi(s->Str());
+        delete s;
+        return x;
+    }
+    return text.GetInt();
+}
+
+void Ainfile::StartSection(int type)
+{
+    if (!binary) return;
+    if (pos + 6 > size || data[pos] != TAG_SECTION ||
+            data[pos + 1] != type || depth == MAX_SECTION_DEPTH) {
+        // Not where we expected a section; leave the reads to fail
+        damaged = 1;
+        pos = size;
+        return;
+    }
+    pos += 2;
+    int len = GetRaw();
+    sectionend[depth++] = pos + len;
+}
+
+void Ainfile::Seek(long p)
+{
+    if (!binary) return;
+    pos = (p < 0 || p > size) ? size : p;
+}
+
+// Skips over whatever is left of the section, which would have been
+// written by a newer version of the engine.  Having read past the end
+// of the section means the file is damaged.
+void Ainfile::EndSection()
+{
+    if (!binary || !depth) return;
+    long end = sectionend[--depth];
+    if (end > size || end < pos) {
+        damaged = 1;
+        end = size;
+    }
+    pos = end;
+}
+
+void Aoutfile::PutBytes(char const *s, int n)
+{
+    if (size + n > space) {
+        space = 2 * space + n + 4096;
+        char *temp = new char[space];
+        if (data) {
+            memcpy(temp, data, size);
+            delete [] data;
+        }
+        data = temp;
+    }
+    memcpy(data + size, s, n);
+    size += n;
+}
+
+void Aoutfile::PutRaw(int x)
+{
+    unsigned int u = (unsigned int) x;
+    char b[4];
+    b[0] = u & 0xff;
+    b[1] = (u >> 8) & 0xff;
+    b[2] = (u >> 16) & 0xff;
+    b[3] = (u >> 24) & 0xff;
+    PutBytes(b, 4);
+}
+
+void Aoutfile::PutVarint(int x)
+{
+    unsigned int u = ((unsigned int) x << 1) ^ (unsigned int) (x >> 31);
+    char b[5];
+    int n = 0;
+    while (u >= 0x80) {
+        b[n++] = (char) ((u & 0x7f) | 0x80);
+        u >>= 7;
+    }
+    b[n++] = (char) u;
+    PutBytes(b, n);
 }
 
 void Aoutfile::PutInt(int x)
 {
+    if (binary) {
+        char tag = TAG_INT;
+        PutBytes(&tag, 1);
+        PutVarint(x);
+        return;
+    }
+    if (buffered) {
+        char b[16];
+        PutBytes(b, sprintf(b, "%d%c", x, F_ENDLINE));
+        return;
+    }
     *file << x;
     *file << F_ENDLINE;
 }
 
 void Aoutfile::PutStr(char const *s)
 {
+    if (binary) {
+        char tag = TAG_STR;
+        int len = strlen(s);
+        PutBytes(&tag, 1);
+        PutVarint(len);
+        PutBytes(s, len);
+        return;
+    }
+    if (buffered) {
+        char end = F_ENDLINE;
+        PutBytes(s, strlen(s));
+        PutBytes(&end, 1);
+        return;
+    }
     *file << s << F_ENDLINE;
 }
 
 void Aoutfile::PutStr(const AString &s)
 {
+    if (binary || buffered) {
+        PutStr(((AString &) s).Str());
+        return;
+    }
     *file << s << F_ENDLINE;
 }
 
+void Aoutfile::StartSection(int type)
+{
+    if (!binary || depth == MAX_SECTION_DEPTH) return;
+    char head[2];
+    head[0] = TAG_SECTION;
+    head[1] = type;
+    PutBytes(head, 2);
+    sectionstart[depth++] = size;
+    PutRaw(0);
+}
+
+// Fills in the length of the section just finished
+void Aoutfile::EndSection()
+{
+    if (!binary || !depth) return;
+    long start = sectionstart[--depth];
+    unsigned int len = size - start - 4;
+    unsigned char *p = (unsigned char *) data + start;
+    p[0] = len & 0xff;
+    p[1] = (len >> 8) & 0xff;
+    p[2] = (len >> 16) & 0xff;
+    p[3] = (len >> 24) & 0xff;
+}
+
+// Copies in everything written to a buffer
+void Aoutfile::Append(Aoutfile *part)
+{
+    if (binary || buffered) PutBytes(part->data, part->size);
+    else file->write(part->data, part->size);
+}
+
 void Aorders::Open(const AString &s)
 {
     while (!(file->rdbuf()->is_open())) {
@@ -212,6 +703,7 @@ void Aorders::Open(const AString &s)
         file->open(name->Str(),ios::in);
         delete name;
     }
+    text.Reset();
 }
 
 int Aorders::OpenByName(const AString &s)
@@ -219,17 +711,15 @@ int Aorders::OpenByName(const AString &s)
     AString temp = s;
     file->open(temp.Str(),ios::in);
     if (!(file->rdbuf()->is_open())) return -1;
+    text.Reset();
     return 0;
 }
 
 AString * Aorders::GetLine()
 {
-    skipwhite(file);
-    if (file->eof()) return 0;
-    if (file->peek() == -1) return 0;
-    file->getline(buf,1023,F_ENDLINE);
-    AString *s = new AString((char *) &(buf[0]));
-    return s;
+    char *line = text.GetLine(1);
+    if (!line) return 0;
+    return new AString(line);
 }
 
 void Areport::Open(const AString &s)
@@ -31,6 +31,63 @@
 #include <fstream>
 using namespace std;
 
+//
+// The binary save format holds the same values as the text one, in the
+// same order, but each value is tagged with its type, integers are
+// packed into as few bytes as they need and strings carry their length.
+// A file starts with BINARY_SAVE_MAGIC and a format version.  Factions,
+// regions, objects, units and the quest list are each written as a
+// section with its length, so a reader can step over anything a newer
+// writer has appended to one.
+//
+// From version 2, the regions are preceded by a table of where each
+// region's section starts, counted from the end of the table, so the
+// regions can be read in any order.
+//
+#define BINARY_SAVE_MAGIC "atlantis_binary"
+#define BINARY_SAVE_VERSION 2
+#define MAX_SECTION_DEPTH 8
+
+enum {
+    SECTION_FACTION,
+    SECTION_REGION,
+    SECTION_OBJECT,
+    SECTION_UNIT,
+    SECTION_QUESTS,
+    SECTION_REGIONTABLE
+};
+
+//
+// Reads a text file a block at a time.  Lines are handed out as pointers
+// into the buffer, terminated in place, so nothing is copied per line;
+// a line stays valid until the next read.
+//
+class Abuffer {
+    public:
+        Abuffer();
+        ~Abuffer();
+
+        void Reset();
+        char *GetLine(int skip);
+        int GetInt();
+
+        ifstream *file;
+
+    private:
+        int Fill();
+
+        char *buf;
+        long size;
+        long start;
+        long end;
+        int eof;
+};
+
+// Split the next word off a line from Ainfile::GetView, terminating it
+// in place, and read a number the way AString::value does.
+char *nexttoken(char **line);
+int tokenvalue(char const *);
+
 class Ainfile {
     public:
         Ainfile();
@@ -38,13 +95,57 @@ class Ainfile {
 
         void Open(const AString &);
         int OpenByName(const AString &);
+        // Reads the bytes from start to end of an open binary file as a
+        // file of their own, sharing its memory.  Several parts of one
+        // file can be read at the same time.
+        void OpenPart(Ainfile *whole, long start, long end);
         void Close();
 
         AString *GetStr();
         AString *GetStrNoSkip();
         int GetInt();
+        // The next string without copying it, valid until the next read
+        char *GetView();
+
+        // Sections only exist in binary files; in text files these
+        // do nothing.
+        void StartSection(int);
+        void EndSection();
+
+        // The read position in a binary file
+        long Tell() { return pos; }
+        long Size() { return size; }
+        void Seek(long);
 
         ifstream *file;
+
+        // Set when the file is in the binary save format, which is
+        // read straight from a memory mapping.
+        int binary;
+        // The binary format version, or 0 for a text file
+        int version;
+        // Set when a binary file doesn't hold the sections it should,
+        // or something in a section ran past its end; the load has
+        // failed.
+        int damaged;
+
+    private:
+        int OpenBinary(char const *);
+        int GetRaw();
+        int GetVarint();
+        void Scratch(int);
+
+        Abuffer text;
+        char *scratch;
+        int scratchsize;
+
+        char *data;
+        long size;
+        long pos;
+        int mapped;
+        int shared;
+        long sectionend[MAX_SECTION_DEPTH];
+        int depth;
 };
 
 class Aoutfile {
@@ -53,14 +154,39 @@ class Aoutfile {
         ~Aoutfile();
 
         void Open(const AString &);
-        int OpenByName(const AString &);
+        int OpenByName(const AString &, int binary = 0);
+        // Collects output in memory, in the text or binary format, to be
+        // copied into another file with Append.
+        void OpenBuffer(int binary);
         void Close();
 
         void PutStr(char const *);
         void PutStr(const AString &);
         void PutInt(int);
 
+        void StartSection(int);
+        void EndSection();
+
+        void Append(Aoutfile *);
+        long Size() { return size; }
+
         ofstream *file;
+        int binary;
+
+    private:
+        void PutRaw(int);
+        void PutVarint(int);
+        void PutBytes(char const *, int);
+
+        // Binary files and buffers are put together here, and binary
+        // files written on Close, so section lengths can be filled in
+        // afterwards.
+        int buffered;
+        char *data;
+        long size;
+        long space;
+        long sectionstart[MAX_SECTION_DEPTH];
+        int depth;
 };
 
 class Aorders {
@@ -75,6 +201,9 @@ class Aorders {
         AString *GetLine();
 
         ifstream *file;
+
+    private:
+        Abuffer text;
 };
 
 class Areport {
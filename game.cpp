@@ -29,6 +29,7 @@
 #define F_OK    0
 #endif
 
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -38,19 +39,125 @@
 #include "astring.h"
 #include "gamedata.h"
 #include "quests.h"
+#include "threadpool.h"
 
 Game::Game()
 {
     gameStatus = GAME_STATUS_UNINIT;
-    ppUnits = 0;
-    maxppunits = 0;
+    threads = 1;
+    pool = 0;
+    binarysave = 0;
+    gameseed = 0;
+    newnexus = 0;
+    newwidth = 0;
+    newheight = 0;
+    newseed = 0;
+    newseedset = 0;
 }
 
 Game::~Game()
 {
-    delete ppUnits;
-    ppUnits = 0;
-    maxppunits = 0;
+    delete pool;
+    AllUnits.Clear();
+}
+
+void Game::SetThreads(int n)
+{
+    if (n < 1) n = 1;
+    if (pool && pool->Threads() != n) {
+        delete pool;
+        pool = 0;
+    }
+    threads = n;
+}
+
+int Game::SetNewGameParam(const AString &name, const AString &value)
+{
+    AString n = name;
+    AString v = value;
+    char const *str = v.Str();
+    char *end;
+    long num = strtol(str, &end, 10);
+    if (!*str || *end || num < 0 || num > 1000000000) {
+        Awrite(AString("Bad value for ") + n + ": " + v);
+        return 0;
+    }
+
+    if (n == "seed") {
+        newseed = num;
+        newseedset = 1;
+    } else if (n == "width" || n == "height") {
+        if (!num || num % 8) {
+            Awrite(AString("The ") + n + " must be a multiple of 8.");
+            return 0;
+        }
+        if (n == "width")
+            newwidth = num;
+        else
+            newheight = num;
+    } else if (n == "nexus") {
+        if (num != 1 && (!num || num % 2)) {
+            Awrite("The nexus must be 1 hex or a multiple of 2.");
+            return 0;
+        }
+        // Only rulesets with MULTI_HEX_NEXUS ask for this
+        newnexus = num;
+    } else {
+        Awrite(AString("Unknown setting: ") + n);
+        return 0;
+    }
+    return 1;
+}
+
+int Game::ReadNewGameParams(const AString &filename)
+{
+    Aorders f;
+    if (f.OpenByName(filename) == -1) {
+        Awrite(AString("Couldn't open ") + filename);
+        return 0;
+    }
+
+    int rc = 1;
+    AString *pLine;
+    while (rc && (pLine = f.GetLine())) {
+        AString *pName = pLine->gettoken();
+        if (pName) {
+            AString *pValue = pLine->gettoken();
+            if (pValue)
+                rc = SetNewGameParam(*pName, *pValue);
+            else {
+                Awrite(AString("No value for ") + *pName);
+                rc = 0;
+            }
+            delete pValue;
+        }
+        delete pName;
+        delete pLine;
+    }
+    return rc;
+}
+
+int Game::WorldSize(int preset, char const *question)
+{
+    if (preset > 0) return preset;
+    Awrite(question);
+    return Agetint();
+}
+
+void Game::StartProfile()
+{
+    profile.Enable();
+}
+
+void Game::Phase(char const *msg)
+{
+    Awrite(msg);
+    profile.StartPhase(msg);
+}
+
+int Game::WriteProfile()
+{
+    return profile.Write("turnprofile.json", year, month, threads);
 }
 
 int Game::TurnNumber()
@@ -271,9 +378,13 @@ int Game::NewGame()
     gameStatus = GAME_STATUS_NEW;
 
     //
-    // Seed the random number generator with a different value each time.
+    // Seed the random number generator with a different value each time,
+    // unless a seed was given to make the same world again.
     //
-    seedrandomrandom();
+    if (newseedset)
+        seedrandom(newseed);
+    else
+        seedrandomrandom();
 
     CreateWorld();
     CreateNPCFactions();
@@ -306,6 +417,7 @@ int Game::OpenGame()
     //
     Ainfile f;
     if (f.OpenByName("game.in") == -1) return(0);
+    binarysave = f.binary;
 
     //
     // Read in Globals
@@ -383,7 +495,11 @@ int Game::OpenGame()
 
     year = f.GetInt();
     month = f.GetInt();
-    seedrandom(f.GetInt());
+    int seed = f.GetInt();
+    gameseed = seed;
+    setrandomstreams(seed < 0);
+    if (seed < 0) seed = -1 - seed;
+    seedrandom(seed);
     factionseq = f.GetInt();
     unitseq = f.GetInt();
     shipseq = f.GetInt();
@@ -404,13 +520,19 @@ int Game::OpenGame()
     //
     // Read in the ARegions
     //
-    i = regions.ReadRegions(&f, &factions, eVersion);
+    if (threads > 1 && !pool) pool = new ThreadPool(threads);
+    i = regions.ReadRegions(&f, &factions, eVersion, pool);
     if (!i) return 0;
 
     // read in quests
     if (!quests.ReadQuests(&f))
         return 0;
 
+    if (f.damaged) {
+        Awrite("The game file is damaged!");
+        return 0;
+    }
+
     SetupUnitNums();
 
     f.Close();
@@ -418,9 +540,24 @@ int Game::OpenGame()
 }
 
 int Game::SaveGame()
+{
+    // Games using per-region random streams store their seed as
+    // -1 - seed; plain seeds are never negative
+    if (randomstreams())
+        return WriteGame(-1 - getrandom(10000));
+    return WriteGame(getrandom(10000));
+}
+
+int Game::ConvertGame(int binary)
+{
+    binarysave = binary;
+    return WriteGame(gameseed);
+}
+
+int Game::WriteGame(int seed)
 {
     Aoutfile f;
-    if (f.OpenByName("game.out") == -1) return(0);
+    if (f.OpenByName("game.out", binarysave) == -1) return(0);
 
     //
     // Write out Globals
@@ -432,7 +569,7 @@ int Game::SaveGame()
 
     f.PutInt(year);
     f.PutInt(month);
-    f.PutInt(getrandom(10000));
+    f.PutInt(seed);
     f.PutInt(factionseq);
     f.PutInt(unitseq);
     f.PutInt(shipseq);
@@ -451,7 +588,8 @@ int Game::SaveGame()
     //
     // Write out the ARegions
     //
-    regions.WriteRegions(&f);
+    if (threads > 1 && !pool) pool = new ThreadPool(threads);
+    regions.WriteRegions(&f, pool);
 
     // Write out quests
     quests.WriteQuests(&f);
@@ -701,7 +839,6 @@ Unit *Game::ParseGMUnit(AString *tag, Faction *pFac)
         }
     } else {
         int v = tag->value();
-        if ((unsigned int)v >= maxppunits) return NULL;
         return GetUnit(v);
     }
     return NULL;
@@ -1029,10 +1166,10 @@ int Game::DoOrdersCheck(const AString &strOrders, const AString &strCheck)
 
 int Game::RunGame()
 {
-    Awrite("Setting Up Turn...");
+    Phase("Setting Up Turn...");
     PreProcessTurn();
 
-    Awrite("Reading the Gamemaster File...");
+    Phase("Reading the Gamemaster File...");
     if (!ReadPlayers()) return(0);
 
     if (gameStatus == GAME_STATUS_FINISHED) {
@@ -1041,34 +1178,35 @@ int Game::RunGame()
     }
     gameStatus = GAME_STATUS_RUNNING;
 
-    Awrite("Reading the Orders File...");
+    Phase("Reading the Orders File...");
     ReadOrders();
 
     if (Globals->MAX_INACTIVE_TURNS != -1) {
-        Awrite("QUITting Inactive Factions...");
+        Phase("QUITting Inactive Factions...");
         RemoveInactiveFactions();
     }
 
     Awrite("Running the Turn...");
     RunOrders();
 
-    Awrite("Writing the Report File...");
+    Phase("Writing the Report File...");
     WriteReport();
     Awrite("");
     // LLS - write order templates
-    Awrite("Writing order templates...");
+    Phase("Writing order templates...");
     WriteTemplates();
     Awrite("");
     battles.DeleteAll();
 
     EmptyHell();
 
-    Awrite("Writing Playerinfo File...");
+    Phase("Writing Playerinfo File...");
     WritePlayers();
 
-    Awrite("Removing Dead Factions...");
+    Phase("Removing Dead Factions...");
     DeleteDeadFactions();
 
+    profile.Stop();
     Awrite("done");
 
     return(1);
@@ -1170,50 +1308,118 @@ void Game::MakeFactionReportLists()
 
 void Game::WriteReport()
 {
-    Areport f;
-
     MakeFactionReportLists();
     CountAllSpecialists();
+    if (threads > 1) {
+        PrepareReports();
+        RunFactionJobs(0);
+        return;
+    }
     forlist(&factions) {
-        Faction *fac = (Faction *) elem;
-        AString str = "report.";
-        str = str + fac->num;
-
-        if (!fac->IsNPC() ||
-                ((((month == 0) && (year == 1)) || Globals->GM_REPORT) &&
-            (fac->num == 1))) {
-            int i = f.OpenByName(str);
-            if (i != -1) {
-                fac->WriteReport(&f, this);
-                f.Close();
-            }
-        }
+        WriteFactionReport((Faction *) elem);
         Adot();
     }
 }
 
-// LLS - write order templates for factions
-void Game::WriteTemplates()
+void Game::WriteFactionReport(Faction *fac)
 {
     Areport f;
+    AString str = "report.";
+    str = str + fac->num;
+
+    if (!fac->IsNPC() ||
+            ((((month == 0) && (year == 1)) || Globals->GM_REPORT) &&
+        (fac->num == 1))) {
+        int i = f.OpenByName(str);
+        if (i != -1) {
+            fac->WriteReport(&f, this);
+            f.Close();
+        }
+    }
+}
 
+// LLS - write order templates for factions
+void Game::WriteTemplates()
+{
+    if (threads > 1) {
+        RunFactionJobs(1);
+        return;
+    }
     forlist(&factions) {
-        Faction *fac = (Faction *) elem;
-        AString str = "template.";
-        str = str + fac->num;
+        WriteFactionTemplate((Faction *) elem);
+        Adot();
+    }
+}
 
-        if (!fac->IsNPC()) {
-            int i = f.OpenByName(str);
-            if (i != -1) {
-                fac->WriteTemplate(&f, this);
-                f.Close();
+void Game::WriteFactionTemplate(Faction *fac)
+{
+    Areport f;
+    AString str = "template.";
+    str = str + fac->num;
+
+    if (!fac->IsNPC()) {
+        int i = f.OpenByName(str);
+        if (i != -1) {
+            fac->WriteTemplate(&f, this);
+            f.Close();
+        }
+        fac->present_regions.DeleteAll();
+    }
+}
+
+// Reports only read the world, apart from the sight summaries and
+// attribute caches, which fill themselves in on first use.  Filling
+// them in here leaves nothing for the report threads to write to.
+void Game::PrepareReports()
+{
+    forlist(&regions) {
+        ARegion *r = (ARegion *) elem;
+        r->UpdateSight();
+        forlist(&r->objects) {
+            Object *o = (Object *) elem;
+            forlist(&o->units) {
+                ((Unit *) elem)->CacheAttributes();
             }
-            fac->present_regions.DeleteAll();
         }
-        Adot();
     }
 }
 
+struct FactionJob {
+    Game *game;
+    Faction **factions;
+    int templates;
+};
+
+void Game::RunFactionJob(int n, void *arg)
+{
+    FactionJob *job = (FactionJob *) arg;
+    if (job->templates)
+        job->game->WriteFactionTemplate(job->factions[n]);
+    else
+        job->game->WriteFactionReport(job->factions[n]);
+}
+
+// Each faction's report or template goes to its own file, so they can
+// all be written at once.
+void Game::RunFactionJobs(int templates)
+{
+    if (!pool) pool = new ThreadPool(threads);
+
+    FactionJob job;
+    int count = factions.Num();
+    int i = 0;
+    job.game = this;
+    job.factions = new Faction *[count];
+    job.templates = templates;
+    forlist(&factions) {
+        job.factions[i++] = (Faction *) elem;
+    }
+
+    pool->Run(count, RunFactionJob, &job);
+    for (i = 0; i < count; i++) Adot();
+
+    delete [] job.factions;
+}
 
 void Game::DeleteDeadFactions()
 {
@@ -1275,42 +1481,31 @@ void Game::SetupUnitSeq()
 
 void Game::SetupUnitNums()
 {
-    if (ppUnits) delete ppUnits;
+    AllUnits.Clear();
 
     SetupUnitSeq();
 
-    maxppunits = unitseq+10000;
-
-    ppUnits = new Unit *[maxppunits];
-
-    unsigned int i;
-    for (i = 0; i < maxppunits ; i++) ppUnits[i] = 0;
-
     forlist(&regions) {
         ARegion *r = (ARegion *) elem;
         forlist(&r->objects) {
             Object *o = (Object *) elem;
             forlist(&o->units) {
                 Unit *u = (Unit *) elem;
-                i = u->num;
-                if ((i > 0) && (i < maxppunits)) {
-                    if (!ppUnits[i])
-                        ppUnits[u->num] = u;
+                int i = u->num;
+                if (i > 0) {
+                    if (!AllUnits.GetUnit(i))
+                        AllUnits.SetUnit(i, u);
                     else {
                         Awrite(AString("Error: Unit number ") + i +
                                 " multiply defined.");
-                        if ((unitseq > 0) && (unitseq < maxppunits)) {
-                            u->num = unitseq;
-                            ppUnits[unitseq++] = u;
-                        }
+                        u->num = unitseq;
+                        AllUnits.SetUnit(unitseq++, u);
                     }
                 } else {
                     Awrite(AString("Error: Unit number ")+i+
                             " out of range.");
-                    if ((unitseq > 0) && (unitseq < maxppunits)) {
-                        u->num = unitseq;
-                        ppUnits[unitseq++] = u;
-                    }
+                    u->num = unitseq;
+                    AllUnits.SetUnit(unitseq++, u);
                 }
             }
         }
@@ -1319,33 +1514,23 @@ void Game::SetupUnitNums()
 
 Unit *Game::GetNewUnit(Faction *fac, int an)
 {
-    unsigned int i;
-    for (i = 1; i < unitseq; i++) {
-        if (!ppUnits[i]) {
-            Unit *pUnit = new Unit(i, fac, an);
-            ppUnits[i] = pUnit;
-            return(pUnit);
-        }
+    unsigned int i = AllUnits.FirstFree();
+    if (i < unitseq) {
+        Unit *pUnit = new Unit(i, fac, an);
+        AllUnits.SetUnit(i, pUnit);
+        return(pUnit);
     }
 
     Unit *pUnit = new Unit(unitseq, fac, an);
-    ppUnits[unitseq] = pUnit;
+    AllUnits.SetUnit(unitseq, pUnit);
     unitseq++;
-    if (unitseq >= maxppunits) {
-        Unit **temp = new Unit*[maxppunits+10000];
-        memcpy(temp, ppUnits, maxppunits*sizeof(Unit *));
-        maxppunits += 10000;
-        delete[] ppUnits;
-        ppUnits = temp;
-    }
 
     return(pUnit);
 }
 
 Unit *Game::GetUnit(int num)
 {
-    if (num < 0 || (unsigned int)num >= maxppunits) return NULL;
-    return(ppUnits[num]);
+    return AllUnits.GetUnit(num);
 }
 
 
@@ -1605,8 +1790,7 @@ void Game::MonsterCheck(ARegion *r, Unit *u)
 
     if (u->type != U_WMON) {
 
-        forlist (&u->items) {
-            Item *i = (Item *) elem;
+        forlist_items(&u->items, i) {
             if (!i->num) continue;
             if (!ItemDefs[i->type].escape) continue;
 
@@ -1715,8 +1899,7 @@ void Game::MonsterCheck(ARegion *r, Unit *u)
                 // escape happens and if escape happens then walk all items
                 // and everything that is that type, get rid of it.
                 if ((*i).second < getrandom(10000)) continue;
-                forlist (&u->items) {
-                    Item *it = (Item *)elem;
+                forlist_items(&u->items, it) {
                     if (ItemDefs[it->type].type == (*i).first) {
                         if (Globals->WANDERING_MONSTERS_EXIST) {
                             Faction *mfac = GetFaction(&factions, monfaction);
@@ -27,15 +27,34 @@
 #define GAME_CLASS
 
 class Game;
+class ThreadPool;
 
 #include "aregion.h"
 #include "alist.h"
 #include "faction.h"
 #include "production.h"
 #include "object.h"
+#include "profile.h"
 
 #define CURRENT_ATL_VER MAKE_ATL_VER(5, 1, 0)
 
+// Phase ids for per-region random streams (see RandomStream).  The n-th
+// battle fought in a region during a turn uses RANDOM_BATTLE + n.
+enum {
+    RANDOM_STEAL,
+    RANDOM_ATTACK,
+    RANDOM_AUTOATTACK,
+    RANDOM_PILLAGE,
+    RANDOM_TAX,
+    RANDOM_CAST,
+    RANDOM_SELL,
+    RANDOM_BUY,
+    RANDOM_MIDTURN,
+    RANDOM_MONTH,
+    RANDOM_POSTTURN,
+    RANDOM_BATTLE
+};
+
 class OrdersCheck
 {
 public:
@@ -71,6 +90,8 @@ public:
     int RunGame();
     int EditGame(int *pSaveGame);
     int SaveGame();
+    // Rewrites game.in as game.out in text or binary form, unchanged
+    int ConvertGame(int binary);
     int WritePlayers();
     int ReadPlayers();
     int ReadPlayersLine(AString *pToken, AString *pLine, Faction *pFac,
@@ -99,7 +120,7 @@ public:
     Unit *GetNewUnit(Faction *fac, int an = 0);
 
     //
-    // Setup the array of units.
+    // Setup the unit index (see AllUnits in unit.h).
     //
     void SetupUnitSeq();
     void SetupUnitNums();
@@ -118,6 +139,28 @@ public:
     // Functions to allow enabling/disabling parts of the data tables
     void ModifyTablesPerRuleset(void);
 
+    // Number of threads to run region phases and reports on
+    void SetThreads(int);
+
+    // Settings for NewGame that are otherwise asked for on stdin:
+    // "width", "height", "nexus" and the random "seed".  Returns 0 for
+    // an unknown setting or a bad value.
+    int SetNewGameParam(const AString &name, const AString &value);
+    // Reads settings as "<name> <value>" lines; ; starts a comment
+    int ReadNewGameParams(const AString &filename);
+
+    // Fights the battle in specfile runs times on the thread pool and
+    // prints how it went; see simbattle.cpp.  The first battle is
+    // written to reportfile if there is one.
+    int SimBattle(const AString &specfile, int runs, int seed,
+            char const *reportfile);
+
+    // Time each phase of the turn from here on, for turnprofile.json
+    void StartProfile();
+    // Print the progress message for a phase and start timing it
+    void Phase(char const *);
+    int WriteProfile();
+
 private:
     //
     // Game editing functions.
@@ -148,6 +191,11 @@ private:
     void WriteReport();
     // LLS - write order templates
     void WriteTemplates();
+    void WriteFactionReport(Faction *);
+    void WriteFactionTemplate(Faction *);
+    void PrepareReports();
+    static void RunFactionJob(int, void *);
+    void RunFactionJobs(int templates);
 
     void DeleteDeadFactions();
 
@@ -286,8 +334,6 @@ private:
     ARegionList regions;
     int factionseq;
     unsigned int unitseq;
-    Unit **ppUnits;
-    unsigned int maxppunits;
     int shipseq;
     int year;
     int month;
@@ -303,6 +349,28 @@ private:
     int guardfaction;
     int monfaction;
     int doExtraInit;
+
+    int threads;
+    ThreadPool *pool;
+
+    // Set by SetNewGameParam; 0 means ask
+    int newnexus;
+    int newwidth;
+    int newheight;
+    int newseed;
+    int newseedset;
+    // For CreateWorld: the preset size if there is one, otherwise the
+    // answer to question
+    int WorldSize(int preset, char const *question);
+
+    TurnProfile profile;
+
+    // Write game.out in the binary save format; set when game.in was
+    // binary
+    int binarysave;
+    // The random seed as it was stored in game.in
+    int gameseed;
+    int WriteGame(int seed);
     
     //
     // Parsing functions
@@ -493,11 +561,13 @@ private:
     void DoSell(ARegion *, Market *);
     int GetSellAmount(ARegion *, Market *);
     void DoAttackOrders();
+    void RunAttackRegion(ARegion *);
     void CheckWMonAttack(ARegion *, Unit *);
     Unit *GetWMonTar(ARegion *, int, Unit *);
     int CountWMonTars(ARegion *, Unit *);
     void AttemptAttack(ARegion *, Unit *, Unit *, int, int=0);
     void DoAutoAttacks();
+    void RunAutoAttackRegion(ARegion *);
     void DoAdvanceAttack(ARegion *, Unit *);
     void DoAutoAttack(ARegion *, Unit *);
     void DoMovementAttacks(AList *);
@@ -510,6 +580,27 @@ private:
     void RunPromoteOrders();
     void Do1PromoteOrder(Object *, Unit *);
     void Do1EvictOrder(Object *, Unit *);
+    //
+    // Phases that work through the regions one at a time.  With random
+    // streams switched on, these can be spread over several threads.
+    // The battle phases also reach into neighbouring regions.
+    //
+    enum {
+        PHASE_PILLAGE,
+        PHASE_TAX,
+        PHASE_MONTH,
+        PHASE_ATTACK,
+        PHASE_AUTOATTACK
+    };
+    void RunRegionPhase(int phase);
+    void RunPhaseRegion(int phase, ARegion *);
+    int MustRunInOrder(int phase, ARegion *, int *facregions);
+    int UsesRegionLimit(int phase, Unit *);
+    static void RunRegionJob(int, void *);
+    void RunBattlePhase(int phase);
+    int MayFight(int phase, ARegion *);
+    int MayRaiseUndead(ARegion *);
+
     void RunPillageOrders();
     int CountPillagers(ARegion *);
     void ClearPillagers(ARegion *);
@@ -543,6 +634,7 @@ private:
     Location *DoAMoveOrder(Unit *, ARegion *, Object *);
     void DoMoveEnter(Unit *, ARegion *, Object **);
     void RunMonthOrders();
+    void RunMonthRegion(ARegion *);
     void RunStudyOrders(ARegion *);
     void Do1StudyOrder(Unit *, Object *);
     void RunTeachOrders();
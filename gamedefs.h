@@ -703,6 +703,14 @@ public:
     // Chance of men killed by undead coming back from the grave
     // as undead themselves
     int UNDEATH_CONTAGION;
+
+    // Resolve the attacks of soldiers that fight exactly alike together,
+    // group by group, instead of one at a time.  This makes the rounds of
+    // battles between large stacks much cheaper, and gives the same
+    // results on average.  0 turns it off; otherwise it is the number of
+    // volleys each round is split into (16 is suggested).  More volleys
+    // follow the order of attacks within a round more closely.
+    int GROUPED_COMBAT;
 };
 
 extern GameDefs *Globals;
@@ -36,6 +36,9 @@ using namespace std;
 #include "i_rand.h"
 
 static randctx isaac_ctx;
+static int isaac_seed = 0;
+static int random_streams = 0;
+static thread_local RandomStream *current_stream = 0;
 
 #define ENDLINE '\n'
 char buf[256];
@@ -58,13 +61,45 @@ void doneIO()
 {
 }
 
+// Spreads the bits of x over the whole word, so that nearby seeds,
+// regions and phases give unrelated streams
+static ub4 mixrandom(ub4 x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+static void seedstream(RandomStream *stream)
+{
+    ub4 key = mixrandom((ub4)isaac_seed);
+    key = mixrandom(key ^ (ub4)stream->region);
+    key = mixrandom(key ^ (ub4)stream->phase);
+    randctx *ctx = stream->ctx;
+    ctx->randa = ctx->randb = ctx->randc = (ub4)0;
+    for (ub4 i = 0; i < RANDSIZ; i++)
+        ctx->randrsl[i] = mixrandom(key + i);
+    randinit( ctx, TRUE );
+}
+
 int getrandom(int range)
 {
     int neg = (range < 0);
     if (!range) return 0;
     int ret = 0;
     if (neg) range = -range;
-    unsigned long i = isaac_rand( &isaac_ctx );
+    randctx *ctx = &isaac_ctx;
+    if (current_stream) {
+        if (!current_stream->ctx) {
+            current_stream->ctx = new randctx;
+            seedstream(current_stream);
+        }
+        ctx = current_stream->ctx;
+    }
+    unsigned long i = isaac_rand( ctx );
     i = i % range;
     if (neg) ret = (int)(i*-1);
     else ret = (int)i;
@@ -74,6 +109,7 @@ int getrandom(int range)
 void seedrandom(int num)
 {
     ub4 i;
+    isaac_seed = num;
     isaac_ctx.randa = isaac_ctx.randb = isaac_ctx.randc = (ub4)0;
     for (i=0; i<256; ++i)
     {
@@ -87,10 +123,41 @@ void seedrandomrandom()
     seedrandom( time( 0 ) );
 }
 
+void setrandomstreams(int on)
+{
+    random_streams = on;
+}
+
+int randomstreams()
+{
+    return random_streams;
+}
+
+RandomStream::RandomStream(int r, int p)
+{
+    region = r;
+    phase = p;
+    ctx = 0;
+    outer = current_stream;
+    if (random_streams) current_stream = this;
+}
+
+RandomStream::~RandomStream()
+{
+    current_stream = outer;
+    delete ctx;
+}
+
 int Agetint()
 {
     int x;
     cin >> x;
+    // Nothing left to answer with, as when run unattended; asking
+    // again would loop for ever
+    if (cin.eof() && cin.fail()) {
+        Awrite("Unexpected end of input.");
+        exit(1);
+    }
     cleartoendl();
     return x;
 }
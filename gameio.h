@@ -35,6 +35,32 @@ int getrandom(int);
 /* Seed the random number generator */
 void seedrandom(int);
 void seedrandomrandom();
+/* Choose between one game-wide random sequence (0, the default) and a
+   separate stream for each region phase and battle (1) */
+void setrandomstreams(int);
+int randomstreams();
+
+struct randctx;
+
+//
+// While one of these is in scope, and random streams are switched on,
+// getrandom() on this thread draws from a stream of its own seeded from
+// the turn's seed, the region number and the phase.  The results then
+// don't depend on the order regions are processed in.  In the default
+// mode it does nothing.  The stream isn't set up until the first draw,
+// so wrapping a phase that never draws costs next to nothing.
+//
+class RandomStream
+{
+    public:
+        RandomStream(int region, int phase);
+        ~RandomStream();
+
+        int region;
+        int phase;
+        randctx *ctx;
+        RandomStream *outer;
+};
 
 int Agetint();
 
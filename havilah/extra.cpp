@@ -104,7 +104,6 @@ int Game::SetupFaction( Faction *pFac )
 static void CreateQuest(ARegionList *regions, int monfaction)
 {
     Quest *q, *q2;
-    Item *item;
     int d, count, temple, i, j, clash;
     ARegion *r;
     Object *o;
@@ -121,10 +120,7 @@ static void CreateQuest(ARegionList *regions, int monfaction)
 
     q = new Quest;
     q->type = -1;
-    item = new Item;
-    item->type = I_RELICOFGRACE;
-    item->num = 1;
-    q->rewards.Add(item);
+    q->rewards.SetNum(I_RELICOFGRACE, 1);
     d = getrandom(100);
     if (d < 40) {
         // SLAY quest
@@ -352,12 +348,10 @@ Faction *Game::CheckVictory()
     int dir, found;
     unsigned ucount;
     Quest *q;
-    Item *item;
     ARegion *r, *start;
     Object *o;
     Unit *u;
     Faction *f;
-    Skill *s;
     Location *l;
     AString message, times, temp, filename;
     Arules wf;
@@ -624,8 +618,7 @@ Faction *Game::CheckVictory()
                         u = (Unit *) elem;
                         if (u->faction == f) {
                             units++;
-                            forlist(&u->items) {
-                                item = (Item *) elem;
+                            forlist_items(&u->items, item) {
                                 if (ItemDefs[item->type].type & IT_LEADER)
                                     leaders += item->num;
                                 else if (ItemDefs[item->type].type & IT_MAN)
@@ -636,8 +629,7 @@ Faction *Game::CheckVictory()
                                     stuff += item->num * ItemDefs[item->type].baseprice;
                                     
                             }
-                            forlist_reuse(&u->skills) {
-                                s = (Skill *) elem;
+                            forlist_skills(&u->skills, s) {
                                 if (SkillDefs[s->type].flags & SkillType::MAGIC) {
                                     magicdays += s->days * SkillDefs[s->type].cost;
                                     magiclevels += GetLevelByDays(s->days / u->GetMen()) * u->GetMen();
@@ -650,7 +642,7 @@ Faction *Game::CheckVictory()
                             // but given that the appropriate place for that function is
                             // r->hell, this doesn't seem right given what's happened.
                             // In this case, I'm willing to leak memory :-)
-                            o->units.Remove(u);
+                            u->MoveUnit(0);
                         }
                     }
                 }
@@ -816,10 +808,7 @@ Faction *Game::CheckVictory()
                     if (!found) {
                         q = new Quest;
                         q->type = Quest::DEMOLISH;
-                        item = new Item;
-                        item->type = I_RELICOFGRACE;
-                        item->num = 1;
-                        q->rewards.Add(item);
+                        q->rewards.SetNum(I_RELICOFGRACE, 1);
                         q->target = o->num;
                         q->regionnum = r->num;
                         quests.Add(q);
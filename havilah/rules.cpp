@@ -236,7 +236,8 @@ static GameDefs g = {
     0,    // ALLIES_NOAID
     0,    // HARDER_ASSASSINATION
     1,    // DISPERSE_GATE_NUMBERS
-    33    // UNDEATH_CONTAGION
+    33,   // UNDEATH_CONTAGION
+    0     // GROUPED_COMBAT
 };
 
 GameDefs *Globals = &g;
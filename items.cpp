@@ -24,78 +24,117 @@
 // END A3HEADER
 
 #include <stdlib.h>
+#include <string.h>
 #include "items.h"
 #include "skills.h"
 #include "object.h"
 #include "gamedata.h"
+#include "lookup.h"
+
+static LookupTable battleItemIndex;
+static LookupTable armorIndex;
+static LookupTable weaponIndex;
+static LookupTable mountIndex;
+static LookupTable monsterIndex;
+static LookupTable illusionIndex;
+static LookupTable raceIndex;
+static LookupTable itemIndex;
+static int itemsIndexed = 0;
+
+// Build the lookup tables for the item related rule tables.  This is
+// done the first time anything is looked up, and again by main() once
+// ModifyTablesPerRuleset has finished changing the tables.
+void IndexItemDefs()
+{
+    int i;
+
+    battleItemIndex.Clear();
+    for (i = 0; i < NUMBATTLEITEMS; i++)
+        battleItemIndex.Add(BattleItemDefs[i].abbr, i);
+    armorIndex.Clear();
+    for (i = 0; i < NUMARMORS; i++)
+        armorIndex.Add(ArmorDefs[i].abbr, i);
+    weaponIndex.Clear();
+    for (i = 0; i < NUMWEAPONS; i++)
+        weaponIndex.Add(WeaponDefs[i].abbr, i);
+    mountIndex.Clear();
+    for (i = 0; i < NUMMOUNTS; i++)
+        mountIndex.Add(MountDefs[i].abbr, i);
+    // Illusions are looked up as "i" followed by the abbreviation, so
+    // also index every monster starting with an i by the rest of its tag.
+    monsterIndex.Clear();
+    illusionIndex.Clear();
+    for (i = 0; i < NUMMONSTERS; i++) {
+        char const *abbr = MonDefs[i].abbr;
+        monsterIndex.Add(abbr, i);
+        if (abbr && (abbr[0] == 'i' || abbr[0] == 'I'))
+            illusionIndex.Add(abbr + 1, i);
+    }
+    raceIndex.Clear();
+    for (i = 0; i < NUMMAN; i++)
+        raceIndex.Add(ManDefs[i].abbr, i);
+    itemIndex.Clear();
+    for (i = 0; i < NITEMS; i++) {
+        if (!ItemDefs[i].abr) continue;
+        if (ItemDefs[i].type & IT_ILLUSION) {
+            AString tag = AString("i") + ItemDefs[i].abr;
+            itemIndex.Add(tag.Str(), i);
+        } else {
+            itemIndex.Add(ItemDefs[i].abr, i);
+        }
+    }
+    itemsIndexed = 1;
+
+    for (i = 0; i < NUMBATTLEITEMS; i++)
+        BattleItemDefs[i].item = LookupItem(BattleItemDefs[i].abbr);
+}
+
+static inline int Lookup(LookupTable &table, char const *key)
+{
+    if (!itemsIndexed) IndexItemDefs();
+    return table.Find(key);
+}
 
 BattleItemType *FindBattleItem(char const *abbr)
 {
-    if (abbr == NULL) return NULL;
-    for (int i = 0; i < NUMBATTLEITEMS; i++) {
-        if (BattleItemDefs[i].abbr == NULL) continue;
-        if (AString(abbr) == BattleItemDefs[i].abbr)
-            return &BattleItemDefs[i];
-    }
-    return NULL;
+    int i = Lookup(battleItemIndex, abbr);
+    if (i == -1) return NULL;
+    return &BattleItemDefs[i];
 }
 
 ArmorType *FindArmor(char const *abbr)
 {
-    if (abbr == NULL) return NULL;
-    for (int i = 0; i < NUMARMORS; i++) {
-        if (ArmorDefs[i].abbr == NULL) continue;
-        if (AString(abbr) == ArmorDefs[i].abbr)
-            return &ArmorDefs[i];
-    }
-    return NULL;
+    int i = Lookup(armorIndex, abbr);
+    if (i == -1) return NULL;
+    return &ArmorDefs[i];
 }
 
 WeaponType *FindWeapon(char const *abbr)
 {
-    if (abbr == NULL) return NULL;
-    for (int i = 0; i < NUMWEAPONS; i++) {
-        if (WeaponDefs[i].abbr == NULL) continue;
-        if (AString(abbr) == WeaponDefs[i].abbr)
-            return &WeaponDefs[i];
-    }
-    return NULL;
+    int i = Lookup(weaponIndex, abbr);
+    if (i == -1) return NULL;
+    return &WeaponDefs[i];
 }
 
 MountType *FindMount(char const *abbr)
 {
-    if (abbr == NULL) return NULL;
-    for (int i = 0; i < NUMMOUNTS; i++) {
-        if (MountDefs[i].abbr == NULL) continue;
-        if (AString(abbr) == MountDefs[i].abbr)
-            return &MountDefs[i];
-    }
-    return NULL;
+    int i = Lookup(mountIndex, abbr);
+    if (i == -1) return NULL;
+    return &MountDefs[i];
 }
 
 MonType *FindMonster(char const *abbr, int illusion)
 {
-    if (abbr == NULL) return NULL;
-    AString tag = (illusion ? "i" : "");
-    tag += abbr;
-
-    for (int i = 0; i < NUMMONSTERS; i++) {
-        if (MonDefs[i].abbr == NULL) continue;
-        if (tag == MonDefs[i].abbr)
-            return &MonDefs[i];
-    }
-    return NULL;
+    int i = Lookup(illusion ? illusionIndex : monsterIndex, abbr);
+    if (i == -1) return NULL;
+    return &MonDefs[i];
 }
 
 ManType *FindRace(char const *abbr)
 {
-    if (abbr == NULL) return NULL;
-    for (int i = 0; i < NUMMAN; i++) {
-        if (ManDefs[i].abbr == NULL) continue;
-        if (AString(abbr) == ManDefs[i].abbr)
-            return &ManDefs[i];
-    }
-    return NULL;
+    int i = Lookup(raceIndex, abbr);
+    if (i == -1) return NULL;
+    return &ManDefs[i];
 }
 
 AString AttType(int atype)
@@ -118,16 +157,14 @@ static AString DefType(int atype)
     return AttType(atype);
 }
 
+int LookupItem(char const *abbr)
+{
+    return Lookup(itemIndex, abbr);
+}
+
 int LookupItem(AString *token)
 {
-    for (int i = 0; i < NITEMS; i++) {
-        if (ItemDefs[i].type & IT_ILLUSION) {
-            if (*token == (AString("i") + ItemDefs[i].abr)) return i;
-        } else {
-            if (*token == ItemDefs[i].abr) return i;
-        }
-    }
-    return -1;
+    return Lookup(itemIndex, token->Str());
 }
 
 int ParseAllItems(AString *token)
@@ -1239,12 +1276,9 @@ int IsSoldier(int item)
 
 Item::Item()
 {
+    type = -1;
+    num = 0;
     selling = 0;
-    checked = 0;
-}
-
-Item::~Item()
-{
 }
 
 AString Item::Report(int seeillusions)
@@ -1275,42 +1309,90 @@ void Item::Writeout(Aoutfile *f)
 
 void Item::Readin(Ainfile *f)
 {
-    AString *temp = f->GetStr();
-    AString *token = temp->gettoken();
-    num = token->value();
-    delete token;
-    token = temp->gettoken();
-    type = LookupItem(token);
-    delete token;
-    delete temp;
+    char *line = f->GetView();
+    char *token = line ? nexttoken(&line) : 0;
+    num = token ? tokenvalue(token) : 0;
+    type = token ? LookupItem(nexttoken(&line)) : -1;
+}
+
+ItemList::ItemList()
+{
+    version = 0;
+    num = 0;
+    size = 0;
+    items = 0;
+}
+
+ItemList::~ItemList()
+{
+    delete [] (char *) items;
+}
+
+// Moves the items and their sorted positions to room for newsize items
+void ItemList::Resize(int newsize)
+{
+    char *mem = 0;
+    if (newsize) {
+        mem = new char[newsize * (sizeof(Item) + sizeof(short))];
+        Item *temp = (Item *) mem;
+        short *sorted = (short *) (temp + newsize);
+        for (int i = 0; i < num; i++) {
+            temp[i] = items[i];
+            sorted[i] = Sorted()[i];
+        }
+    }
+    delete [] (char *) items;
+    items = (Item *) mem;
+    size = newsize;
+}
+
+/// Where the first item of this type or later is in Sorted()
+int ItemList::Lower(int type)
+{
+    short *sorted = Sorted();
+    int lo = 0;
+    int hi = num;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (items[sorted[mid]].type < type) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+Item *ItemList::Find(int type)
+{
+    int pos = Lower(type);
+    if (pos < num && items[Sorted()[pos]].type == type)
+        return &items[Sorted()[pos]];
+    return 0;
 }
 
 void ItemList::Writeout(Aoutfile *f)
 {
-    f->PutInt(Num());
-    forlist (this) ((Item *) elem)->Writeout(f);
+    f->PutInt(num);
+    for (int i = 0; i < num; i++) items[i].Writeout(f);
 }
 
+// An item given twice is added up, as a list only holds one of each
 void ItemList::Readin(Ainfile *f)
 {
+    version++;
     int i = f->GetInt();
     for (int j=0; j<i; j++) {
-        Item *temp = new Item;
-        temp->Readin(f);
-        if (temp->type < 0 || temp->num < 1 ||
-                ItemDefs[temp->type].flags & ItemType::DISABLED)
-            delete temp;
-        else
-            Add(temp);
+        Item temp;
+        temp.Readin(f);
+        if (temp.type < 0 || temp.num < 1 ||
+                ItemDefs[temp.type].flags & ItemType::DISABLED)
+            continue;
+        SetNum(temp.type, GetNum(temp.type) + temp.num);
     }
 }
 
 int ItemList::GetNum(int t)
 {
-    forlist(this) {
-        Item *i = (Item *) elem;
-        if (i->type == t) return i->num;
-    }
+    Item *i = Find(t);
+    if (i) return i->num;
     return 0;
 }
 
@@ -1318,8 +1400,8 @@ int ItemList::Weight()
 {
     int wt = 0;
     int frac = 0;
-    forlist(this) {
-        Item *i = (Item *) elem;
+    for (int n = 0; n < num; n++) {
+        Item *i = &items[n];
         // Except unfinished ships from weight calculations:
         // these just get removed when the unit moves.
         if (ItemDefs[i->type].type & IT_SHIP) continue;
@@ -1333,45 +1415,37 @@ int ItemList::Weight()
 
 int ItemList::CanSell(int t)
 {
-    forlist(this) {
-        Item *i = (Item *)elem;
-        if (i->type == t) return i->num - i->selling;
-    }
+    Item *i = Find(t);
+    if (i) return i->num - i->selling;
     return 0;
 }
 
 void ItemList::Selling(int t, int n)
 {
-    forlist(this) {
-        Item *i = (Item *)elem;
-        if (i->type == t) i->selling += n;
-    }
-}
-
-void ItemList::UncheckAll()
-{
-    forlist(this) {
-        Item *i = (Item *)elem;
-        i->checked = 0;
-    }
+    Item *i = Find(t);
+    if (i) i->selling += n;
 }
 
+// Which items have been listed is kept here rather than on the items,
+// as reports for several factions may be written at once.
 AString ItemList::Report(int obs,int seeillusions,int nofirstcomma)
 {
-    UncheckAll();
     AString temp;
+    char *checked = new char[num + 1];
+    memset(checked, 0, num + 1);
     for (int s = 0; s < 7; s++) {
-        temp += ReportByType(s, obs, seeillusions, nofirstcomma);
+        temp += ReportByType(s, obs, seeillusions, nofirstcomma, checked);
         if (temp.Len()) nofirstcomma = 0;
     }
+    delete [] checked;
     return temp;
 }
 
 AString ItemList::BattleReport()
 {
     AString temp;
-    forlist(this) {
-        Item *i = (Item *) elem;
+    for (int n = 0; n < num; n++) {
+        Item *i = &items[n];
         if (ItemDefs[i->type].combat) {
             temp += ", ";
             temp += i->Report(0);
@@ -1389,13 +1463,13 @@ AString ItemList::BattleReport()
 }
 
 AString ItemList::ReportByType(int type, int obs, int seeillusions,
-        int nofirstcomma)
+        int nofirstcomma, char *checked)
 {
     AString temp;
-    forlist(this) {
+    for (int pos = 0; pos < num; pos++) {
         int report = 0;
-        Item *i = (Item *) elem;
-        if (i->checked) continue;
+        Item *i = &items[pos];
+        if (checked[pos]) continue;
         switch (type) {
             case 0:
                 if (ItemDefs[i->type].type & IT_MAN)
@@ -1455,7 +1529,7 @@ AString ItemList::ReportByType(int type, int obs, int seeillusions,
                     temp += i->Report(seeillusions);
                 }
             }
-            i->checked = 1;
+            checked[pos] = 1;
         }
     }
     return temp;
@@ -1465,28 +1539,73 @@ void ItemList::SetNum(int t,int n)
 {
     // sanity check: does this item type exist?
     if ((t<0) || (t>=NITEMS)) return;
-    if (n) {
-        forlist(this) {
-            Item *i = (Item *) elem;
-            if (i->type == t) {
-                i->num = n;
-                return;
-            }
-        }
-        Item *i = new Item;
-        i->type = t;
-        i->num = n;
-        Add(i);
+    version++;
+    int spos = Lower(t);
+    short *sorted = Sorted();
+    if (spos < num && items[sorted[spos]].type == t) {
+        int pos = sorted[spos];
+        if (n) {
+            items[pos].num = n;
+            return;
+        }
+        // Take it out, keeping the rest in order
+        num--;
+        for (int i = pos; i < num; i++) items[i] = items[i + 1];
+        for (int i = spos; i < num; i++) sorted[i] = sorted[i + 1];
+        for (int i = 0; i < num; i++) {
+            if (sorted[i] > pos) sorted[i]--;
+        }
+        if (!num) Resize(0);
+        return;
+    }
+    if (!n) return;
+    if (num == size) {
+        Resize(size ? size * 2 : 1);
+        sorted = Sorted();
+    }
+    items[num].type = t;
+    items[num].num = n;
+    items[num].selling = 0;
+    for (int i = num; i > spos; i--) sorted[i] = sorted[i - 1];
+    sorted[spos] = num;
+    num++;
+}
+
+ItemListIterator::ItemListIterator(ItemList *l)
+{
+    list = l;
+    cur = -1;
+    curtype = -1;
+    nexttype = -1;
+}
+
+Item *ItemListIterator::Next()
+{
+    int pos;
+    if (cur == -1) {
+        pos = 0;
     } else {
-        forlist(this) {
-            Item *i = (Item *) elem;
-            if (i->type == t) {
-                Remove(i);
-                delete i;
-                return;
+        // Like forlist, stop after what was the last item
+        if (nexttype == -1) return 0;
+        if (cur < list->num && list->items[cur].type == curtype) {
+            pos = cur + 1;
+        } else {
+            // The list has changed; look for the items where they are now
+            Item *i = list->Find(curtype);
+            if (i) {
+                pos = i - list->items + 1;
+            } else {
+                i = list->Find(nexttype);
+                if (!i) return 0;
+                pos = i - list->items;
             }
         }
     }
+    if (pos >= list->num) return 0;
+    cur = pos;
+    curtype = list->items[pos].type;
+    nexttype = (pos + 1 < list->num) ? list->items[pos + 1].type : -1;
+    return &list->items[pos];
 }
 
 int ManType::CanProduce(int item)
@@ -326,6 +326,9 @@ class BattleItemType
         int flags;
         char const *special;
         int skillLevel;
+
+        // abbr as a number in ItemDefs; filled in by IndexItemDefs
+        int item;
 };
 
 extern BattleItemType *BattleItemDefs;
@@ -335,6 +338,7 @@ extern int ParseAllItems(AString *);
 extern int ParseEnabledItem(AString *);
 extern int ParseTransportableItem(AString *);
 extern int LookupItem(AString *);
+extern int LookupItem(char const *abbr);
 
 extern BattleItemType *FindBattleItem(char const *abbr);
 extern ArmorType *FindArmor(char const *abbr);
@@ -342,6 +346,7 @@ extern WeaponType *FindWeapon(char const *abbr);
 extern MountType *FindMount(char const *abbr);
 extern MonType *FindMonster(char const *abbr, int illusion);
 extern ManType *FindRace(char const *abbr);
+extern void IndexItemDefs();
 extern AString AttType(int atype);
 
 enum {
@@ -353,11 +358,10 @@ extern AString *ItemDescription(int item, int full);
 
 extern int IsSoldier(int);
 
-class Item : public AListElem
+class Item
 {
     public:
         Item();
-        ~Item();
 
         void Readin(Ainfile *);
         void Writeout(Aoutfile *);
@@ -367,27 +371,89 @@ class Item : public AListElem
         int type;
         int num;
         int selling;
-        int checked; // flag whether item has been reported, counted etc.
 };
 
-class ItemList : public AList
+/// The items held by a unit, faction, fleet or battle.
+/**
+The items are kept by value in one array, in the order they were first
+added, which is the order reports and saves list them in.  Behind them,
+in the same allocation, are their positions sorted by type, so GetNum
+and SetNum are binary searches.  A list holds at most one Item of each
+type; setting its number to zero takes it out.
+
+Walk a list with forlist_items.
+*/
+class ItemList
 {
     public:
+        ItemList();
+        ~ItemList();
+
         void Readin(Ainfile *);
         void Writeout(Aoutfile *);
 
         AString Report(int, int, int);
         AString BattleReport();
-        AString ReportByType(int, int, int, int);
+        AString ReportByType(int, int, int, int, char *);
 
+        int Num() { return num; }
         int Weight();
         int GetNum(int);
         void SetNum(int, int); /* type, number */
         int CanSell(int);
         void Selling(int, int); /* type, number */
-        void UncheckAll(); // re-set checked flag for all
+
+        int version; ///< Changes whenever the list does
+
+    private:
+        friend class ItemListIterator;
+
+        int Lower(int type);
+        Item *Find(int type);
+        short *Sorted() { return (short *) (items + size); }
+        void Resize(int newsize);
+
+        short num;
+        short size;             ///< Items there is room for
+        Item *items;            ///< The items in list order
+
+        // Not copyable; the copies would share items
+        ItemList(const ItemList &);
+        ItemList & operator=(const ItemList &);
 };
 
+/// Walks an ItemList for forlist_items.
+/**
+The body of the loop may change the list with SetNum.  The walk goes on
+after the current item even if other items are taken out, as
+Soldier::Setup does with a unit's weapons.  If the body takes out the
+current item, the walk goes on at the item that followed it.  Like
+forlist, items added are visited unless the walk was at the last item.
+As the items of a list all have different types, the current and next
+items can be found again by type when the list has moved.  Adding or
+taking out an item moves the others, so an Item pointer is only good
+until then; changing an item's number moves nothing.
+
+The walk doesn't write to the list, so several threads may walk one
+list at once.
+*/
+class ItemListIterator {
+    public:
+        ItemListIterator(ItemList *);
+
+        Item * Next();
+
+    private:
+        ItemList *list;
+        int cur;                ///< Where the current item was, or -1
+        int curtype;            ///< Its type
+        int nexttype;           ///< The type that followed it, or -1
+};
+
+/// Iterate over an ItemList, with i pointing at each Item in turn
+#define forlist_items(l, i) \
+    for (ItemListIterator _itemiter(l); Item * i = _itemiter.Next(); )
+
 extern AString ShowSpecial(char const *special, int level, int expandLevel,
         int fromItem);
 
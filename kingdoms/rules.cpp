@@ -229,7 +229,8 @@ static GameDefs g = {
     0, // ALLIES_NOAID
     0, // HARDER_ASSASSINATION
     0, //DISPERSE_GATE_NUMBERS
-    0    // UNDEATH_CONTAGION
+    0, // UNDEATH_CONTAGION
+    0    // GROUPED_COMBAT
 };
 
 GameDefs *Globals = &g;
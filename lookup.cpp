@@ -0,0 +1,122 @@
+// START A3HEADER
+//
+// This source file is part of the Atlantis PBM game program.
+// Copyright (C) 1995-1999 Geoff Dunbar
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program, in the file license.txt. If not, write
+// to the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+//
+// See the Atlantis Project web page for details:
+// http://www.prankster.com/project
+//
+// END A3HEADER
+#include <string.h>
+
+#include "lookup.h"
+
+static inline char Fold(char c)
+{
+    if ((c >= 'A') && (c <= 'Z')) return c - 'A' + 'a';
+    if (c == '_') return ' ';
+    return c;
+}
+
+LookupTable::LookupTable()
+{
+    slots = 0;
+    size = 0;
+    count = 0;
+}
+
+LookupTable::~LookupTable()
+{
+    Clear();
+}
+
+void LookupTable::Clear()
+{
+    for (int i = 0; i < size; i++)
+        delete [] slots[i].key;
+    delete [] slots;
+    slots = 0;
+    size = 0;
+    count = 0;
+}
+
+unsigned int LookupTable::Hash(char const *key)
+{
+    unsigned int h = 2166136261u;
+    for (; *key; key++) {
+        h ^= (unsigned char) Fold(*key);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+int LookupTable::Same(char const *a, char const *b)
+{
+    while (*a && *b) {
+        if (Fold(*a) != Fold(*b)) return 0;
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+void LookupTable::Grow()
+{
+    Entry *old = slots;
+    int oldsize = size;
+
+    size = size ? size * 2 : 64;
+    slots = new Entry[size];
+    for (int i = 0; i < size; i++)
+        slots[i].key = 0;
+    for (int i = 0; i < oldsize; i++) {
+        if (!old[i].key) continue;
+        int j = old[i].hash & (size - 1);
+        while (slots[j].key) j = (j + 1) & (size - 1);
+        slots[j] = old[i];
+    }
+    delete [] old;
+}
+
+void LookupTable::Add(char const *key, int index)
+{
+    if (!key) return;
+    if (Find(key) != -1) return;
+    if ((count + 1) * 2 > size) Grow();
+
+    unsigned int h = Hash(key);
+    int j = h & (size - 1);
+    while (slots[j].key) j = (j + 1) & (size - 1);
+    slots[j].key = new char[strlen(key) + 1];
+    strcpy(slots[j].key, key);
+    slots[j].hash = h;
+    slots[j].index = index;
+    count++;
+}
+
+int LookupTable::Find(char const *key)
+{
+    if (!key || !size) return -1;
+
+    unsigned int h = Hash(key);
+    for (int j = h & (size - 1); slots[j].key; j = (j + 1) & (size - 1)) {
+        if (slots[j].hash == h && Same(slots[j].key, key))
+            return slots[j].index;
+    }
+    return -1;
+}
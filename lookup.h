@@ -0,0 +1,61 @@
+// START A3HEADER
+//
+// This source file is part of the Atlantis PBM game program.
+// Copyright (C) 1995-1999 Geoff Dunbar
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program, in the file license.txt. If not, write
+// to the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+//
+// See the Atlantis Project web page for details:
+// http://www.prankster.com/project
+//
+// END A3HEADER
+#ifndef LOOKUP_CLASS
+#define LOOKUP_CLASS
+
+/// A hashed index from rule table keys to table positions
+/**
+Keys compare the same way AString::operator== does: case does not
+matter and '_' matches ' '.  If a key is added twice, the first
+position is kept, just like the linear scans this replaces.
+*/
+class LookupTable {
+    public:
+        LookupTable();
+        ~LookupTable();
+
+        void Clear();
+        void Add(char const *key, int index);
+        int Find(char const *key);
+
+        /// Whether two keys match, in the same way
+        static int Same(char const *a, char const *b);
+
+    private:
+        struct Entry {
+            char *key;
+            unsigned int hash;
+            int index;
+        };
+
+        static unsigned int Hash(char const *key);
+        void Grow();
+
+        Entry *slots;
+        int size;               ///< Always a power of two
+        int count;
+};
+
+#endif
@@ -34,15 +34,20 @@
 
 void usage()
 {
-    Awrite("atlantis new");
-    Awrite("atlantis run");
+    Awrite("atlantis new [--params <file>] [--seed <n>] [--width <n>]");
+    Awrite("             [--height <n>] [--nexus <n>]");
+    Awrite("atlantis run [--threads <n>]");
     Awrite("atlantis edit");
+    Awrite("atlantis convert <text|binary>");
     Awrite("");
     Awrite("atlantis map <geo|wmon|lair|gate> <mapfile>");
     Awrite("atlantis mapunits");
     Awrite("atlantis genrules <introfile> <cssfile> <rules-outputfile>");
     Awrite("");
     Awrite("atlantis check <orderfile> <checkfile>");
+    Awrite("atlantis simbattle <specfile> [--runs <n>] [--seed <n>]");
+    Awrite("                   [--threads <n>] [--report <file>]");
+    Awrite("                   [--grouped <volleys>]");
 }
 
 int main(int argc, char *argv[])
@@ -65,9 +70,31 @@ int main(int argc, char *argv[])
     }
 
     game.ModifyTablesPerRuleset();
+    IndexSkillDefs();
+    IndexItemDefs();
 
     do {
         if (AString(argv[1]) == "new") {
+            // Options are taken in order, so ones after --params
+            // override what is in the file
+            int i;
+            for (i = 2; i + 1 < argc; i += 2) {
+                AString opt = argv[i];
+                if (opt == "--params") {
+                    if (!game.ReadNewGameParams(argv[i + 1])) break;
+                } else if (opt == "--seed" || opt == "--width" ||
+                        opt == "--height" || opt == "--nexus") {
+                    AString name = argv[i] + 2;
+                    if (!game.SetNewGameParam(name, argv[i + 1])) break;
+                } else {
+                    break;
+                }
+            }
+            if (i < argc) {
+                usage();
+                break;
+            }
+
             if (!game.NewGame()) {
                 Awrite( "Couldn't make the new game!" );
                 break;
@@ -98,6 +125,21 @@ int main(int argc, char *argv[])
                 break;
             }
         } else if (AString(argv[1]) == "run") {
+            int i;
+            for (i = 2; i < argc; i++) {
+                if (AString(argv[i]) == "--threads" && i + 1 < argc) {
+                    game.SetThreads(atoi(argv[++i]));
+                } else {
+                    break;
+                }
+            }
+            if (i < argc) {
+                usage();
+                break;
+            }
+
+            game.StartProfile();
+            game.Phase("Reading the Game File...");
             if ( !game.OpenGame() ) {
                 Awrite( "Couldn't open the game file!" );
                 break;
@@ -108,10 +150,16 @@ int main(int argc, char *argv[])
                 break;
             }
 
+            game.Phase("Saving the Game File...");
             if ( !game.SaveGame() ) {
                 Awrite( "Couldn't save the game!" );
                 break;
             }
+
+            if ( !game.WriteProfile() ) {
+                Awrite( "Couldn't write the turn profile!" );
+                break;
+            }
         } else if (AString(argv[1]) == "edit") {
             if ( !game.OpenGame() ) {
                 Awrite( "Couldn't open the game file!" );
@@ -130,6 +178,22 @@ int main(int argc, char *argv[])
                     break;
                 }
             }
+        } else if (AString(argv[1]) == "convert") {
+            if (argc != 3 || (!(AString(argv[2]) == "text") &&
+                        !(AString(argv[2]) == "binary"))) {
+                usage();
+                break;
+            }
+
+            if ( !game.OpenGame() ) {
+                Awrite( "Couldn't open the game file!" );
+                break;
+            }
+
+            if ( !game.ConvertGame(AString(argv[2]) == "binary") ) {
+                Awrite( "Couldn't save the game!" );
+                break;
+            }
         } else if ( AString( argv[1] ) == "check" ) {
             if (argc != 4) {
                 usage();
@@ -141,6 +205,38 @@ int main(int argc, char *argv[])
                 Awrite( "Couldn't check the orders!" );
                 break;
             }
+        } else if (AString(argv[1]) == "simbattle") {
+            int runs = 100;
+            int seed = 1;
+            char const *report = 0;
+            int i;
+            for (i = 3; i + 1 < argc; i += 2) {
+                AString opt = argv[i];
+                if (opt == "--runs") {
+                    runs = atoi(argv[i + 1]);
+                } else if (opt == "--seed") {
+                    seed = atoi(argv[i + 1]);
+                } else if (opt == "--threads") {
+                    game.SetThreads(atoi(argv[i + 1]));
+                } else if (opt == "--report") {
+                    report = argv[i + 1];
+                } else if (opt == "--grouped") {
+                    // Overrides the ruleset's GROUPED_COMBAT
+                    Globals->GROUPED_COMBAT = atoi(argv[i + 1]);
+                } else {
+                    break;
+                }
+            }
+            if (argc < 3 || i < argc) {
+                usage();
+                break;
+            }
+
+            game.DummyGame();
+            if (!game.SimBattle(argv[2], runs, seed, report)) {
+                Awrite("Couldn't run the battles!");
+                break;
+            }
         } else if ( AString( argv[1] ) == "mapunits" ) {
             if ( !game.OpenGame() ) {
                 Awrite( "Couldn't open the game file!" );
@@ -108,12 +108,9 @@ void Market::Writeout(Aoutfile *f)
 
 void Market::Readin(Ainfile *f)
 {
-    AString *temp;
     type = f->GetInt();
 
-    temp = f->GetStr();
-    item = LookupItem(temp);
-    delete temp;
+    item = LookupItem(f->GetView());
 
     price = f->GetInt();
     amount = f->GetInt();
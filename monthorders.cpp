@@ -339,6 +339,7 @@ Location *Game::Do1SailOrder(ARegion *reg, Object *fleet, Unit *cap)
             if (x->dir != MOVE_PAUSE) {
                 fleet->MoveObject(newreg);
                 fleet->SetPrevDir(reg->GetRealDirComp(x->dir));
+                ProfileCount(PROFILE_UNITS_MOVED, fleet->units.Num());
             }
             forlist(&fleet->units) {
                 unit = (Unit *) elem;
@@ -346,7 +347,7 @@ Location *Game::Do1SailOrder(ARegion *reg, Object *fleet, Unit *cap)
                 if (unit->guard == GUARD_GUARD)
                     unit->guard = GUARD_NONE;
                 unit->alias = 0;
-                unit->PracticeAttribute("wind");
+                unit->PracticeAttribute(AT_WIND);
                 if (unit->monthorders) {
                     if (unit->monthorders->type == O_SAIL)
                         unit->Practice(S_SAILING);
@@ -1025,13 +1026,15 @@ int Game::ShipConstruction(ARegion *r, Unit *u, Unit *target, int level, int nee
 
 void Game::RunMonthOrders()
 {
-    forlist(&regions) {
-        ARegion * r = (ARegion *) elem;
-        RunIdleOrders(r);
-        RunStudyOrders(r);
-        RunBuildHelpers(r);
-        RunProduceOrders(r);
-    }
+    RunRegionPhase(PHASE_MONTH);
+}
+
+void Game::RunMonthRegion(ARegion *r)
+{
+    RunIdleOrders(r);
+    RunStudyOrders(r);
+    RunBuildHelpers(r);
+    RunProduceOrders(r);
 }
 
 void Game::RunUnitProduce(ARegion * r,Unit * u)
@@ -1928,11 +1931,11 @@ Location *Game::DoAMoveOrder(Unit *unit, ARegion *region, Object *obj)
 
     forbid = newreg->Forbidden(unit);
     if (forbid && !startmove && unit->guard != GUARD_ADVANCE) {
-        int obs = unit->GetAttribute("observation");
+        int obs = unit->GetAttribute(AT_OBSERVATION);
         unit->Event(AString("Is forbidden entry to ") +
                     newreg->ShortPrint(&regions) + " by " +
                     forbid->GetName(obs) + ".");
-        obs = forbid->GetAttribute("observation");
+        obs = forbid->GetAttribute(AT_OBSERVATION);
         forbid->Event(AString("Forbids entry to ") +
                     unit->GetName(obs) + ".");
         goto done_moving;
@@ -1945,6 +1948,7 @@ Location *Game::DoAMoveOrder(Unit *unit, ARegion *region, Object *obj)
     unit->moved += cost;
     unit->MoveUnit(newreg->GetDummy());
     unit->DiscardUnfinishedShips();
+    ProfileCount(PROFILE_UNITS_MOVED);
 
     switch (movetype) {
         case M_WALK:
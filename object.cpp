@@ -28,6 +28,7 @@
 #include "items.h"
 #include "skills.h"
 #include "gamedata.h"
+#include "lookup.h"
 #include "unit.h"
 
 int LookupObject(AString *token)
@@ -38,6 +39,16 @@ int LookupObject(AString *token)
     return -1;
 }
 
+int LookupObject(char const *token)
+{
+    if (!token) return -1;
+    for (int i = 0; i < NOBJECTS; i++) {
+        if (ObjectDefs[i].name && LookupTable::Same(token, ObjectDefs[i].name))
+            return i;
+    }
+    return -1;
+}
+
 /* ParseObject checks for matching Object types AND
  * for matching ship-type items (which are also
  * produced using the build order) if the ships
@@ -88,7 +99,6 @@ Object::Object(ARegion *reg)
     prevdir = -1;
     flying = 0;
     movepoints = Globals->PHASED_MOVE_OFFSET % Globals->MAX_SPEED;
-    ships.Empty();
 }
 
 Object::~Object()
@@ -100,6 +110,7 @@ Object::~Object()
 
 void Object::Writeout(Aoutfile *f)
 {
+    f->StartSection(SECTION_OBJECT);
     f->PutInt(num);
     if (IsFleet()) f->PutStr(ObjectDefs[O_FLEET].name);
     else if (type != -1) f->PutStr(ObjectDefs[type].name);
@@ -121,17 +132,15 @@ void Object::Writeout(Aoutfile *f)
     forlist ((&units))
         ((Unit *) elem)->Writeout(f);
     WriteoutFleet(f);
+    f->EndSection();
 }
 
 void Object::Readin(Ainfile *f, AList *facs, ATL_VER v)
 {
-    AString *temp;
-
+    f->StartSection(SECTION_OBJECT);
     num = f->GetInt();
 
-    temp = f->GetStr();
-    type = LookupObject(temp);
-    delete temp;
+    type = LookupObject(f->GetView());
 
     incomplete = f->GetInt();
 
@@ -160,6 +169,7 @@ void Object::Readin(Ainfile *f, AList *facs, ATL_VER v)
     }
     mages = ObjectDefs[type].maxMages;
     ReadinFleet(f);
+    f->EndSection();
 }
 
 void Object::SetName(AString *s)
@@ -211,9 +221,8 @@ int Object::CanModify()
 
 Unit *Object::GetUnit(int num)
 {
-    forlist((&units))
-        if (((Unit *) elem)->num == num)
-            return ((Unit *) elem);
+    Unit *u = AllUnits.GetUnit(num);
+    if (u && u->object == this) return u;
     return 0;
 }
 
@@ -399,8 +408,10 @@ void Object::SetPrevDir(int newdir)
 void Object::MoveObject(ARegion *toreg)
 {
     region->objects.Remove(this);
+    region->InvalidateSight();
     region = toreg;
     toreg->objects.Add(this);
+    toreg->InvalidateSight();
 }
 
 int Object::IsRoad()
@@ -423,10 +434,7 @@ int Object::CheckShip(int item)
 void Object::WriteoutFleet(Aoutfile *f)
 {
     if (!IsFleet()) return;
-    int nships = (int) ships.Num();
-    f->PutInt(nships);
-    forlist(&ships)
-        ((Item *) elem)->Writeout(f);
+    ships.Writeout(f);
 }
 
 void Object::ReadinFleet(Ainfile *f)
@@ -434,11 +442,10 @@ void Object::ReadinFleet(Ainfile *f)
     if (type != O_FLEET) return;
     int nships = f->GetInt();
     for (int i=0; i<nships; i++) {
-        Item *ship = new Item;
-        ship->Readin(f);
-        if (ship->type >= 0)
-            SetNumShips(ship->type, ship->num);
-        delete ship;
+        Item ship;
+        ship.Readin(f);
+        if (ship.type >= 0)
+            SetNumShips(ship.type, ship.num);
     }
 }
 
@@ -447,14 +454,7 @@ void Object::ReadinFleet(Ainfile *f)
  */
 int Object::GetNumShips(int type)
 {
-    if (CheckShip(type) != 0) {
-        forlist(&ships) {
-            Item *ship = (Item *) elem;
-            if (ship->type == type) {
-                return ship->num;
-            }
-        }
-    }
+    if (CheckShip(type) != 0) return ships.GetNum(type);
     return 0;
 }
 
@@ -464,31 +464,10 @@ int Object::GetNumShips(int type)
 void Object::SetNumShips(int type, int num)
 {
     if (CheckShip(type) != 0) {
-        if (num > 0) {
-            forlist(&ships) {
-                Item *ship = (Item *) elem;
-                if (ship->type == type) {
-                    ship->num = num;
-                    FleetCapacity();
-                    return;
-                }
-            }
-            Item *ship = new Item;
-            ship->type = type;
-            ship->num = num;
-            ships.Add(ship);
-            FleetCapacity();
-        } else {
-            forlist(&ships) {
-                Item *ship = (Item *) elem;
-                if (ship->type == type) {
-                    ships.Remove(ship);
-                    delete ship;
-                    FleetCapacity();
-                    return;
-                }
-            }
-        }
+        if (num < 0) num = 0;
+        if (!num && !ships.GetNum(type)) return;
+        ships.SetNum(type, num);
+        FleetCapacity();
     }
 }
 
@@ -664,7 +643,7 @@ int Object::GetFleetSpeed(int report)
     // count wind mages
     forlist(&units) {
         Unit * unit = (Unit *) elem;
-        int wb = unit->GetAttribute("wind");
+        int wb = unit->GetAttribute(AT_WIND);
         if (wb > 0) {
             windbonus += wb * 12 * Globals->FLEET_WIND_BOOST;
         }
@@ -76,6 +76,7 @@ extern ObjectType *ObjectDefs;
 AString *ObjectDescription(int obj);
 
 int LookupObject(AString *token);
+int LookupObject(char const *token);
 
 int ParseObject(AString *, int ships);
 
@@ -141,7 +142,7 @@ class Object : public AListElem
         int shipno;
         int movepoints;
         AList units;
-        AList ships;
+        ItemList ships;
 };
 
 #endif
@@ -1636,8 +1636,7 @@ void Game::ProcessBuildOrder(Unit *unit, AString *o, OrdersCheck *pCheck)
         if (!pCheck) {
             // look for an incomplete ship type in inventory
             int st = O_DUMMY;
-            forlist(&unit->items) {
-                Item * it = (Item *) elem;
+            forlist_items(&unit->items, it) {
                 if ((ItemDefs[it->type].type & IT_SHIP)
                     && (!(ItemDefs[it->type].flags & ItemType::DISABLED))) {
                         st = -(it->type);
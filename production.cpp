@@ -65,19 +65,13 @@ void Production::Writeout(Aoutfile *f)
 
 void Production::Readin(Ainfile *f)
 {
-    AString *temp;
-
-    temp = f->GetStr();
-    itemtype = LookupItem(temp);
-    delete temp;
+    itemtype = LookupItem(f->GetView());
 
     amount = f->GetInt();
     baseamount = f->GetInt();
 
-    if (itemtype == I_SILVER) temp = f->GetStr();
-    else temp = new AString(ItemDefs[itemtype].pSkill);
-    skill = LookupSkill(temp);
-    delete temp;
+    if (itemtype == I_SILVER) skill = LookupSkill(f->GetView());
+    else skill = LookupSkill(ItemDefs[itemtype].pSkill);
 
     productivity = f->GetInt();
 }
@@ -0,0 +1,160 @@
+// START A3HEADER
+//
+// This source file is part of the Atlantis PBM game program.
+// Copyright (C) 1995-1999 Geoff Dunbar
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program, in the file license.txt. If not, write
+// to the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+//
+// See the Atlantis Project web page for details:
+// http://www.prankster.com/project
+//
+// END A3HEADER
+#include "profile.h"
+#include "fileio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <new>
+
+std::atomic<long> profilecounters[NPROFILECOUNTERS];
+
+static char const *countername[NPROFILECOUNTERS] = {
+    "battles",
+    "units_moved",
+    "cansee_calls"
+};
+
+//
+// Every allocation made with new goes through here, so the profile can
+// count them.  The other forms of new and delete all end up in these.
+//
+static std::atomic<long> allocations;
+
+void *operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+static double Seconds(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void ProfileSample::Take()
+{
+    struct rusage ru;
+    wall = Seconds(CLOCK_MONOTONIC);
+    cpu = Seconds(CLOCK_PROCESS_CPUTIME_ID);
+    allocations = ::allocations.load(std::memory_order_relaxed);
+    getrusage(RUSAGE_SELF, &ru);
+    peakrss = ru.ru_maxrss;
+    for (int i = 0; i < NPROFILECOUNTERS; i++)
+        counters[i] = profilecounters[i].load(std::memory_order_relaxed);
+}
+
+TurnProfile::TurnProfile()
+{
+    enabled = 0;
+    current = 0;
+}
+
+void TurnProfile::Enable()
+{
+    enabled = 1;
+}
+
+void TurnProfile::StartPhase(char const *name)
+{
+    if (!enabled) return;
+    Stop();
+    current = new ProfilePhase;
+    // Phase names come from the progress messages, "Doing this..."
+    int len = strlen(name);
+    while (len > 0 && name[len - 1] == '.') len--;
+    current->name = AString(name, len);
+    current->start.Take();
+    phases.Add(current);
+}
+
+void TurnProfile::Stop()
+{
+    if (!current) return;
+    current->end.Take();
+    current = 0;
+}
+
+// The JSON for the change between two samples, without the braces
+static AString Changes(ProfileSample *start, ProfileSample *end)
+{
+    char buf[128];
+    sprintf(buf, "\"wall_ms\": %.3f, \"cpu_ms\": %.3f, "
+            "\"allocations\": %ld, \"peak_rss_kb\": %ld",
+            (end->wall - start->wall) * 1000.0,
+            (end->cpu - start->cpu) * 1000.0,
+            end->allocations - start->allocations, end->peakrss);
+    AString s = buf;
+    for (int i = 0; i < NPROFILECOUNTERS; i++) {
+        sprintf(buf, ", \"%s\": %ld", countername[i],
+                end->counters[i] - start->counters[i]);
+        s += buf;
+    }
+    return s;
+}
+
+int TurnProfile::Write(char const *filename, int year, int month,
+        int threads)
+{
+    Stop();
+    if (!enabled || !phases.Num()) return 1;
+
+    Aoutfile f;
+    if (f.OpenByName(filename) == -1) return 0;
+
+    ProfilePhase *first = (ProfilePhase *) phases.First();
+    ProfilePhase *last = first;
+    f.PutStr("{");
+    f.PutStr(AString("  \"year\": ") + year + ",");
+    f.PutStr(AString("  \"month\": ") + (month + 1) + ",");
+    f.PutStr(AString("  \"threads\": ") + threads + ",");
+    f.PutStr("  \"phases\": [");
+    forlist(&phases) {
+        ProfilePhase *p = (ProfilePhase *) elem;
+        AString line = AString("    {\"name\": \"") + p->name + "\", " +
+            Changes(&p->start, &p->end) + "}";
+        if (p->next) line += ",";
+        f.PutStr(line);
+        last = p;
+    }
+    f.PutStr("  ],");
+    f.PutStr(AString("  \"total\": {") +
+            Changes(&first->start, &last->end) + "}");
+    f.PutStr("}");
+    f.Close();
+    return 1;
+}
@@ -0,0 +1,89 @@
+// START A3HEADER
+//
+// This source file is part of the Atlantis PBM game program.
+// Copyright (C) 1995-1999 Geoff Dunbar
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program, in the file license.txt. If not, write
+// to the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+//
+// See the Atlantis Project web page for details:
+// http://www.prankster.com/project
+//
+// END A3HEADER
+#ifndef PROFILE_CLASS
+#define PROFILE_CLASS
+
+#include "alist.h"
+#include "astring.h"
+
+#include <atomic>
+
+/// Things counted over a turn for the turn profile
+enum {
+    PROFILE_BATTLES,            ///< Battles actually fought
+    PROFILE_UNITS_MOVED,        ///< One per unit per hex walked or sailed
+    PROFILE_CANSEE,             ///< Calls to Faction::CanSee
+    NPROFILECOUNTERS
+};
+
+extern std::atomic<long> profilecounters[NPROFILECOUNTERS];
+
+/// Counts something for the turn profile; safe from any thread
+inline void ProfileCount(int counter, int n = 1)
+{
+    profilecounters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+/// Where the process stood at some moment
+struct ProfileSample {
+    double wall;                ///< Seconds, from a monotonic clock
+    double cpu;                 ///< Process CPU seconds, all threads
+    long allocations;           ///< Calls to operator new so far
+    long peakrss;               ///< Peak resident size so far, in KB
+    long counters[NPROFILECOUNTERS];
+
+    void Take();
+};
+
+class ProfilePhase : public AListElem {
+    public:
+        AString name;
+        ProfileSample start;
+        ProfileSample end;
+};
+
+/// Timings and counters for each phase of a turn
+/**
+Each phase runs from its StartPhase() to the next one, or to Stop().
+Write() puts the phases out as JSON, with the time, CPU time,
+allocations and counters spent in each phase and the peak RSS at its
+end.  Until Enable() is called, StartPhase() and Stop() do nothing.
+*/
+class TurnProfile {
+    public:
+        TurnProfile();
+
+        void Enable();
+        void StartPhase(char const *name);
+        void Stop();
+        int Write(char const *filename, int year, int month, int threads);
+
+    private:
+        int enabled;
+        ProfilePhase *current;
+        AList phases;
+};
+
+#endif
@@ -40,26 +40,16 @@ Quest::Quest()
     regionname = "-";
 }
 
-Quest::~Quest()
-{
-    Item *i;
-
-    forlist(&rewards) {
-        i = (Item *) elem;
-        rewards.Remove(i);
-        delete i;
-    }
-}
-
 int QuestList::ReadQuests(Ainfile *f)
 {
         int count, dests, rewards;
     Quest *quest;
     AString *name;
-    Item *item;
+    Item item;
 
     quests.DeleteAll();
 
+    f->StartSection(SECTION_QUESTS);
         count = f->GetInt();
     if (count < 0)
         return 0;
@@ -115,14 +105,15 @@ int QuestList::ReadQuests(Ainfile *f)
         }
         rewards = f->GetInt();
         while (rewards-- > 0) {
-            item = new Item();
-            item->Readin(f);
-            if (-1 == item->type)
+            item.Readin(f);
+            if (-1 == item.type)
                 return 0;
-            quest->rewards.Add(item);
+            quest->rewards.SetNum(item.type,
+                    quest->rewards.GetNum(item.type) + item.num);
         }
         quests.Add(quest);
     }
+    f->EndSection();
 
         return 1;
 }
@@ -130,9 +121,9 @@ int QuestList::ReadQuests(Ainfile *f)
 void QuestList::WriteQuests(Aoutfile *f)
 {
     Quest *q;
-    Item *i;
     set<string>::iterator it;
 
+    f->StartSection(SECTION_QUESTS);
         f->PutInt(quests.Num());
     forlist(this) {
         q = (Quest *) elem;
@@ -185,14 +176,11 @@ void QuestList::WriteQuests(Aoutfile *f)
                 }
                 break;
         }
-        f->PutInt(q->rewards.Num());
-        forlist(&q->rewards) {
-            i = (Item *) elem;
-            i->Writeout(f);
-        }
+        q->rewards.Writeout(f);
     }
 
     f->PutInt(0);
+    f->EndSection();
 
         return;
 }
@@ -200,14 +188,12 @@ void QuestList::WriteQuests(Aoutfile *f)
 int QuestList::CheckQuestKillTarget(Unit * u, ItemList *reward)
 {
     Quest *q;
-    Item *i;
 
     forlist(this) {
         q = (Quest *) elem;
         if (q->type == Quest::SLAY && q->target == u->num) {
             // This dead thing was the target of a quest!
-            forlist (&q->rewards) {
-                i = (Item *) elem;
+            forlist_items(&q->rewards, i) {
                 reward->SetNum(i->type, reward->GetNum(i->type) + i->num);
             }
             this->Remove(q);
@@ -224,7 +210,6 @@ int QuestList::CheckQuestHarvestTarget(ARegion *r,
         Unit *u)
 {
     Quest *q;
-    Item *i;
 
     forlist(this) {
         q = (Quest *) elem;
@@ -232,8 +217,7 @@ int QuestList::CheckQuestHarvestTarget(ARegion *r,
                 q->regionnum == r->num &&
                 q->objective.type == item) {
             if (getrandom(max) < harvested) {
-                forlist (&q->rewards) {
-                    i = (Item *) elem;
+                forlist_items(&q->rewards, i) {
                     u->items.SetNum(i->type, u->items.GetNum(i->type) + i->num);
                     u->faction->DiscoverItem(i->type, 0, 1);
                 }
@@ -251,15 +235,13 @@ int QuestList::CheckQuestBuildTarget(ARegion *r, int building,
         Unit *u)
 {
     Quest *q;
-    Item *i;
 
     forlist(this) {
         q = (Quest *) elem;
         if (q->type == Quest::BUILD &&
                 q->building == building &&
                 q->regionname == *r->name) {
-            forlist (&q->rewards) {
-                i = (Item *) elem;
+            forlist_items(&q->rewards, i) {
                 u->items.SetNum(i->type, u->items.GetNum(i->type) + i->num);
                 u->faction->DiscoverItem(i->type, 0, 1);
             }
@@ -276,7 +258,6 @@ int QuestList::CheckQuestVisitTarget(ARegion *r, Unit *u)
 {
     Quest *q;
     Object *o;
-    Item *i;
     set<string> intersection;
     set<string>::iterator it;
 
@@ -304,8 +285,7 @@ int QuestList::CheckQuestVisitTarget(ARegion *r, Unit *u)
                     // This unit has visited the
                     // required buildings in all those
                     // regions, so they win
-                    forlist (&q->rewards) {
-                        i = (Item *) elem;
+                    forlist_items(&q->rewards, i) {
                         u->items.SetNum(i->type, u->items.GetNum(i->type) + i->num);
                         u->faction->DiscoverItem(i->type, 0, 1);
                     }
@@ -324,15 +304,13 @@ int QuestList::CheckQuestDemolishTarget(ARegion *r, int building,
         Unit *u)
 {
     Quest *q;
-    Item *i;
 
     forlist(this) {
         q = (Quest *) elem;
         if (q->type == Quest::DEMOLISH &&
                 q->regionnum == r->num &&
                 q->target == building) {
-            forlist (&q->rewards) {
-                i = (Item *) elem;
+            forlist_items(&q->rewards, i) {
                 u->items.SetNum(i->type, u->items.GetNum(i->type) + i->num);
                 u->faction->DiscoverItem(i->type, 0, 1);
             }
@@ -39,7 +39,6 @@ class Quest : public AListElem
 {
     public:
         Quest();
-        ~Quest();
 
         enum {
             SLAY,
@@ -56,7 +55,7 @@ class Quest : public AListElem
         int    regionnum;
         AString    regionname;
         set<string> destinations;
-        AList    rewards;
+        ItemList    rewards;
 };
 
 class QuestList : public AList
@@ -26,87 +26,94 @@
 #include "game.h"
 #include "gamedata.h"
 #include "quests.h"
+#include "threadpool.h"
+
+#include <mutex>
+
+// Guards the faction trade and tax region lists while region phases run
+// on several threads
+static std::mutex regionlimits;
 
 void Game::RunOrders()
 {
     //
     // Form and instant orders are handled during parsing
     //
-    Awrite("Running FIND Orders...");
+    Phase("Running FIND Orders...");
     RunFindOrders();
-    Awrite("Running ENTER/LEAVE Orders...");
+    Phase("Running ENTER/LEAVE Orders...");
     RunEnterOrders(0);
-    Awrite("Running PROMOTE/EVICT Orders...");
+    Phase("Running PROMOTE/EVICT Orders...");
     RunPromoteOrders();
-    Awrite("Running Combat...");
+    Phase("Running Combat...");
     DoAttackOrders();
     DoAutoAttacks();
-    Awrite("Running STEAL/ASSASSINATE Orders...");
+    Phase("Running STEAL/ASSASSINATE Orders...");
     RunStealOrders();
-    Awrite("Running GIVE Orders...");
+    Phase("Running GIVE Orders...");
     DoGiveOrders();
-    Awrite("Running ENTER NEW Orders...");
+    Phase("Running ENTER NEW Orders...");
     RunEnterOrders(1);
-    Awrite("Running EXCHANGE Orders...");
+    Phase("Running EXCHANGE Orders...");
     DoExchangeOrders();
-    Awrite("Running DESTROY Orders...");
+    Phase("Running DESTROY Orders...");
     RunDestroyOrders();
-    Awrite("Running PILLAGE Orders...");
+    Phase("Running PILLAGE Orders...");
     RunPillageOrders();
-    Awrite("Running TAX Orders...");
+    Phase("Running TAX Orders...");
     RunTaxOrders();
-    Awrite("Running GUARD 1 Orders...");
+    Phase("Running GUARD 1 Orders...");
     DoGuard1Orders();
-    Awrite("Running Magic Orders...");
+    Phase("Running Magic Orders...");
     ClearCastEffects();
     RunCastOrders();
-    Awrite("Running SELL Orders...");
+    Phase("Running SELL Orders...");
     RunSellOrders();
-    Awrite("Running BUY Orders...");
+    Phase("Running BUY Orders...");
     RunBuyOrders();
-    Awrite("Running FORGET Orders...");
+    Phase("Running FORGET Orders...");
     RunForgetOrders();
-    Awrite("Mid-Turn Processing...");
+    Phase("Mid-Turn Processing...");
     MidProcessTurn();
-    Awrite("Running QUIT Orders...");
+    Phase("Running QUIT Orders...");
     RunQuitOrders();
-    Awrite("Removing Empty Units...");
+    Phase("Removing Empty Units...");
     DeleteEmptyUnits();
     // SinkUncrewedFleets();
     // DrownUnits();
     if (Globals->ALLOW_WITHDRAW) {
-        Awrite("Running WITHDRAW Orders...");
+        Phase("Running WITHDRAW Orders...");
         DoWithdrawOrders();
     }
 /*
-    Awrite("Running Sail Orders...");
+    Phase("Running Sail Orders...");
     RunSailOrders();
-    Awrite("Running Move Orders...");
+    Phase("Running Move Orders...");
     RunMoveOrders();
 */
-    Awrite("Running Consolidated Movement Orders...");
+    Phase("Running Consolidated Movement Orders...");
     RunMovementOrders();
 
     SinkUncrewedFleets();
     DrownUnits();
     FindDeadFactions();
-    Awrite("Running Teach Orders...");
+    Phase("Running Teach Orders...");
     RunTeachOrders();
-    Awrite("Running Month-long Orders...");
+    Phase("Running Month-long Orders...");
     RunMonthOrders();
     RunTeleportOrders();
     if (Globals->TRANSPORT & GameDefs::ALLOW_TRANSPORT) {
-        Awrite("Running Transport Orders...");
+        Phase("Running Transport Orders...");
         CheckTransportOrders();
         RunTransportOrders();
     }
-    Awrite("Assessing Maintenance costs...");
+    Phase("Assessing Maintenance costs...");
     AssessMaintenance();
     if (Globals->DYNAMIC_POPULATION) {
-        Awrite("Processing Migration...");
+        Phase("Processing Migration...");
         ProcessMigration();
     }
-    Awrite("Post-Turn Processing...");
+    Phase("Post-Turn Processing...");
     PostProcessTurn();
     DeleteEmptyUnits();
     // EmptyHell(); moved to Game::RunGame()
@@ -133,6 +140,7 @@ void Game::RunCastOrders()
 {
     forlist(&regions) {
         ARegion *r = (ARegion *) elem;
+        RandomStream stream(r->num, RANDOM_CAST);
         forlist(&r->objects) {
             Object *o = (Object *) elem;
             forlist(&o->units) {
@@ -175,6 +183,7 @@ int Game::TaxCheck(ARegion *pReg, Faction *pFac)
             return(1);
         }
 
+        std::lock_guard<std::mutex> guard(regionlimits);
         forlist(&(pFac->war_regions)) {
             ARegion *x = ((ARegionPtr *) elem)->ptr;
             if (x == pReg) {
@@ -217,6 +226,7 @@ int Game::TradeCheck(ARegion *pReg, Faction *pFac)
             return(1);
         }
 
+        std::lock_guard<std::mutex> guard(regionlimits);
         forlist(&(pFac->trade_regions)) {
             ARegion *x = ((ARegionPtr *) elem)->ptr;
             if (x == pReg) {
@@ -253,6 +263,7 @@ void Game::RunStealOrders()
 {
     forlist(&regions) {
         ARegion *r = (ARegion *) elem;
+        RandomStream stream(r->num, RANDOM_STEAL);
         forlist(&r->objects) {
             Object *o = (Object *) elem;
             forlist_safe(&o->units) {
@@ -344,7 +355,7 @@ void Game::Do1Assassinate(ARegion *r, Object *o, Unit *u)
             f->Event(temp);
         }
         // One learns from one's mistakes.  Surviving them is another matter!
-        u->PracticeAttribute("stealth");
+        u->PracticeAttribute(AT_STEALTH);
         return;
     }
 
@@ -360,7 +371,7 @@ void Game::Do1Assassinate(ARegion *r, Object *o, Unit *u)
             return;
         }
     }
-    u->PracticeAttribute("stealth");
+    u->PracticeAttribute(AT_STEALTH);
     RunBattle(r, u, tar, ass);
 }
 
@@ -418,7 +429,7 @@ void Game::Do1Steal(ARegion *r, Object *o, Unit *u)
             f->Event(temp);
         }
         // One learns from one's mistakes.  Surviving them is another matter!
-        u->PracticeAttribute("stealth");
+        u->PracticeAttribute(AT_STEALTH);
         return;
     }
 
@@ -458,7 +469,7 @@ void Game::Do1Steal(ARegion *r, Object *o, Unit *u)
     }
 
     tar->Event(AString("Has ") + ItemString(so->item, amt) + " stolen.");
-    u->PracticeAttribute("stealth");
+    u->PracticeAttribute(AT_STEALTH);
     return;
 }
 
@@ -650,11 +661,361 @@ void Game::RunFindUnit(Unit *u)
     u->findorders.DeleteAll();
 }
 
-void Game::RunTaxOrders()
+struct RegionPhaseJob {
+    Game *game;
+    int phase;
+    ARegion **regions;
+    int *jobs;
+    FactionOutput *output;
+};
+
+void Game::RunRegionJob(int n, void *arg)
+{
+    RegionPhaseJob *job = (RegionPhaseJob *) arg;
+    int i = job->jobs[n];
+    job->output[i].Capture();
+    job->game->RunPhaseRegion(job->phase, job->regions[i]);
+    job->output[i].Release();
+}
+
+//
+// Run one of the region phases.  Normally the regions are run one after
+// another.  With more than one thread and random streams switched on, the
+// regions that can't affect each other are run on the thread pool, and the
+// rest after them in region order.  Faction output from every region is
+// held back and handed over in region order at the end, so the turn comes
+// out the same whatever the number of threads.
+//
+void Game::RunRegionPhase(int phase)
 {
+    if (threads < 2 || !randomstreams()) {
+        forlist(&regions) {
+            RunPhaseRegion(phase, (ARegion *) elem);
+        }
+        return;
+    }
+
+    if (!pool) pool = new ThreadPool(threads);
+
+    if (phase == PHASE_ATTACK || phase == PHASE_AUTOATTACK) {
+        RunBattlePhase(phase);
+        return;
+    }
+
+    int count = regions.Num();
+    ARegion **list = new ARegion *[count];
+    int i = 0;
     forlist(&regions) {
-        RunTaxRegion((ARegion *) elem);
+        list[i++] = (ARegion *) elem;
+    }
+
+    // Count the regions each faction may trade or tax in
+    int maxfac = 0;
+    forlist_reuse(&factions) {
+        Faction *f = (Faction *) elem;
+        if (f->num > maxfac) maxfac = f->num;
+    }
+    int *facregions = new int[maxfac + 1];
+    int *lastregion = new int[maxfac + 1];
+    for (i = 0; i <= maxfac; i++) {
+        facregions[i] = 0;
+        lastregion[i] = -1;
+    }
+    for (i = 0; i < count; i++) {
+        forlist(&list[i]->objects) {
+            Object *o = (Object *) elem;
+            forlist(&o->units) {
+                Unit *u = (Unit *) elem;
+                if (!UsesRegionLimit(phase, u)) continue;
+                if (lastregion[u->faction->num] != i) {
+                    lastregion[u->faction->num] = i;
+                    facregions[u->faction->num]++;
+                }
+            }
+        }
     }
+
+    int *jobs = new int[count];
+    int *inorder = new int[count];
+    int numjobs = 0, numinorder = 0;
+    for (i = 0; i < count; i++) {
+        if (MustRunInOrder(phase, list[i], facregions))
+            inorder[numinorder++] = i;
+        else
+            jobs[numjobs++] = i;
+    }
+
+    FactionOutput *output = new FactionOutput[count];
+    RegionPhaseJob job;
+    job.game = this;
+    job.phase = phase;
+    job.regions = list;
+    job.jobs = jobs;
+    job.output = output;
+    pool->Run(numjobs, RunRegionJob, &job);
+
+    for (i = 0; i < numinorder; i++) {
+        int n = inorder[i];
+        output[n].Capture();
+        RunPhaseRegion(phase, list[n]);
+        output[n].Release();
+    }
+
+    for (i = 0; i < count; i++)
+        output[i].Replay();
+
+    delete [] output;
+    delete [] inorder;
+    delete [] jobs;
+    delete [] lastregion;
+    delete [] facregions;
+    delete [] list;
+}
+
+void Game::RunPhaseRegion(int phase, ARegion *r)
+{
+    switch (phase) {
+        case PHASE_PILLAGE: {
+            RandomStream stream(r->num, RANDOM_PILLAGE);
+            RunPillageRegion(r);
+            break;
+        }
+        case PHASE_TAX: {
+            RandomStream stream(r->num, RANDOM_TAX);
+            RunTaxRegion(r);
+            break;
+        }
+        case PHASE_MONTH: {
+            RandomStream stream(r->num, RANDOM_MONTH);
+            RunMonthRegion(r);
+            break;
+        }
+        case PHASE_ATTACK: {
+            RandomStream stream(r->num, RANDOM_ATTACK);
+            RunAttackRegion(r);
+            break;
+        }
+        case PHASE_AUTOATTACK: {
+            RandomStream stream(r->num, RANDOM_AUTOATTACK);
+            RunAutoAttackRegion(r);
+            break;
+        }
+    }
+}
+
+//
+// The battle phases.  A battle in a region pulls in units from the
+// neighbouring regions, so two regions can only be run at the same time
+// if they have no region in common between them and their neighbours.
+// Regions where nobody can start a fight are left out.  The rest are put
+// into waves: each region goes in the first wave after every earlier
+// region it shares a neighbour with, so any two regions that could see
+// each other's battles still run in region order.  A region whose
+// battles could raise undead makes new units, and their numbers must be
+// handed out in region order, so it gets a wave to itself.
+//
+void Game::RunBattlePhase(int phase)
+{
+    int count = regions.Num();
+    ARegion **list = new ARegion *[count];
+    int i = 0, maxnum = 0;
+    forlist(&regions) {
+        ARegion *r = (ARegion *) elem;
+        list[i++] = r;
+        if (r->num > maxnum) maxnum = r->num;
+    }
+
+    int *lastwave = new int[maxnum + 1];
+    for (i = 0; i <= maxnum; i++) lastwave[i] = 0;
+    int *wave = new int[count];
+    int maxwave = 0, floor = 0;
+    for (i = 0; i < count; i++) {
+        ARegion *r = list[i];
+        wave[i] = 0;
+        if (!MayFight(phase, r)) continue;
+
+        int w = floor + 1;
+        if (lastwave[r->num] >= w) w = lastwave[r->num] + 1;
+        int d;
+        for (d = 0; d < NDIRS; d++) {
+            ARegion *n = r->neighbors[d];
+            if (n && lastwave[n->num] >= w) w = lastwave[n->num] + 1;
+        }
+        if (MayRaiseUndead(r)) {
+            if (w <= maxwave) w = maxwave + 1;
+            floor = w;
+        }
+        wave[i] = w;
+        if (w > maxwave) maxwave = w;
+        lastwave[r->num] = w;
+        for (d = 0; d < NDIRS; d++) {
+            ARegion *n = r->neighbors[d];
+            if (n) lastwave[n->num] = w;
+        }
+    }
+
+    FactionOutput *output = new FactionOutput[count];
+    int *jobs = new int[count];
+    RegionPhaseJob job;
+    job.game = this;
+    job.phase = phase;
+    job.regions = list;
+    job.jobs = jobs;
+    job.output = output;
+    for (int w = 1; w <= maxwave; w++) {
+        int numjobs = 0;
+        for (i = 0; i < count; i++)
+            if (wave[i] == w) jobs[numjobs++] = i;
+        pool->Run(numjobs, RunRegionJob, &job);
+    }
+
+    for (i = 0; i < count; i++)
+        output[i].Replay();
+
+    delete [] jobs;
+    delete [] output;
+    delete [] wave;
+    delete [] lastwave;
+    delete [] list;
+}
+
+// Returns 0 if nothing in the region can start a battle in the phase
+int Game::MayFight(int phase, ARegion *r)
+{
+    if (phase == PHASE_ATTACK) {
+        forlist(&r->objects) {
+            Object *o = (Object *) elem;
+            forlist(&o->units) {
+                Unit *u = (Unit *) elem;
+                if (!u->IsAlive()) continue;
+                if (u->type == U_WMON) {
+                    if (u->canattack) return 1;
+                } else if (u->attackorders) {
+                    return 1;
+                }
+            }
+        }
+        return 0;
+    }
+
+    // Unit::GetAttitude can only come out hostile if the faction's
+    // declared or default attitude is
+    forlist(&r->objects) {
+        Object *o = (Object *) elem;
+        forlist(&o->units) {
+            Unit *u = (Unit *) elem;
+            if (!u->canattack || !u->IsAlive() || u->guard == GUARD_AVOID)
+                continue;
+            Faction *f = u->faction;
+            forlist(&r->objects) {
+                Object *o2 = (Object *) elem;
+                forlist(&o2->units) {
+                    Unit *t = (Unit *) elem;
+                    if (t->faction == f) continue;
+                    if (f->defaultattitude == A_HOSTILE ||
+                            f->GetAttitude(t->faction->num) == A_HOSTILE)
+                        return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+// Returns 1 if a battle in the region might raise undead (see
+// UNDEATH_CONTAGION)
+int Game::MayRaiseUndead(ARegion *r)
+{
+    if (Globals->UNDEATH_CONTAGION < 1 || monfaction < 1) return 0;
+    for (int d = -1; d < NDIRS; d++) {
+        ARegion *n = (d == -1) ? r : r->neighbors[d];
+        if (!n) continue;
+        forlist(&n->objects) {
+            Object *o = (Object *) elem;
+            forlist(&o->units) {
+                Unit *u = (Unit *) elem;
+                forlist_items(&u->items, i) {
+                    if (ItemDefs[i->type].type & IT_UNDEAD) return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+// Returns 1 if the unit may count towards its faction's trade (in the
+// month phase) or tax (otherwise) region limit
+int Game::UsesRegionLimit(int phase, Unit *u)
+{
+    if (phase == PHASE_MONTH) {
+        return u->monthorders && (u->monthorders->type == O_PRODUCE ||
+                u->monthorders->type == O_BUILD);
+    }
+    return u->taxing != TAX_NONE || u->GetFlag(FLAG_AUTOTAX);
+}
+
+//
+// Returns 1 if running this region for the phase may touch state shared
+// with other regions in a way that depends on the order regions are run
+// in: a faction that could run into its trade or tax region limit, a
+// faction-wide limit on mages, apprentices, quartermasters or tacticians,
+// a new ship (which takes the next ship number) or a quest target.
+// facregions[n] is the number of regions faction n may trade or tax in.
+//
+int Game::MustRunInOrder(int phase, ARegion *r, int *facregions)
+{
+    int limits = (Globals->FACTION_LIMIT_TYPE ==
+            GameDefs::FACLIM_FACTION_TYPES);
+
+    forlist(&r->objects) {
+        Object *o = (Object *) elem;
+        forlist(&o->units) {
+            Unit *u = (Unit *) elem;
+            Faction *f = u->faction;
+            if (limits && UsesRegionLimit(phase, u)) {
+                if (phase == PHASE_MONTH) {
+                    int allowed = AllowedTrades(f);
+                    if (allowed != -1 && f->trade_regions.Num() +
+                            facregions[f->num] > allowed)
+                        return 1;
+                } else {
+                    int allowed = AllowedTaxes(f);
+                    if (allowed != -1 && f->war_regions.Num() +
+                            facregions[f->num] > allowed)
+                        return 1;
+                }
+            }
+            if (phase != PHASE_MONTH || !u->monthorders) continue;
+            if (u->monthorders->type == O_STUDY) {
+                int sk = ((StudyOrder *) u->monthorders)->skill;
+                if (sk == -1) continue;
+                if ((SkillDefs[sk].flags & SkillType::MAGIC) &&
+                        u->type != U_MAGE)
+                    return 1;
+                if ((SkillDefs[sk].flags & SkillType::APPRENTICE) &&
+                        u->type != U_APPRENTICE)
+                    return 1;
+                if (sk == S_QUARTERMASTER || sk == S_TACTICS) return 1;
+            }
+            if (u->monthorders->type == O_BUILD && u->build < 0) return 1;
+        }
+    }
+
+    if (phase == PHASE_MONTH) {
+        forlist(&quests) {
+            Quest *q = (Quest *) elem;
+            if (q->type == Quest::HARVEST && q->regionnum == r->num)
+                return 1;
+            if (q->type == Quest::BUILD && q->regionname == *r->name)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+void Game::RunTaxOrders()
+{
+    RunRegionPhase(PHASE_TAX);
 }
 
 int Game::FortTaxBonus(Object *o, Unit *u)
@@ -753,9 +1114,7 @@ void Game::RunTaxRegion(ARegion *reg)
 
 void Game::RunPillageOrders()
 {
-    forlist (&regions) {
-        RunPillageRegion((ARegion *) elem);
-    }
+    RunRegionPhase(PHASE_PILLAGE);
 }
 
 int Game::CountPillagers(ARegion *reg)
@@ -1020,7 +1379,6 @@ void Game::Do1JoinOrder(ARegion *r, Object *in, Unit *u)
     JoinOrder *jo;
     Unit *tar, *pass;
     Object *to, *from;
-    Item *item;
 
     jo = (JoinOrder *) u->joinorders;
     tar = r->GetUnitId(jo->target, u->faction->num);
@@ -1059,8 +1417,7 @@ void Game::Do1JoinOrder(ARegion *r, Object *in, Unit *u)
             }
         }
         from = u->object;
-        forlist_reuse(&from->ships) {
-            item = (Item *) elem;
+        forlist_items(&from->ships, item) {
             GiveOrder go;
             UnitId id;
             go.amount = item->num;
@@ -1168,6 +1525,7 @@ void Game::MidProcessTurn()
 {
     forlist(&regions) {
         ARegion *r = (ARegion *)elem;
+        RandomStream stream(r->num, RANDOM_MIDTURN);
         // r->MidTurn(); // Not yet implemented
         /* regional population dynamics */
         if (Globals->DYNAMIC_POPULATION) r->Grow();
@@ -1229,6 +1587,7 @@ void Game::PostProcessTurn()
 
     forlist_reuse(&regions) {
         ARegion *r = (ARegion *) elem;
+        RandomStream stream(r->num, RANDOM_POSTTURN);
         r->PostTurn(&regions);
 
         if (Globals->CITY_MONSTERS_EXIST && (r->town || r->type == R_NEXUS))
@@ -1252,15 +1611,17 @@ void Game::PostProcessTurn()
 
 void Game::DoAutoAttacks()
 {
-    forlist(&regions) {
-        ARegion *r = (ARegion *) elem;
-        forlist(&r->objects) {
-            Object *o = (Object *) elem;
-            forlist(&o->units) {
-                Unit *u = (Unit *) elem;
-                if (u->canattack && u->IsAlive())
-                    DoAutoAttack(r, u);
-            }
+    RunRegionPhase(PHASE_AUTOATTACK);
+}
+
+void Game::RunAutoAttackRegion(ARegion *r)
+{
+    forlist(&r->objects) {
+        Object *o = (Object *) elem;
+        forlist(&o->units) {
+            Unit *u = (Unit *) elem;
+            if (u->canattack && u->IsAlive())
+                DoAutoAttack(r, u);
         }
     }
 }
@@ -1391,36 +1752,38 @@ void Game::CheckWMonAttack(ARegion *r, Unit *u) {
 
 void Game::DoAttackOrders()
 {
-    forlist(&regions) {
-        ARegion *r = (ARegion *) elem;
-        forlist(&r->objects) {
-            Object *o = (Object *) elem;
-            forlist(&o->units) {
-                Unit *u = (Unit *) elem;
-                if (u->type == U_WMON) {
-                    if (u->canattack && u->IsAlive()) {
-                        CheckWMonAttack(r, u);
-                    }
-                } else {
-                    if (u->attackorders && u->IsAlive()) {
-                        AttackOrder *ord = u->attackorders;
-                        r->DeduplicateUnitList(&ord->targets, u->faction->num);
-                        while (ord->targets.Num()) {
-                            UnitId *id = (UnitId *) ord->targets.First();
-                            ord->targets.Remove(id);
-                            Unit *t = r->GetUnitId(id, u->faction->num);
-                            delete id;
-                            if (u->canattack && u->IsAlive()) {
-                                if (t) {
-                                    AttemptAttack(r, u, t, 0);
-                                } else {
-                                    u->Error("ATTACK: Non-existent unit.");
-                                }
+    RunRegionPhase(PHASE_ATTACK);
+}
+
+void Game::RunAttackRegion(ARegion *r)
+{
+    forlist(&r->objects) {
+        Object *o = (Object *) elem;
+        forlist(&o->units) {
+            Unit *u = (Unit *) elem;
+            if (u->type == U_WMON) {
+                if (u->canattack && u->IsAlive()) {
+                    CheckWMonAttack(r, u);
+                }
+            } else {
+                if (u->attackorders && u->IsAlive()) {
+                    AttackOrder *ord = u->attackorders;
+                    r->DeduplicateUnitList(&ord->targets, u->faction->num);
+                    while (ord->targets.Num()) {
+                        UnitId *id = (UnitId *) ord->targets.First();
+                        ord->targets.Remove(id);
+                        Unit *t = r->GetUnitId(id, u->faction->num);
+                        delete id;
+                        if (u->canattack && u->IsAlive()) {
+                            if (t) {
+                                AttemptAttack(r, u, t, 0);
+                            } else {
+                                u->Error("ATTACK: Non-existent unit.");
                             }
                         }
-                        delete ord;
-                        u->attackorders = 0;
                     }
+                    delete ord;
+                    u->attackorders = 0;
                 }
             }
         }
@@ -1462,6 +1825,7 @@ void Game::RunSellOrders()
 {
     forlist((&regions)) {
         ARegion *r = (ARegion *) elem;
+        RandomStream stream(r->num, RANDOM_SELL);
         forlist((&r->markets)) {
             Market *m = (Market *) elem;
             if (m->type == M_SELL)
@@ -1554,6 +1918,7 @@ void Game::RunBuyOrders()
 {
     forlist((&regions)) {
         ARegion *r = (ARegion *) elem;
+        RandomStream stream(r->num, RANDOM_BUY);
         forlist((&r->markets)) {
             Market *m = (Market *) elem;
             if (m->type == M_BUY)
@@ -1693,8 +2058,9 @@ void Game::DoBuy(ARegion *r, Market *m)
                             int exp = mt->speciallevel - mt->defaultlevel;
                             if (exp > 0) {
                                 exp = exp * temp * GetDaysByLevel(1);
-                                for (int ms = 0; ms < ((int) sizeof(mt->skills))/((int) sizeof(int)); ms++)
+                                for (int ms = 0; ms < (int) (sizeof(mt->skills) / sizeof(mt->skills[0])); ms++)
                                 {
+                                    if (!mt->skills[ms]) continue;
                                     AString sname = mt->skills[ms];
                                     int skill = LookupSkill(&sname);
                                     if (skill == -1) continue;
@@ -2217,7 +2583,6 @@ int Game::DoWithdrawOrder(ARegion *r, Unit *u, WithdrawOrder *o)
 
 void Game::DoGiveOrders()
 {
-    Item *item;
     Unit *s;
     Object *fleet;
 
@@ -2254,8 +2619,7 @@ void Game::DoGiveOrders()
                             if (fleet->IsFleet() && s == fleet->GetOwner() &&
                                     !o->unfinished &&
                                     (o->item == -NITEMS || o->item == -IT_SHIP)) {
-                                forlist(&fleet->ships) {
-                                    item = (Item *) elem;
+                                forlist_items(&fleet->ships, item) {
                                     GiveOrder go;
                                     go.amount = item->num;
                                     go.except = 0;
@@ -2266,8 +2630,7 @@ void Game::DoGiveOrders()
                                     go.target = NULL;
                                 }
                             }
-                            forlist((&s->items)) {
-                                item = (Item *) elem;
+                            forlist_items(&s->items, item) {
                                 if ((o->item == -NITEMS) ||
                                     (ItemDefs[item->type].type & (-o->item))) {
                                     GiveOrder go;
@@ -2472,11 +2835,10 @@ int Game::DoGiveOrder(ARegion *r, Unit *u, GiveOrder *o)
 {
     int hasitem, ship, num, shipcount, amt, newfleet, cur;
     int notallied, newlvl, oldlvl;
-    Item *it, *sh;
+    Item *it;
     Unit *p, *t, *s;
     Object *fleet;
     AString temp, ord;
-    Skill *skill;
     SkillList *skills;
 
     if (o->type == O_TAKE)
@@ -2497,8 +2859,7 @@ int Game::DoGiveOrder(ARegion *r, Unit *u, GiveOrder *o)
                     return 0;
                 }
                 ship = -1;
-                forlist(&u->items) {
-                    it = (Item *) elem;
+                forlist_items(&u->items, it) {
                     if (it->type == o->item) {
                         u->Event(temp + it->Report(1) + ".");
                         ship = it->type;
@@ -2527,8 +2888,7 @@ int Game::DoGiveOrder(ARegion *r, Unit *u, GiveOrder *o)
             // Check we're not dumping passengers in the ocean
             if (TerrainDefs[r->type].similar_type == R_OCEAN) {
                 shipcount = 0;
-                forlist(&(u->object->ships)) {
-                    sh = (Item *) elem;
+                forlist_items(&u->object->ships, sh) {
                     shipcount += sh->num;
                 }
                 if (shipcount <= o->amount) {
@@ -2658,8 +3018,7 @@ int Game::DoGiveOrder(ARegion *r, Unit *u, GiveOrder *o)
             if (TerrainDefs[r->type].similar_type == R_OCEAN &&
                     !o->merge) {
                 shipcount = 0;
-                forlist(&(s->object->ships)) {
-                    sh = (Item *) elem;
+                forlist_items(&s->object->ships, sh) {
                     shipcount += sh->num;
                 }
                 if (shipcount <= amt) {
@@ -2884,6 +3243,7 @@ int Game::DoGiveOrder(ARegion *r, Unit *u, GiveOrder *o)
 
         u->Event(AString("Gives unit to ") + *(t->faction->name) + ".");
         u->faction = t->faction;
+        r->InvalidateSight();
         u->Event("Is given to your faction.");
 
         if (notallied && u->monthorders && u->monthorders->type == O_MOVE &&
@@ -2894,8 +3254,7 @@ int Game::DoGiveOrder(ARegion *r, Unit *u, GiveOrder *o)
         }
 
         /* Check if any new skill reports have to be shown */
-        forlist(&(u->skills)) {
-            skill = (Skill *) elem;
+        forlist_skills(&u->skills, skill) {
             newlvl = u->GetRealSkill(skill->type);
             oldlvl = u->faction->skills.GetDays(skill->type);
             if (newlvl > oldlvl) {
@@ -2908,8 +3267,7 @@ int Game::DoGiveOrder(ARegion *r, Unit *u, GiveOrder *o)
 
         // Okay, now for each item that the unit has, tell the new faction
         // about it in case they don't know about it yet.
-        forlist_reuse(&u->items) {
-            it = (Item *)elem;
+        forlist_items(&u->items, it) {
             u->faction->DiscoverItem(it->type, 0, 1);
         }
 
@@ -0,0 +1,434 @@
+// START A3HEADER
+//
+// This source file is part of the Atlantis PBM game program.
+// Copyright (C) 1995-1999 Geoff Dunbar
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program, in the file license.txt. If not, write
+// to the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+//
+// See the Atlantis Project web page for details:
+// http://www.prankster.com/project
+//
+// END A3HEADER
+//
+// The simbattle command: the same battle fought over and over outside
+// any game, for trying out monsters, weapons and spells.
+//
+#include "game.h"
+#include "gamedata.h"
+#include "battle.h"
+#include "threadpool.h"
+
+#include <stdio.h>
+#include <math.h>
+
+//
+// One unit of a simbattle spec.  Skills are kept as days per man and
+// only multiplied up once the unit's men are known.
+//
+class SimUnit : public AListElem
+{
+    public:
+        SimUnit(int s);
+
+        int side;
+        ItemList items;
+        SkillList skills;
+        int combat;
+        int behind;
+        int building;
+        int prepare;
+};
+
+SimUnit::SimUnit(int s)
+{
+    side = s;
+    combat = -1;
+    behind = 0;
+    building = -1;
+    prepare = -1;
+}
+
+// What came of one battle
+struct SimResult {
+    int result;
+    int rounds;
+    int lost[2];
+    ItemList taken;
+};
+
+struct SimBattleJob {
+    AList *units;
+    int terrain;
+    ARegionList *regions;
+    SimResult *results;
+    Battle *first;              // Kept for the report, if one is wanted
+};
+
+//
+// Reads the spec into units, returning 0 if there is anything in it
+// that can't be understood.
+//
+static int ReadSimSpec(const AString &filename, AList *units, int *terrain)
+{
+    Aorders f;
+    if (f.OpenByName(filename) == -1) {
+        Awrite(AString("Couldn't open ") + filename);
+        return 0;
+    }
+
+    int rc = 1;
+    int side = 0;
+    SimUnit *u = 0;
+    AString *pLine;
+    while (rc && (pLine = f.GetLine())) {
+        AString *pKey = pLine->gettoken();
+        AString *pArg = 0;
+        AString *pArg2 = 0;
+        if (!pKey) {
+            delete pLine;
+            continue;
+        }
+        pArg = pLine->gettoken();
+        if (pArg) pArg2 = pLine->gettoken();
+
+        if (*pKey == "terrain" && pArg) {
+            *terrain = ParseTerrain(pArg);
+            if (*terrain == -1) {
+                Awrite(AString("Unknown terrain ") + *pArg);
+                rc = 0;
+            }
+        } else if (*pKey == "attackers") {
+            side = 0;
+            u = 0;
+        } else if (*pKey == "defenders") {
+            side = 1;
+            u = 0;
+        } else if (*pKey == "unit") {
+            u = new SimUnit(side);
+            units->Add(u);
+        } else if (!u) {
+            Awrite(AString("No unit for ") + *pKey);
+            rc = 0;
+        } else if (*pKey == "item" && pArg2) {
+            int num = pArg->value();
+            int it = ParseEnabledItem(pArg2);
+            if (it == -1 || num <= 0) {
+                Awrite(AString("Bad item ") + *pArg + " " + *pArg2);
+                rc = 0;
+            } else {
+                u->items.SetNum(it, u->items.GetNum(it) + num);
+            }
+        } else if (*pKey == "skill" && pArg2) {
+            int sk = ParseSkill(pArg);
+            int level = pArg2->value();
+            if (sk == -1 || level <= 0) {
+                Awrite(AString("Bad skill ") + *pArg + " " + *pArg2);
+                rc = 0;
+            } else {
+                u->skills.SetDays(sk, GetDaysByLevel(level));
+            }
+        } else if (*pKey == "combat" && pArg) {
+            u->combat = ParseSkill(pArg);
+            if (u->combat == -1) {
+                Awrite(AString("Unknown skill ") + *pArg);
+                rc = 0;
+            }
+        } else if (*pKey == "behind") {
+            u->behind = 1;
+        } else if (*pKey == "building" && pArg) {
+            u->building = ParseObject(pArg, 0);
+            if (u->building == -1 ||
+                    !(ObjectDefs[u->building].flags & ObjectType::CANENTER)) {
+                Awrite(AString("Bad building ") + *pArg);
+                rc = 0;
+            }
+        } else if (*pKey == "prepare" && pArg) {
+            u->prepare = ParseEnabledItem(pArg);
+            if (u->prepare == -1) {
+                Awrite(AString("Unknown item ") + *pArg);
+                rc = 0;
+            }
+        } else {
+            Awrite(AString("Can't understand ") + *pKey);
+            rc = 0;
+        }
+
+        delete pKey;
+        delete pArg;
+        delete pArg2;
+        delete pLine;
+    }
+
+    if (rc) {
+        int count[2] = { 0, 0 };
+        forlist(units) {
+            count[((SimUnit *) elem)->side]++;
+        }
+        if (!count[0] || !count[1]) {
+            Awrite("The spec needs units on both sides");
+            rc = 0;
+        }
+    }
+    return rc;
+}
+
+//
+// Sets up the units of the spec in a region of their own and fights
+// battle n.  Every battle has its own random stream, so the results
+// don't depend on which thread fights it.
+//
+static void RunSimBattle(int n, void *arg)
+{
+    SimBattleJob *job = (SimBattleJob *) arg;
+    SimResult *res = &job->results[n];
+    RandomStream stream(n, RANDOM_BATTLE);
+
+    ARegion *r = new ARegion;
+    r->num = n;
+    r->type = job->terrain;
+    r->zloc = 0;
+    r->SetName("Battlefield");
+    Object *field = new Object(r);
+    r->objects.Add(field);
+
+    Faction *facs[2] = { new Faction(1), new Faction(2) };
+    AList sides[2];
+    Unit *leaders[2] = { 0, 0 };
+    int seq = 1;
+
+    forlist(job->units) {
+        SimUnit *su = (SimUnit *) elem;
+        Unit *u = new Unit(seq++, facs[su->side]);
+        Object *o = field;
+        if (su->building != -1) {
+            o = new Object(r);
+            o->num = seq;
+            o->type = su->building;
+            o->capacity = ObjectDefs[o->type].protect;
+            r->objects.Add(o);
+        }
+        o->units.Add(u);
+        u->object = o;
+
+        {
+            forlist_items(&su->items, i) {
+                if ((ItemDefs[i->type].type & IT_MONSTER) &&
+                        u->type == U_NORMAL) {
+                    MonType *mp = FindMonster(ItemDefs[i->type].abr,
+                            (ItemDefs[i->type].type & IT_ILLUSION));
+                    u->MakeWMon(mp->name, i->type, i->num);
+                } else {
+                    u->items.SetNum(i->type, i->num);
+                }
+            }
+        }
+        {
+            forlist_skills(&su->skills, s) {
+                u->skills.SetDays(s->type, s->days * u->GetMen());
+                if (SkillDefs[s->type].flags & SkillType::MAGIC) {
+                    u->type = U_MAGE;
+                }
+                if ((SkillDefs[s->type].flags & SkillType::APPRENTICE) &&
+                        u->type == U_NORMAL) {
+                    u->type = U_APPRENTICE;
+                }
+            }
+        }
+        u->AdjustSkills();
+        u->combat = su->combat;
+        u->readyItem = su->prepare;
+        if (su->behind) u->SetFlag(FLAG_BEHIND, 1);
+
+        Location *l = new Location;
+        l->unit = u;
+        l->obj = o;
+        l->region = r;
+        sides[su->side].Add(l);
+        if (!leaders[su->side]) leaders[su->side] = u;
+    }
+
+    int men[2];
+    for (int s = 0; s < 2; s++) {
+        men[s] = 0;
+        forlist(&sides[s]) {
+            men[s] += ((Location *) elem)->unit->GetSoldiers();
+        }
+    }
+
+    Battle *b = new Battle;
+    b->WriteSides(r, leaders[0], leaders[1], &sides[0], &sides[1], 0,
+            job->regions);
+    res->result = b->Run(r, leaders[0], &sides[0], leaders[1], &sides[1], 0,
+            job->regions);
+    res->rounds = b->rounds;
+    {
+        forlist_items(&b->taken, i) {
+            res->taken.SetNum(i->type, i->num);
+        }
+    }
+
+    for (int s = 0; s < 2; s++) {
+        res->lost[s] = men[s];
+        forlist(&sides[s]) {
+            res->lost[s] -= ((Location *) elem)->unit->GetSoldiers();
+        }
+    }
+
+    if (n == 0) job->first = b;
+    else delete b;
+    delete r;
+    delete facs[0];
+    delete facs[1];
+}
+
+static void WriteLosses(char const *side, SimResult *results, int runs,
+        int s, int men)
+{
+    double total = 0;
+    double squares = 0;
+    int least = results[0].lost[s];
+    int most = least;
+    for (int n = 0; n < runs; n++) {
+        total += results[n].lost[s];
+        squares += (double) results[n].lost[s] * results[n].lost[s];
+        if (results[n].lost[s] < least) least = results[n].lost[s];
+        if (results[n].lost[s] > most) most = results[n].lost[s];
+    }
+    double mean = total / runs;
+    double var = squares / runs - mean * mean;
+    char buf[200];
+    snprintf(buf, sizeof(buf), "%s lost %.1f of %d on average "
+            "(sd %.1f, least %d, most %d).", side, mean, men,
+            var > 0 ? sqrt(var) : 0.0, least, most);
+    Awrite(buf);
+}
+
+static void WriteSpoils(char const *side, SimResult *results, int runs,
+        int won)
+{
+    ItemList total;
+    int wins = 0;
+    for (int n = 0; n < runs; n++) {
+        if (results[n].result != won) continue;
+        wins++;
+        forlist_items(&results[n].taken, i) {
+            total.SetNum(i->type, total.GetNum(i->type) + i->num);
+        }
+    }
+    if (!wins) return;
+
+    AString temp = AString(side) + " took on average per win:";
+    if (!total.Num()) temp += " nothing";
+    int first = 1;
+    forlist_items(&total, i) {
+        char buf[200];
+        snprintf(buf, sizeof(buf), "%s %.1f %s [%s]", first ? "" : ",",
+                (double) i->num / wins, ItemDefs[i->type].names,
+                ItemDefs[i->type].abr);
+        temp += buf;
+        first = 0;
+    }
+    temp += ".";
+    Awrite(temp);
+}
+
+int Game::SimBattle(const AString &specfile, int runs, int seed,
+        char const *reportfile)
+{
+    AList units;
+    int terrain = R_PLAIN;
+    if (!ReadSimSpec(specfile, &units, &terrain)) return 0;
+    if (runs < 1) runs = 1;
+
+    seedrandom(seed);
+    setrandomstreams(1);
+    if (!pool) pool = new ThreadPool(threads);
+
+    // ShortPrint needs a level for the battlefield to be on
+    ARegionList battlefield;
+    battlefield.CreateLevels(1);
+    battlefield.pRegionArrays[0] = new ARegionArray(1, 1);
+
+    SimBattleJob job;
+    job.units = &units;
+    job.terrain = terrain;
+    job.regions = &battlefield;
+    job.results = new SimResult[runs];
+    job.first = 0;
+
+    ProfileSample start, end;
+    start.Take();
+    pool->Run(runs, RunSimBattle, &job);
+    end.Take();
+
+    int men[2] = { 0, 0 };
+    {
+        forlist(&units) {
+            SimUnit *su = (SimUnit *) elem;
+            forlist_items(&su->items, i) {
+                if (IsSoldier(i->type)) men[su->side] += i->num;
+            }
+        }
+    }
+
+    int outcomes[4] = { 0, 0, 0, 0 };
+    long rounds = 0;
+    int fewest = job.results[0].rounds;
+    int most = fewest;
+    for (int n = 0; n < runs; n++) {
+        SimResult *res = &job.results[n];
+        outcomes[res->result]++;
+        rounds += res->rounds;
+        if (res->rounds < fewest) fewest = res->rounds;
+        if (res->rounds > most) most = res->rounds;
+    }
+
+    char buf[200];
+    double secs = end.wall - start.wall;
+    snprintf(buf, sizeof(buf), "Fought %d battles in %.3f s on %d "
+            "threads (%.1f battles/s).", runs, secs, pool->Threads(),
+            secs > 0 ? runs / secs : 0.0);
+    Awrite(buf);
+    Awrite("");
+    snprintf(buf, sizeof(buf), "Attackers won %.1f%%, defenders won %.1f%%, "
+            "%.1f%% drawn.", 100.0 * outcomes[BATTLE_WON] / runs,
+            100.0 * outcomes[BATTLE_LOST] / runs,
+            100.0 * outcomes[BATTLE_DRAW] / runs);
+    Awrite(buf);
+    snprintf(buf, sizeof(buf), "Rounds fought: %.1f on average "
+            "(fewest %d, most %d).", (double) rounds / runs, fewest, most);
+    Awrite(buf);
+    WriteLosses("Attackers", job.results, runs, 0, men[0]);
+    WriteLosses("Defenders", job.results, runs, 1, men[1]);
+    WriteSpoils("Attackers", job.results, runs, BATTLE_WON);
+    WriteSpoils("Defenders", job.results, runs, BATTLE_LOST);
+
+    int rc = 1;
+    if (reportfile && job.first) {
+        Areport f;
+        if (f.OpenByName(reportfile) == -1) {
+            Awrite(AString("Couldn't open ") + reportfile);
+            rc = 0;
+        } else {
+            job.first->Report(&f, 0);
+            f.Close();
+        }
+    }
+
+    delete job.first;
+    delete [] job.results;
+    return rc;
+}
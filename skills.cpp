@@ -29,68 +29,132 @@
 #include "skills.h"
 #include "items.h"
 #include "gamedata.h"
+#include "lookup.h"
+
+static LookupTable rangeIndex;
+static LookupTable specialIndex;
+static LookupTable effectIndex;
+static LookupTable attribIndex;
+static LookupTable skillIndex;
+static int skillsIndexed = 0;
+
+int AT_TACTICS = -1;
+int AT_COMBAT = -1;
+int AT_STEALTH = -1;
+int AT_OBSERVATION = -1;
+int AT_WIND = -1;
+int AT_ENTERTAINMENT = -1;
+int AT_TOUGHNESS = -1;
+
+// Build the lookup tables for the skill related rule tables.  This is
+// done the first time anything is looked up, and again by main() once
+// ModifyTablesPerRuleset has finished changing the tables.
+void IndexSkillDefs()
+{
+    int i;
+
+    rangeIndex.Clear();
+    for (i = 0; i < NUMRANGES; i++)
+        rangeIndex.Add(RangeDefs[i].key, i);
+    specialIndex.Clear();
+    for (i = 0; i < NUMSPECIALS; i++)
+        specialIndex.Add(SpecialDefs[i].key, i);
+    effectIndex.Clear();
+    for (i = 0; i < NUMEFFECTS; i++)
+        effectIndex.Add(EffectDefs[i].name, i);
+    attribIndex.Clear();
+    for (i = 0; i < NUMATTRIBMODS; i++)
+        attribIndex.Add(AttribDefs[i].key, i);
+    skillIndex.Clear();
+    for (i = 0; i < NSKILLS; i++)
+        skillIndex.Add(SkillDefs[i].abbr, i);
+    skillsIndexed = 1;
+
+    AT_TACTICS = LookupAttrib("tactics");
+    AT_COMBAT = LookupAttrib("combat");
+    AT_STEALTH = LookupAttrib("stealth");
+    AT_OBSERVATION = LookupAttrib("observation");
+    AT_WIND = LookupAttrib("wind");
+    AT_ENTERTAINMENT = LookupAttrib("entertainment");
+    AT_TOUGHNESS = LookupAttrib("toughness");
+
+    // Battles work with effect numbers rather than names
+    if (NUMEFFECTS > MAX_EFFECTS) {
+        Awrite("There are too many effects in EffectDefs!");
+        exit(1);
+    }
+    for (i = 0; i < NUMEFFECTS; i++)
+        EffectDefs[i].cancelnum = LookupEffect(EffectDefs[i].cancelEffect);
+    for (i = 0; i < NUMSPECIALS; i++) {
+        SpecialType *sp = &SpecialDefs[i];
+        int j;
+        for (j = 0; j < 3; j++)
+            sp->effectnums[j] = LookupEffect(sp->effects[j]);
+        for (j = 0; j < 4; j++)
+            sp->damage[j].effectnum = LookupEffect(sp->damage[j].effect);
+    }
+}
+
+static inline int Lookup(LookupTable &table, char const *key)
+{
+    if (!skillsIndexed) IndexSkillDefs();
+    return table.Find(key);
+}
 
 RangeType *FindRange(char const *range)
 {
-    if (range == NULL) return NULL;
-    for (int i = 0; i < NUMRANGES; i++) {
-        if (RangeDefs[i].key == NULL) continue;
-        if (AString(range) == RangeDefs[i].key)
-            return &RangeDefs[i];
-    }
-    return NULL;
+    int i = Lookup(rangeIndex, range);
+    if (i == -1) return NULL;
+    return &RangeDefs[i];
 }
 
 SpecialType *FindSpecial(char const *key)
 {
-    if (key == NULL) return NULL;
-    for (int i = 0; i < NUMSPECIALS; i++) {
-        if (SpecialDefs[i].key == NULL) continue;
-        if (AString(key) == SpecialDefs[i].key)
-            return &SpecialDefs[i];
-    }
-    return NULL;
+    int i = Lookup(specialIndex, key);
+    if (i == -1) return NULL;
+    return &SpecialDefs[i];
 }
 
 EffectType *FindEffect(char const *effect)
 {
-    if (effect == NULL) return NULL;
-    for (int i = 0; i < NUMEFFECTS; i++) {
-        if (EffectDefs[i].name == NULL) continue;
-        if (AString(effect) == EffectDefs[i].name)
-            return &EffectDefs[i];
-    }
-    return NULL;
+    int i = Lookup(effectIndex, effect);
+    if (i == -1) return NULL;
+    return &EffectDefs[i];
+}
+
+int LookupEffect(char const *effect)
+{
+    if (!effect) return -1;
+    return Lookup(effectIndex, effect);
+}
+
+int LookupAttrib(char const *attrib)
+{
+    return Lookup(attribIndex, attrib);
 }
 
 AttribModType *FindAttrib(char const *attrib)
 {
-    if (attrib == NULL) return NULL;
-    for (int i = 0; i < NUMATTRIBMODS; i++) {
-        if (AttribDefs[i].key == NULL) continue;
-        if (AString(attrib) == AttribDefs[i].key)
-            return &AttribDefs[i];
-    }
-    return NULL;
+    int i = Lookup(attribIndex, attrib);
+    if (i == -1) return NULL;
+    return &AttribDefs[i];
 }
 
 SkillType *FindSkill(char const *skname)
 {
-    if (skname == NULL) return NULL;
-    for (int i = 0; i < NSKILLS; i++) {
-        if (SkillDefs[i].abbr == NULL) continue;
-        if (AString(skname) == SkillDefs[i].abbr)
-            return &SkillDefs[i];
-    }
-    return NULL;
+    int i = Lookup(skillIndex, skname);
+    if (i == -1) return NULL;
+    return &SkillDefs[i];
+}
+
+int LookupSkill(char const *skname)
+{
+    return Lookup(skillIndex, skname);
 }
 
 int LookupSkill(AString *token)
 {
-    for (int i=0; i<NSKILLS; i++) {
-        if (*token == SkillDefs[i].abbr) return i;
-    }
-    return -1;
+    return Lookup(skillIndex, token->Str());
 }
 
 int ParseSkill(AString *token)
@@ -229,25 +293,21 @@ ShowSkill::ShowSkill(int s, int l)
 
 void Skill::Readin(Ainfile *f)
 {
-    AString *temp, *token;
-
-    temp = f->GetStr();
-    token = temp->gettoken();
-    type = LookupSkill(token);
-    delete token;
+    char *line = f->GetView();
+    char *token;
 
-    token = temp->gettoken();
-    days = token->value();
-    delete token;
-    
+    type = -1;
+    days = 0;
     exp = 0;
+    if (!line) return;
+
+    type = LookupSkill(nexttoken(&line));
+    token = nexttoken(&line);
+    if (token) days = tokenvalue(token);
     if (Globals->REQUIRED_EXPERIENCE) {
-        token = temp->gettoken();
-        exp = token->value();
-        delete token;
+        token = nexttoken(&line);
+        if (token) exp = tokenvalue(token);
     }
-    
-    delete temp;
 }
 
 void Skill::Writeout(Aoutfile *f)
@@ -270,98 +330,156 @@ void Skill::Writeout(Aoutfile *f)
     f->PutStr(temp);
 }
 
-Skill *Skill::Split(int total, int leave)
+Skill Skill::Split(int total, int leave)
 {
-    Skill *temp = new Skill;
-    temp->type = type;
-    temp->days = (days * leave) / total;
-    days = days - temp->days;
-    temp->exp = (exp * leave) / total;
-    exp = exp - temp->exp;
+    Skill temp;
+    temp.type = type;
+    temp.days = (days * leave) / total;
+    days = days - temp.days;
+    temp.exp = (exp * leave) / total;
+    exp = exp - temp.exp;
     return temp;
 }
 
-int SkillList::GetDays(int skill)
+SkillList::SkillList()
 {
-    forlist(this) {
-        Skill *s = (Skill *) elem;
-        if (s->type == skill) {
-            return s->days;
+    version = 0;
+    num = 0;
+    size = 0;
+    skills = 0;
+}
+
+SkillList::~SkillList()
+{
+    delete [] (char *) skills;
+}
+
+// Moves the skills and their sorted positions to room for newsize skills
+void SkillList::Resize(int newsize)
+{
+    char *mem = 0;
+    if (newsize) {
+        mem = new char[newsize * (sizeof(Skill) + sizeof(short))];
+        Skill *temp = (Skill *) mem;
+        short *sorted = (short *) (temp + newsize);
+        for (int i = 0; i < num; i++) {
+            temp[i] = skills[i];
+            sorted[i] = Sorted()[i];
         }
     }
+    delete [] (char *) skills;
+    skills = (Skill *) mem;
+    size = newsize;
+}
+
+/// Where the first skill of this type or later is in Sorted()
+int SkillList::Lower(int type)
+{
+    short *sorted = Sorted();
+    int lo = 0;
+    int hi = num;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (skills[sorted[mid]].type < type) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+Skill *SkillList::Find(int type)
+{
+    int pos = Lower(type);
+    if (pos < num && skills[Sorted()[pos]].type == type)
+        return &skills[Sorted()[pos]];
     return 0;
 }
 
+// Adds a skill the list doesn't have to the end
+void SkillList::Add(int type, unsigned int days, unsigned int exp)
+{
+    if (num == size) Resize(size ? size * 2 : 1);
+    short *sorted = Sorted();
+    int spos = Lower(type);
+    skills[num].type = type;
+    skills[num].days = days;
+    skills[num].exp = exp;
+    for (int i = num; i > spos; i--) sorted[i] = sorted[i - 1];
+    sorted[spos] = num;
+    num++;
+}
+
+// Takes out the skill at pos, keeping the rest in order
+void SkillList::Remove(int pos)
+{
+    short *sorted = Sorted();
+    int spos = Lower(skills[pos].type);
+    num--;
+    for (int i = pos; i < num; i++) skills[i] = skills[i + 1];
+    for (int i = spos; i < num; i++) sorted[i] = sorted[i + 1];
+    for (int i = 0; i < num; i++) {
+        if (sorted[i] > pos) sorted[i]--;
+    }
+    if (!num) Resize(0);
+}
+
+int SkillList::GetDays(int skill)
+{
+    Skill *s = Find(skill);
+    return s ? s->days : 0;
+}
+
 void SkillList::SetDays(int skill, int days)
 {
-    forlist(this) {
-        Skill *s = (Skill *) elem;
-        if (s->type == skill) {
-            if ((days == 0) && (s->exp <= 0)) {
-                Remove(s);
-                delete s;
-                return;
-            } else {
-                s->days = days;
-                return;
-            }
+    version++;
+    Skill *s = Find(skill);
+    if (s) {
+        if ((days == 0) && (s->exp <= 0)) {
+            Remove(s - skills);
+        } else {
+            s->days = days;
         }
+        return;
     }
     if (days == 0) return;
-    Skill *s = new Skill;
-    s->type = skill;
-    s->days = days;
-    s->exp = 0;
-    Add(s);
+    Add(skill, days, 0);
 }
 
 int SkillList::GetExp(int skill)
 {
-    forlist(this) {
-        Skill *s = (Skill *) elem;
-        if (s->type == skill) {
-            return s->exp;
-        }
-    }
-    return 0;
+    Skill *s = Find(skill);
+    return s ? s->exp : 0;
 }
 
 void SkillList::SetExp(int skill, int exp)
 {
-    forlist(this) {
-        Skill *s = (Skill *) elem;
-        if (s->type == skill) {
-            s->exp = exp;
-            return;
-        }
+    Skill *s = Find(skill);
+    if (s) {
+        s->exp = exp;
+        return;
     }
     if (exp == 0) return;
-    Skill *s = new Skill;
-    s->type = skill;
-    s->days = 0;
-    s->exp = exp;
-    Add(s);
+    Add(skill, 0, exp);
 }
 
 SkillList *SkillList::Split(int total, int leave)
 {
     SkillList *ret = new SkillList;
-    forlist (this) {
-        Skill *s = (Skill *) elem;
-        Skill *n = s->Split(total, leave);
-        if ((s->days == 0) && (s->exp == 0)) {
-            Remove(s);
-            delete s;
-        }
-        ret->Add(n);
+    version++;
+    int pos = 0;
+    while (pos < num) {
+        Skill n = skills[pos].Split(total, leave);
+        ret->Add(n.type, n.days, n.exp);
+        if ((skills[pos].days == 0) && (skills[pos].exp == 0))
+            Remove(pos);
+        else
+            pos++;
     }
     return ret;
 }
 
 void SkillList::Combine(SkillList *b)
 {
-    forlist(b) {
-        Skill *s = (Skill *) elem;
+    forlist_skills(b, s) {
         SetDays(s->type, GetDays(s->type) + s->days);
         SetExp(s->type, GetExp(s->type) + s->exp);
     }
@@ -375,13 +493,11 @@ int SkillList::GetStudyRate(int skill, int nummen)
     int days = 0;
     int exp = 0;
     if (nummen < 1) return 0;
-    forlist(this) {
-        Skill *s = (Skill *) elem;
-        if (s->type == skill) {
-            days = s->days / nummen;
-            if (Globals->REQUIRED_EXPERIENCE)
-                exp = s->exp / nummen;
-        }
+    Skill *s = Find(skill);
+    if (s) {
+        days = s->days / nummen;
+        if (Globals->REQUIRED_EXPERIENCE)
+            exp = s->exp / nummen;
     }
     
     int rate = StudyRateAdjustment(days, exp);
@@ -402,14 +518,14 @@ int SkillList::GetStudyRate(int skill, int nummen)
 AString SkillList::Report(int nummen)
 {
     AString temp;
-    if (!Num()) {
+    if (!num) {
         temp += "none";
         return temp;
     }
     int i = 0;
     int displayed = 0;
-    forlist (this) {
-        Skill *s = (Skill *) elem;
+    for (int pos = 0; pos < num; pos++) {
+        Skill *s = &skills[pos];
         if (s->days == 0) continue;
         displayed++;
         if (i) {
@@ -429,19 +545,66 @@ AString SkillList::Report(int nummen)
     return temp;
 }
 
+// Unknown skills are dropped and a skill given twice is added up, as a
+// list only holds one of each
 void SkillList::Readin(Ainfile *f)
 {
+    version++;
     int n = f->GetInt();
     for (int i=0; i<n; i++) {
-        Skill *s = new Skill;
-        s->Readin(f);
-        if ((s->days == 0) && (s->exp==0)) delete s;
-        else Add(s);
+        Skill temp;
+        temp.Readin(f);
+        if (temp.type < 0 || ((temp.days == 0) && (temp.exp == 0)))
+            continue;
+        Skill *s = Find(temp.type);
+        if (s) {
+            s->days += temp.days;
+            s->exp += temp.exp;
+        } else {
+            Add(temp.type, temp.days, temp.exp);
+        }
     }
 }
 
 void SkillList::Writeout(Aoutfile *f)
 {
-    f->PutInt(Num());
-    forlist(this) ((Skill *) elem)->Writeout(f);
+    f->PutInt(num);
+    for (int i = 0; i < num; i++) skills[i].Writeout(f);
+}
+
+SkillListIterator::SkillListIterator(SkillList *l)
+{
+    list = l;
+    cur = -1;
+    curtype = -1;
+    nexttype = -1;
+}
+
+Skill *SkillListIterator::Next()
+{
+    int pos;
+    if (cur == -1) {
+        pos = 0;
+    } else {
+        // Like forlist, stop after what was the last skill
+        if (nexttype == -1) return 0;
+        if (cur < list->num && list->skills[cur].type == curtype) {
+            pos = cur + 1;
+        } else {
+            // The list has changed; look for the skills where they are now
+            Skill *s = list->Find(curtype);
+            if (s) {
+                pos = s - list->skills + 1;
+            } else {
+                s = list->Find(nexttype);
+                if (!s) return 0;
+                pos = s - list->skills;
+            }
+        }
+    }
+    if (pos >= list->num) return 0;
+    cur = pos;
+    curtype = list->skills[pos].type;
+    nexttype = (pos + 1 < list->num) ? list->skills[pos + 1].type : -1;
+    return &list->skills[pos];
 }
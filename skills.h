@@ -103,6 +103,7 @@ extern SkillType *SkillDefs;
 
 SkillType *FindSkill(char const *skname);
 int LookupSkill(AString *);
+int LookupSkill(char const *skname);
 int ParseSkill(AString *);
 AString SkillStrs(int);
 AString SkillStrs(SkillType *);
@@ -131,20 +132,32 @@ class ShowSkill : public AListElem {
         int level;
 };
 
-class Skill : public AListElem {
+class Skill {
     public:
         void Readin(Ainfile *);
         void Writeout(Aoutfile *);
 
-        Skill * Split(int,int); /* total num, num leaving */
+        Skill Split(int,int); /* total num, num leaving */
 
         int type;
         unsigned int days;
         unsigned int exp;
 };
 
-class SkillList : public AList {
+/// The skills of a unit, or the levels of them a faction has seen.
+/**
+Kept the same way as an ItemList: the skills by value in one array, in
+the order they were first learned, then their positions sorted by type,
+so GetDays and SetDays are binary searches.  Walk a list with
+forlist_skills.
+*/
+class SkillList {
     public:
+        SkillList();
+        ~SkillList();
+
+        int Num() { return num; }
+        Skill *First() { return num ? skills : 0; }
         int GetDays(int); /* Skill */
         int GetExp(int); /* Skill */
         void SetDays(int,int); /* Skill, days */
@@ -155,8 +168,50 @@ class SkillList : public AList {
         AString Report(int); /* Number of men */
         void Readin(Ainfile *);
         void Writeout(Aoutfile *);
+
+        int version; ///< Changes whenever the days in a skill do
+
+    private:
+        friend class SkillListIterator;
+
+        int Lower(int type);
+        Skill *Find(int type);
+        short *Sorted() { return (short *) (skills + size); }
+        void Resize(int newsize);
+        void Add(int type, unsigned int days, unsigned int exp);
+        void Remove(int pos);
+
+        short num;
+        short size;             ///< Skills there is room for
+        Skill *skills;          ///< The skills in list order
+
+        // Not copyable; the copies would share skills
+        SkillList(const SkillList &);
+        SkillList & operator=(const SkillList &);
+};
+
+/// Walks a SkillList for forlist_skills.
+/**
+This goes on through changes to the list in the same way as
+ItemListIterator, and like it never writes to the list.
+*/
+class SkillListIterator {
+    public:
+        SkillListIterator(SkillList *);
+
+        Skill * Next();
+
+    private:
+        SkillList *list;
+        int cur;                ///< Where the current skill was, or -1
+        int curtype;            ///< Its type
+        int nexttype;           ///< The type that followed it, or -1
 };
 
+/// Iterate over a SkillList, with s pointing at each Skill in turn
+#define forlist_skills(l, s) \
+    for (SkillListIterator _skilliter(l); Skill * s = _skilliter.Next(); )
+
 class HealType {
     public:
         int num;
@@ -172,6 +227,10 @@ class DamageType {
         int flags;
         int dclass;
         char const *effect;
+
+        // The number of effect in EffectDefs, or -1; filled in by
+        // IndexSkillDefs
+        int effectnum;
 };
 
 class ShieldType {
@@ -229,6 +288,10 @@ class SpecialType {
         char const *spelldesc;
         char const *spelldesc2;
         char const *spelltarget;
+
+        // effects[] as numbers in EffectDefs (-1 for none); filled in by
+        // IndexSkillDefs
+        int effectnums[3];
 };
 extern SpecialType *SpecialDefs;
 extern int NUMSPECIALS;
@@ -247,11 +310,21 @@ class EffectType {
             EFF_NOSET = 0x002,
         };
         int flags;
+
+        // cancelEffect as a number in EffectDefs, or -1; filled in by
+        // IndexSkillDefs
+        int cancelnum;
 };
 extern EffectType *EffectDefs;
 extern int NUMEFFECTS;
 
+// A soldier's effects are kept as bits of a BITFIELD, one per entry in
+// EffectDefs
+#define MAX_EFFECTS ((int) sizeof(BITFIELD) * 8)
+
 extern EffectType *FindEffect(char const *effect);
+// The number of an effect in EffectDefs, or -1
+extern int LookupEffect(char const *effect);
 
 class RangeType {
     public:
@@ -325,5 +398,18 @@ extern AttribModType *AttribDefs;
 extern int NUMATTRIBMODS;
 
 extern AttribModType *FindAttrib(char const *attrib);
+extern int LookupAttrib(char const *attrib);
+
+// The numbers in AttribDefs of the attributes the engine asks units for,
+// or -1 where the ruleset doesn't have one; filled in by IndexSkillDefs
+extern int AT_TACTICS;
+extern int AT_COMBAT;
+extern int AT_STEALTH;
+extern int AT_OBSERVATION;
+extern int AT_WIND;
+extern int AT_ENTERTAINMENT;
+extern int AT_TOUGHNESS;
+
+extern void IndexSkillDefs();
 
 #endif
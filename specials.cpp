@@ -27,75 +27,76 @@
 
 void Soldier::SetupHealing()
 {
+    Unit *unit = info->unit;
+
     if (unit->type == U_MAGE ||
             unit->type == U_APPRENTICE ||
             unit->type == U_GUARDMAGE) {
-        healtype = unit->GetSkill(S_MAGICAL_HEALING);
-        if (healtype > 5) healtype = 5;
-        if (healtype > 0) {
-            healing = HealDefs[healtype].num;
-            healitem = -1;
+        info->healtype = unit->GetSkill(S_MAGICAL_HEALING);
+        if (info->healtype > 5) info->healtype = 5;
+        if (info->healtype > 0) {
+            info->healing = HealDefs[info->healtype].num;
+            info->healitem = -1;
             return;
         }
     }
 
     if (unit->items.GetNum(I_HEALPOTION)) {
-        healtype = 1;
+        info->healtype = 1;
         unit->items.SetNum(I_HEALPOTION, unit->items.GetNum(I_HEALPOTION)-1);
-        healing = 10;
-        healitem = I_HEALPOTION;
+        info->healing = 10;
+        info->healitem = I_HEALPOTION;
     } else {
-        healing = unit->GetSkill(S_HEALING) * Globals->HEALS_PER_MAN;
-        if (healing) {
-            healtype = 1;
+        info->healing = unit->GetSkill(S_HEALING) * Globals->HEALS_PER_MAN;
+        if (info->healing) {
+            info->healtype = 1;
             int herbs = unit->items.GetNum(I_HERBS);
-            if (herbs < healing) healing = herbs;
-            unit->items.SetNum(I_HERBS,herbs - healing);
-            healitem = I_HERBS;
+            if (herbs < info->healing) info->healing = herbs;
+            unit->items.SetNum(I_HERBS,herbs - info->healing);
+            info->healitem = I_HERBS;
         }
     }
 }
 
-int Army::CheckSpecialTarget(char const *special,int tar)
+int Army::CheckSpecialTarget(SpecialType *spd,int tar)
 {
-    SpecialType *spd = FindSpecial(special);
     int i;
     int match = 0;
 
     if (spd->targflags & SpecialType::HIT_BUILDINGIF) {
         match = 0;
-        if (!soldiers[tar]->building) return 0;
+        if (!soldiers[tar].building) return 0;
         for (i = 0; i < SPECIAL_BUILDINGS; i++) {
-            if (soldiers[tar]->building &&
-                    (spd->buildings[i] == soldiers[tar]->building)) match = 1;
+            if (soldiers[tar].building &&
+                    (spd->buildings[i] == soldiers[tar].building)) match = 1;
         }
         if (!match) return 0;
     }
 
     if (spd->targflags & SpecialType::HIT_BUILDINGEXCEPT) {
         match = 0;
-        if (!soldiers[tar]->building) return 0;
+        if (!soldiers[tar].building) return 0;
         for (i = 0; i < SPECIAL_BUILDINGS; i++) {
-            if (soldiers[tar]->building &&
-                    (spd->buildings[i] == soldiers[tar]->building)) match = 1;
+            if (soldiers[tar].building &&
+                    (spd->buildings[i] == soldiers[tar].building)) match = 1;
         }
         if (match) return 0;
     }
 
     if (spd->targflags & SpecialType::HIT_SOLDIERIF) {
         match = 0;
-        if (soldiers[tar]->race == -1) return 0;
+        if (soldiers[tar].race == -1) return 0;
         for (i = 0; i < 7; i++) {
-            if (soldiers[tar]->race == spd->targets[i]) match = 1;
+            if (soldiers[tar].race == spd->targets[i]) match = 1;
         }
         if (!match) return 0;
     }
 
     if (spd->targflags & SpecialType::HIT_SOLDIEREXCEPT) {
         match = 0;
-        if (soldiers[tar]->race == -1) return 0;
+        if (soldiers[tar].race == -1) return 0;
         for (i = 0; i < 7; i++) {
-            if (soldiers[tar]->race == spd->targets[i]) match = 1;
+            if (soldiers[tar].race == spd->targets[i]) match = 1;
         }
         if (match) return 0;
     }
@@ -103,7 +104,7 @@ int Army::CheckSpecialTarget(char const *special,int tar)
     if (spd->targflags & SpecialType::HIT_EFFECTIF) {
         match = 0;
         for (i = 0; i < 3; i++) {
-            if (soldiers[tar]->HasEffect(spd->effects[i])) match = 1;
+            if (soldiers[tar].HasEffect(spd->effectnums[i])) match = 1;
         }
         if (!match) return 0;
     }
@@ -111,25 +112,25 @@ int Army::CheckSpecialTarget(char const *special,int tar)
     if (spd->targflags & SpecialType::HIT_EFFECTEXCEPT) {
         match = 0;
         for (i = 0; i < 3; i++) {
-            if (soldiers[tar]->HasEffect(spd->effects[i])) match = 1;
+            if (soldiers[tar].HasEffect(spd->effectnums[i])) match = 1;
         }
         if (match) return 0;
     }
 
     if (spd->targflags & SpecialType::HIT_MOUNTIF) {
         match = 0;
-        if (soldiers[tar]->riding == -1) return 0;
+        if (soldiers[tar].riding == -1) return 0;
         for (i = 0; i < 7; i++) {
-            if (soldiers[tar]->riding == spd->targets[i]) match = 1;
+            if (soldiers[tar].riding == spd->targets[i]) match = 1;
         }
         if (!match) return 0;
     }
 
     if (spd->targflags & SpecialType::HIT_MOUNTEXCEPT) {
         match = 0;
-        if (soldiers[tar]->riding == -1) return 0;
+        if (soldiers[tar].riding == -1) return 0;
         for (i = 0; i < 7; i++) {
-            if (soldiers[tar]->riding == spd->targets[i]) match = 1;
+            if (soldiers[tar].riding == spd->targets[i]) match = 1;
         }
         if (match) return 0;
     }
@@ -138,14 +139,14 @@ int Army::CheckSpecialTarget(char const *special,int tar)
         // All illusions are of type monster, so lets make sure we get it
         // right.  If we ever have other types of illusions, we can change
         // this.
-        if (!(ItemDefs[soldiers[tar]->race].type & IT_MONSTER))
+        if (!(ItemDefs[soldiers[tar].race].type & IT_MONSTER))
             return 0;
-        if (!(ItemDefs[soldiers[tar]->race].type & IT_ILLUSION))
+        if (!(ItemDefs[soldiers[tar].race].type & IT_ILLUSION))
             return 0;
     }
 
     if (spd->targflags & SpecialType::HIT_NOMONSTER) {
-        if (ItemDefs[soldiers[tar]->race].type & IT_MONSTER)
+        if (ItemDefs[soldiers[tar].race].type & IT_MONSTER)
             return 0;
     }
     return 1;
@@ -157,8 +158,8 @@ void Battle::UpdateShields(Army *a)
         int shtype = -1;
         SpecialType *spd;
 
-        if (a->soldiers[i]->special == NULL) continue;
-        spd = FindSpecial(a->soldiers[i]->special);
+        if (a->soldiers[i].special == NULL) continue;
+        spd = FindSpecial(a->soldiers[i].special);
 
         if (!(spd->effectflags & SpecialType::FX_SHIELD) &&
                 !(spd->effectflags & SpecialType::FX_DEFBONUS)) continue;
@@ -168,7 +169,7 @@ void Battle::UpdateShields(Army *a)
                 if (spd->shield[shtype] == -1) continue;
                 Shield *sh = new Shield;
                 sh->shieldtype = spd->shield[shtype];
-                sh->shieldskill = a->soldiers[i]->slevel;
+                sh->shieldskill = a->soldiers[i].slevel;
                 a->shields.Add(sh);
             }
         }
@@ -178,12 +179,12 @@ void Battle::UpdateShields(Army *a)
                 if (spd->defs[shtype].type == -1) continue;
                 int bonus = spd->defs[shtype].val;
                 if (spd->effectflags & SpecialType::FX_USE_LEV)
-                    bonus *= a->soldiers[i]->slevel;
-                a->soldiers[i]->dskill[spd->defs[shtype].type] += bonus;
+                    bonus *= a->soldiers[i].slevel;
+                a->soldiers[i].dskill[spd->defs[shtype].type] += bonus;
             }
         }
 
-        AddLine(*(a->soldiers[i]->unit->name) + " casts " +
+        AddLine(*(a->soldiers[i].info->unit->name) + " casts " +
                 spd->shielddesc + ".");
     }
 }
@@ -211,7 +212,7 @@ void Battle::DoSpecialAttack(int round, Soldier *a, Army *attackers,
         num = def->DoAnAttack(a->special, realtimes,
                 spd->damage[i].type, a->slevel,
                 spd->damage[i].flags, spd->damage[i].dclass,
-                spd->damage[i].effect, 0, a);
+                spd->damage[i].effectnum, 0, a);
         if (spd->effectflags & SpecialType::FX_DONT_COMBINE && num != -1) {
             if (spd->damage[i].effect == NULL) {
                 results[dam] = AString("killing ") + num;
@@ -226,10 +227,10 @@ void Battle::DoSpecialAttack(int round, Soldier *a, Army *attackers,
         }
     }
     if (tot == -1) {
-        AddLine(a->name + " " + spd->spelldesc + ", but it is deflected.");
+        AddLine(a->Name() + " " + spd->spelldesc + ", but it is deflected.");
     } else {
         if (spd->effectflags & SpecialType::FX_DONT_COMBINE) {
-            AString temp = a->name + " " + spd->spelldesc;
+            AString temp = a->Name() + " " + spd->spelldesc;
             for (i = 0; i < dam; i++) {
                 if (i) temp += ", ";
                 if (i == dam-1) temp += " and ";
@@ -238,7 +239,7 @@ void Battle::DoSpecialAttack(int round, Soldier *a, Army *attackers,
             temp += AString(spd->spelltarget) + ".";
             AddLine(temp);
         } else {
-            AddLine(a->name + " " + spd->spelldesc + ", " + spd->spelldesc2 +
+            AddLine(a->Name() + " " + spd->spelldesc + ", " + spd->spelldesc2 +
                     tot + spd->spelltarget + ".");
         }
     }
@@ -1597,7 +1597,7 @@ int Game::RunFarsight(ARegion *r,Unit *u)
     f->faction = u->faction;
     f->level = u->GetSkill(S_FARSIGHT);
     f->unit = u;
-    f->observation = u->GetAttribute("observation");
+    f->observation = u->GetAttribute(AT_OBSERVATION);
     tar->farsees.Add(f);
     AString temp = "Casts Farsight on ";
     temp += tar->ShortPrint(&regions);
@@ -1946,7 +1946,6 @@ int Game::RunBlasphemousRitual(ARegion *r, Unit *mage)
     int level, num, sactype, sacrifices, i, sac, max, dir;
     Object *o, *tower;
     Unit *u, *victim;
-    Item *item;
     ARegion *start;
     AString message;
 
@@ -1974,8 +1973,7 @@ int Game::RunBlasphemousRitual(ARegion *r, Unit *mage)
         forlist(&o->units) {
             u = (Unit *) elem;
             if (u->faction->num == mage->faction->num) {
-                forlist(&u->items) {
-                    item = (Item *) elem;
+                forlist_items(&u->items, item) {
                     if (ItemDefs[item->type].type & sactype)
                         sacrifices += item->num;
                 }
@@ -2015,8 +2013,7 @@ int Game::RunBlasphemousRitual(ARegion *r, Unit *mage)
             forlist(&o->units) {
                 u = (Unit *) elem;
                 if (u->faction->num == mage->faction->num) {
-                    forlist(&u->items) {
-                        item = (Item *) elem;
+                    forlist_items(&u->items, item) {
                         if (ItemDefs[item->type].type & sactype) {
                             if (!victim && i < item->num) {
                                 victim = u;
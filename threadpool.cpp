@@ -0,0 +1,115 @@
+// START A3HEADER
+//
+// This source file is part of the Atlantis PBM game program.
+// Copyright (C) 1995-1999 Geoff Dunbar
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program, in the file license.txt. If not, write
+// to the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+//
+// See the Atlantis Project web page for details:
+// http://www.prankster.com/project
+//
+// END A3HEADER
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(int threads)
+{
+    if (threads < 1) threads = 1;
+    numthreads = threads;
+    curjob = 0;
+    curarg = 0;
+    count = 0;
+    next = 0;
+    running = 0;
+    generation = 0;
+    stopping = 0;
+    // The calling thread does its share, so it needs one thread fewer
+    workers = new std::thread[numthreads - 1];
+    for (int i = 0; i < numthreads - 1; i++)
+        workers[i] = std::thread(&ThreadPool::Work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = 1;
+    }
+    wake.notify_all();
+    for (int i = 0; i < numthreads - 1; i++)
+        workers[i].join();
+    delete [] workers;
+}
+
+void ThreadPool::Run(int jobs, void (*job)(int, void *), void *arg)
+{
+    if (jobs < 1) return;
+    if (numthreads == 1) {
+        for (int i = 0; i < jobs; i++)
+            job(i, arg);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        curjob = job;
+        curarg = arg;
+        count = jobs;
+        next = 0;
+        running = numthreads - 1;
+        generation++;
+    }
+    wake.notify_all();
+
+    RunJobs();
+
+    std::unique_lock<std::mutex> guard(lock);
+    while (running) done.wait(guard);
+    curjob = 0;
+    curarg = 0;
+}
+
+// Take job numbers until there are none left
+void ThreadPool::RunJobs()
+{
+    for (;;) {
+        int n;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (next >= count) return;
+            n = next++;
+        }
+        curjob(n, curarg);
+    }
+}
+
+void ThreadPool::Work()
+{
+    int seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            while (!stopping && generation == seen) wake.wait(guard);
+            if (stopping) return;
+            seen = generation;
+        }
+        RunJobs();
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            running--;
+        }
+        done.notify_one();
+    }
+}
@@ -0,0 +1,67 @@
+// START A3HEADER
+//
+// This source file is part of the Atlantis PBM game program.
+// Copyright (C) 1995-1999 Geoff Dunbar
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program, in the file license.txt. If not, write
+// to the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+//
+// See the Atlantis Project web page for details:
+// http://www.prankster.com/project
+//
+// END A3HEADER
+#ifndef THREADPOOL_CLASS
+#define THREADPOOL_CLASS
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/// A fixed set of worker threads for running independent jobs
+/**
+Run() hands out the job numbers 0 to jobs-1 to the workers and to the
+calling thread, and returns once every job has finished.  Jobs are
+handed out in order, but may finish in any order, so anything a job
+writes outside its own data has to be merged afterwards by the caller.
+The workers sleep between calls, so a pool can be kept for the whole run.
+*/
+class ThreadPool {
+    public:
+        ThreadPool(int threads);
+        ~ThreadPool();
+
+        void Run(int jobs, void (*job)(int, void *), void *arg);
+        int Threads() { return numthreads; }
+
+    private:
+        void Work();
+        void RunJobs();
+
+        int numthreads;
+        std::thread *workers;
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable done;
+
+        void (*curjob)(int, void *);
+        void *curarg;
+        int count;
+        int next;
+        int running;            ///< Workers still busy with this batch
+        int generation;         ///< Bumped for every batch
+        int stopping;
+};
+
+#endif
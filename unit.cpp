@@ -26,6 +26,9 @@
 #include "unit.h"
 #include "gamedata.h"
 
+// Marks an attribute with no cached value in Unit::attribCache
+#define ATTRIB_UNKNOWN (-0x7fffffff)
+
 UnitId::UnitId()
 {
 }
@@ -97,6 +100,7 @@ Unit::Unit()
     savedmovedir = -1;
     ClearOrders();
     raised = 0;
+    attribCache = 0;
 }
 
 Unit::Unit(int seq, Faction *f, int a)
@@ -140,10 +144,13 @@ Unit::Unit(int seq, Faction *f, int a)
     savedmovedir = -1;
     ClearOrders();
     raised = 0;
+    attribCache = 0;
 }
 
 Unit::~Unit()
 {
+    AllUnits.RemoveUnit(this);
+    delete [] attribCache;
     if (monthorders) delete monthorders;
     if (presentMonthOrders) delete presentMonthOrders;
     if (attackorders) delete attackorders;
@@ -170,6 +177,7 @@ void Unit::MakeWMon(char const *monname, int mon, int num)
 
 void Unit::Writeout(Aoutfile *s)
 {
+    s->StartSection(SECTION_UNIT);
     set<string>::iterator it;
 
     s->PutStr(*name);
@@ -207,10 +215,12 @@ void Unit::Writeout(Aoutfile *s)
             it++) {
         s->PutStr(it->c_str());
     }
+    s->EndSection();
 }
 
 void Unit::Readin(Ainfile *s, AList *facs, ATL_VER v)
 {
+    s->StartSection(SECTION_UNIT);
     name = s->GetStr();
     describe = s->GetStr();
     if (*describe == "none") {
@@ -235,33 +245,24 @@ void Unit::Readin(Ainfile *s, AList *facs, ATL_VER v)
     }
 
     free = s->GetInt();
-    AString *temp;
-    temp = s->GetStr();
-    readyItem = LookupItem(temp);
-    delete temp;
+    readyItem = LookupItem(s->GetView());
     for (i = 0; i < MAX_READY; i++) {
-        temp = s->GetStr();
-        readyWeapon[i] = LookupItem(temp);
-        delete temp;
-        temp = s->GetStr();
-        readyArmor[i] = LookupItem(temp);
-        delete temp;
+        readyWeapon[i] = LookupItem(s->GetView());
+        readyArmor[i] = LookupItem(s->GetView());
     }
     flags = s->GetInt();
 
     items.Readin(s);
     skills.Readin(s);
-    temp = s->GetStr();
-    combat = LookupSkill(temp);
-    delete temp;
+    combat = LookupSkill(s->GetView());
     savedmovement = s->GetInt();
     savedmovedir = s->GetInt();
     i = s->GetInt();
     while (i-- > 0) {
-        temp = s->GetStr();
-        visited.insert(temp->Str());
-        delete temp;
+        char *place = s->GetView();
+        if (place) visited.insert(place);
     }
+    s->EndSection();
 }
 
 AString Unit::MageReport()
@@ -351,7 +352,7 @@ AString Unit::StudyableSkills()
 AString Unit::GetName(int obs)
 {
     AString ret = *name;
-    int stealth = GetAttribute("stealth");
+    int stealth = GetAttribute(AT_STEALTH);
     if (reveal == REVEAL_FACTION || obs > stealth) {
         ret += ", ";
         ret += *faction->name;
@@ -429,7 +430,7 @@ AString Unit::SpoilsReport() {
 void Unit::WriteReport(Areport *f, int obs, int truesight, int detfac,
                 int autosee, int attitude, int showattitudes)
 {
-    int stealth = GetAttribute("stealth");
+    int stealth = GetAttribute(AT_STEALTH);
     if (obs==-1) {
         /* The unit belongs to the Faction writing the report */
         obs = 2;
@@ -652,8 +653,7 @@ AString *Unit::BattleReport(int obs)
 
     *temp += items.BattleReport();
 
-    forlist (&skills) {
-        Skill *s = (Skill *)elem;
+    forlist_skills(&skills, s) {
         if (SkillDefs[s->type].flags & SkillType::BATTLEREP) {
             int lvl = GetAvailSkill(s->type);
             if (lvl) {
@@ -798,12 +798,9 @@ void Unit::DefaultOrders(Object *obj)
 void Unit::PostTurn(ARegion *r)
 {
     if (type == U_WMON) {
-        forlist(&items) {
-            Item *i = (Item *) elem;
-            if (!(ItemDefs[i->type].type & IT_MONSTER)) {
-                items.Remove(i);
-                delete i;
-            }
+        forlist_items(&items, i) {
+            if (!(ItemDefs[i->type].type & IT_MONSTER))
+                items.SetNum(i->type, 0);
         }
         if (free > 0) --free;
     }
@@ -840,8 +837,7 @@ int Unit::IsAlive()
     if (type == U_MAGE || type == U_APPRENTICE) {
         return(GetMen());
     } else {
-        forlist(&items) {
-            Item *i = (Item *) elem;
+        forlist_items(&items, i) {
             if (IsSoldier(i->type) && i->num > 0)
                 return 1;
         }
@@ -872,8 +868,7 @@ int Unit::GetMen(int t)
 int Unit::GetMons()
 {
     int n=0;
-    forlist(&items) {
-        Item *i = (Item *) elem;
+    forlist_items(&items, i) {
         if (ItemDefs[i->type].type & IT_MONSTER) {
             n += i->num;
         }
@@ -884,8 +879,7 @@ int Unit::GetMons()
 int Unit::GetMen()
 {
     int n = 0;
-    forlist(&items) {
-        Item *i = (Item *) elem;
+    forlist_items(&items, i) {
         if (ItemDefs[i->type].type & IT_MAN) {
             n += i->num;
         }
@@ -896,8 +890,7 @@ int Unit::GetMen()
 int Unit::GetLeaders()
 {
     int n = 0;
-    forlist (&items) {
-        Item *i = (Item *)elem;
+    forlist_items(&items, i) {
         if (ItemDefs[i->type].type & IT_LEADER) {
             n += i->num;
         }
@@ -908,8 +901,7 @@ int Unit::GetLeaders()
 int Unit::GetSoldiers()
 {
     int n = 0;
-    forlist(&items) {
-        Item *i = (Item *) elem;
+    forlist_items(&items, i) {
         if (IsSoldier(i->type)) n+=i->num;
     }
 
@@ -995,8 +987,7 @@ int Unit::GetAttackRiding()
 {
     int riding = 0;
     if (type == U_WMON) {
-        forlist(&items) {
-            Item *i = (Item *) elem;
+        forlist_items(&items, i) {
             if (ItemDefs[i->type].type & IT_MONSTER) {
                 if (ItemDefs[i->type].fly) {
                     return 5;
@@ -1009,14 +1000,12 @@ int Unit::GetAttackRiding()
         riding = GetSkill(S_RIDING);
         int lowriding = 0;
         int minweight = 10000;
-        forlist(&items) {
-            Item *i = (Item *)elem;
+        forlist_items(&items, i) {
             if (ItemDefs[i->type].type & IT_MAN)
                 if (ItemDefs[i->type].weight < minweight)
                     minweight = ItemDefs[i->type].weight;
         }
-        forlist_reuse (&items) {
-            Item *i = (Item *)elem;
+        forlist_items(&items, i) {
             if (ItemDefs[i->type].fly - ItemDefs[i->type].weight >= minweight)
                 return riding;
             if (ItemDefs[i->type].ride-ItemDefs[i->type].weight >= minweight) {
@@ -1048,10 +1037,10 @@ int Unit::GetDefenseRiding()
 
 int Unit::GetSkill(int sk)
 {
-    if (sk == S_TACTICS) return GetAttribute("tactics");
-    if (sk == S_STEALTH) return GetAttribute("stealth");
-    if (sk == S_OBSERVATION) return GetAttribute("observation");
-    if (sk == S_ENTERTAINMENT) return GetAttribute("entertainment");
+    if (sk == S_TACTICS) return GetAttribute(AT_TACTICS);
+    if (sk == S_STEALTH) return GetAttribute(AT_STEALTH);
+    if (sk == S_OBSERVATION) return GetAttribute(AT_OBSERVATION);
+    if (sk == S_ENTERTAINMENT) return GetAttribute(AT_ENTERTAINMENT);
     int retval = GetAvailSkill(sk);
     return retval;
 }
@@ -1064,11 +1053,9 @@ void Unit::SetSkill(int sk, int level)
 
 int Unit::GetAvailSkill(int sk)
 {
-    AString str;
     int retval = GetRealSkill(sk);
 
-    forlist (&items) {
-        Item *i = (Item *)elem;
+    forlist_items(&items, i) {
         if (ItemDefs[i->type].flags & ItemType::DISABLED) continue;
         if (ItemDefs[i->type].type & IT_MAGEONLY
                 && type != U_MAGE
@@ -1082,17 +1069,15 @@ int Unit::GetAvailSkill(int sk)
             continue;
         if (i->num < GetMen())
             continue;
-        str = ItemDefs[i->type].grantSkill;
-        if (ItemDefs[i->type].grantSkill && LookupSkill(&str) == sk) {
+        if (ItemDefs[i->type].grantSkill &&
+                LookupSkill(ItemDefs[i->type].grantSkill) == sk) {
             int grant = 0;
             for (unsigned j = 0; j < sizeof(ItemDefs[0].fromSkills)
                                  / sizeof(ItemDefs[0].fromSkills[0]); j++) {
                 if (ItemDefs[i->type].fromSkills[j]) {
                     int fromSkill;
 
-                    str = ItemDefs[i->type].fromSkills[j];
-
-                    fromSkill = LookupSkill(&str);
+                    fromSkill = LookupSkill(ItemDefs[i->type].fromSkills[j]);
                     if (fromSkill != -1) {
                         /*
                             Should this use GetRealSkill or GetAvailSkill?
@@ -1130,8 +1115,7 @@ void Unit::ForgetSkill(int sk)
 {
     skills.SetDays(sk, 0);
     if (type == U_MAGE) {
-        forlist(&skills) {
-            Skill *s = (Skill *) elem;
+        forlist_skills(&skills, s) {
             if (SkillDefs[s->type].flags & SkillType::MAGIC) {
                 return;
             }
@@ -1139,8 +1123,7 @@ void Unit::ForgetSkill(int sk)
         type = U_NORMAL;
     }
     if (type == U_APPRENTICE) {
-        forlist(&skills) {
-            Skill *s = (Skill *) elem;
+        forlist_skills(&skills, s) {
             if (SkillDefs[s->type].flags & SkillType::APPRENTICE) {
                 return;
             }
@@ -1189,19 +1172,16 @@ int Unit::CanStudy(int sk)
 
 int Unit::Study(int sk, int days)
 {
-    Skill *s;
-
     if (Globals->SKILL_LIMIT_NONLEADERS && !IsLeader()) {
         if (SkillDefs[sk].flags & SkillType::MAGIC) {
-            forlist(&skills) {
-                s = (Skill *) elem;
+            forlist_skills(&skills, s) {
                 if (!(SkillDefs[s->type].flags & SkillType::MAGIC)) {
                     Error("STUDY: Non-leader mages cannot possess non-magical skills.");
                     return 0;
                 }
             }
         } else if (skills.Num()) {
-            s = (Skill *) skills.First();
+            Skill *s = skills.First();
             if ((s->type != sk) && (s->days > 0)) {
                 Error("STUDY: Can know only 1 skill.");
                 return 0;
@@ -1226,13 +1206,7 @@ int Unit::Study(int sk, int days)
     AdjustSkills();
 
     /* Check to see if we need to show a skill report */
-    int lvl = GetRealSkill(sk);
-    int shown = faction->skills.GetDays(sk);
-    while (lvl > shown) {
-        shown++;
-        faction->skills.SetDays(sk, shown);
-        faction->shows.Add(new ShowSkill(sk, shown));
-    }
+    faction->DiscoverSkill(sk, GetRealSkill(sk));
     return 1;
 }
 
@@ -1242,8 +1216,7 @@ int Unit::GetSkillMax(int sk)
 
     if (SkillDefs[sk].flags & SkillType::DISABLED) return 0;
 
-    forlist (&items) {
-        Item *i = (Item *)elem;
+    forlist_items(&items, i) {
         if (ItemDefs[i->type].flags & ItemType::DISABLED) continue;
         if (!(ItemDefs[i->type].type & IT_MAN)) continue;
         int m = SkillMax(SkillDefs[sk].abbr, i->type);
@@ -1270,8 +1243,7 @@ int Unit::Practice(int sk)
 
         reqlev = 0;
 
-        forlist (&items) {
-            Item *it = (Item *)elem;
+        forlist_items(&items, it) {
             if (ItemDefs[it->type].flags & ItemType::DISABLED) continue;
             if (ItemDefs[it->type].type & IT_MAGEONLY
                     && type != U_MAGE
@@ -1338,12 +1310,10 @@ int Unit::Practice(int sk)
         if (!Globals->REQUIRED_EXPERIENCE) {
             Study(sk, men * bonus);
         } else {
-            Skill *s;
             // check if it's a nonleader and this is not it's
             // only skill
             if (Globals->SKILL_LIMIT_NONLEADERS && !IsLeader()) {
-                forlist(&skills) {
-                    s = (Skill *) elem;
+                forlist_skills(&skills, s) {
                     if ((s->days > 0) && (s->type != sk)) {
                         return 0;
                     }
@@ -1377,6 +1347,9 @@ int Unit::IsNormal()
 
 void Unit::AdjustSkills()
 {
+    // The skills below are changed directly, not through SetDays
+    skills.version++;
+
     if (!IsLeader() && Globals->SKILL_LIMIT_NONLEADERS) {
         //
         // Not a leader: can only know 1 skill
@@ -1386,33 +1359,30 @@ void Unit::AdjustSkills()
             // Find highest skill, eliminate others
             //
             unsigned int max = 0;
-            Skill *maxskill = 0;
-            forlist(&skills) {
-                Skill *s = (Skill *) elem;
-                if (s->days > max) {
+            int maxskill = -1;
+            forlist_skills(&skills, s) {
+                if (maxskill == -1 || s->days > max) {
                     max = s->days;
-                    maxskill = s;
+                    maxskill = s->type;
                 }
             }
-            forlist_reuse(&skills) {
-                Skill *s = (Skill *) elem;
-                if (s != maxskill) {
+            forlist_skills(&skills, s) {
+                if (s->type != maxskill) {
                     // Allow multiple skills if they're all
                     // magical ones
-                    if ((SkillDefs[maxskill->type].flags & SkillType::MAGIC) &&
+                    if ((SkillDefs[maxskill].flags & SkillType::MAGIC) &&
                             (SkillDefs[s->type].flags & SkillType::MAGIC) )
                         continue;
                     if ((Globals->REQUIRED_EXPERIENCE) && (s->exp > 0)) continue;
-                    skills.Remove(s);
-                    delete s;
+                    // With no experience left this takes the skill out
+                    skills.SetDays(s->type, 0);
                 }
             }
         }
     }
 
     // Everyone: limit all skills to their maximum level
-    forlist(&skills) {
-        Skill *theskill = (Skill *) elem;
+    forlist_skills(&skills, theskill) {
         int max = GetSkillMax(theskill->type);
         if (GetRealSkill(theskill->type) >= max) {
             theskill->days = GetDaysByLevel(max) * GetMen();
@@ -1552,8 +1522,7 @@ int Unit::Weight()
 int Unit::FlyingCapacity()
 {
     int cap = 0;
-    forlist(&items) {
-        Item *i = (Item *) elem;
+    forlist_items(&items, i) {
         // except ship items
         if (ItemDefs[i->type].type & IT_SHIP) continue;
         cap += ItemDefs[i->type].fly * i->num;
@@ -1565,8 +1534,7 @@ int Unit::FlyingCapacity()
 int Unit::RidingCapacity()
 {
     int cap = 0;
-    forlist(&items) {
-        Item *i = (Item *) elem;
+    forlist_items(&items, i) {
         cap += ItemDefs[i->type].ride * i->num;
     }
 
@@ -1576,8 +1544,7 @@ int Unit::RidingCapacity()
 int Unit::SwimmingCapacity()
 {
     int cap = 0;
-    forlist(&items) {
-        Item *i = (Item *) elem;
+    forlist_items(&items, i) {
         // except ship items
         if (ItemDefs[i->type].type & IT_SHIP) continue;
         cap += ItemDefs[i->type].swim * i->num;
@@ -1589,8 +1556,7 @@ int Unit::SwimmingCapacity()
 int Unit::WalkingCapacity()
 {
     int cap = 0;
-    forlist(&items) {
-        Item *i = (Item *) elem;
+    forlist_items(&items, i) {
         cap += ItemDefs[i->type].walk * i->num;
         if (ItemDefs[i->type].hitchItem != -1) {
             int hitch = ItemDefs[i->type].hitchItem;
@@ -1703,15 +1669,13 @@ static int ContributesToMovement(int movetype, int item)
 int Unit::CalcMovePoints(ARegion *r)
 {
     int movetype, speed, weight, cap, hitches;
-    Item *i;
 
     movetype = MoveType(r);
     speed = 0;
     if (movetype == M_NONE)
         return 0;
 
-    forlist(&items) {
-        i = (Item *) elem;
+    forlist_items(&items, i) {
         if (ContributesToMovement(movetype, i->type)) {
             if (ItemDefs[i->type].speed > speed)
                 speed = ItemDefs[i->type].speed;
@@ -1719,8 +1683,7 @@ int Unit::CalcMovePoints(ARegion *r)
     }
     weight = items.Weight();
     while (weight > 0 && speed > 0) {
-        forlist(&items) {
-            i = (Item *) elem;
+        forlist_items(&items, i) {
             cap = ContributesToMovement(movetype, i->type);
             if (ItemDefs[i->type].speed == speed) {
                 if (cap > 0)
@@ -1745,7 +1708,7 @@ int Unit::CalcMovePoints(ARegion *r)
         return 0; // not that this should be possible!
 
     if (movetype == M_FLY) {
-        if (GetAttribute("wind") > 0)
+        if (GetAttribute(AT_WIND) > 0)
             speed += Globals->FLEET_WIND_BOOST;
     }
 
@@ -1829,8 +1792,7 @@ int Unit::Hostile()
 {
     if (type != U_WMON) return 0;
     int retval = 0;
-    forlist(&items) {
-        Item *i = (Item *) elem;
+    forlist_items(&items, i) {
         if (ItemDefs[i->type].type & IT_MONSTER) {
             MonType *mp = FindMonster(ItemDefs[i->type].abr,
                     (ItemDefs[i->type].type & IT_ILLUSION));
@@ -1878,8 +1840,7 @@ int Unit::Taxers(int numtaxers)
     int numUsableBattle = 0;
     int numArmor = 0;
 
-    forlist (&items) {
-        Item *pItem = (Item *) elem;
+    forlist_items(&items, pItem) {
         if (ItemDefs[pItem->type].type & IT_MAN) continue;
         BattleItemType *pBat = NULL;
 
@@ -2087,8 +2048,7 @@ int Unit::Taxers(int numtaxers)
                     taxers = totalMen;
                 }
             } else {
-                forlist(&skills) {
-                    Skill *s = (Skill *)elem;
+                forlist_skills(&skills, s) {
                     if ((Globals->WHO_CAN_TAX & GameDefs::TAX_MAGE_DAMAGE) &&
                             SkillDefs[s->type].flags & SkillType::DAMAGE) {
                         basetax = totalMen;
@@ -2169,9 +2129,8 @@ void Unit::CopyFlags(Unit *x)
     reveal = x->reveal;
 }
 
-int Unit::GetBattleItem(AString &itm)
+int Unit::GetBattleItem(int item)
 {
-    int item = LookupItem(&itm);
     if (item == -1) return -1;
 
     int num = items.GetNum(item);
@@ -2300,10 +2259,14 @@ int Unit::GetWeapon(AString &itm, int riding, int ridingBonus,
 
 void Unit::MoveUnit(Object *toobj)
 {
-    if (object) object->units.Remove(this);
+    if (object) {
+        object->units.Remove(this);
+        if (object->region) object->region->InvalidateSight();
+    }
     object = toobj;
     if (object) {
         object->units.Add(this);
+        if (object->region) object->region->InvalidateSight();
     }
 }
 
@@ -2331,28 +2294,80 @@ void Unit::Error(const AString & s)
     faction->Error(temp);
 }
 
+// Results are kept until the unit's skills, items, flags, guard status or
+// type change.  Build with -DCHECK_ATTRIBUTE_CACHE to have every cached
+// value checked against a fresh calculation.
 int Unit::GetAttribute(char const *attrib)
 {
-    AttribModType *ap = FindAttrib(attrib);
-    if (ap == NULL) return 0;
+    return GetAttribute(LookupAttrib(attrib));
+}
+
+int Unit::GetAttribute(int a)
+{
+    if (a == -1) return 0;
+
+    if (!attribCache || attribItems != items.version ||
+            attribSkills != skills.version || attribFlags != flags ||
+            attribGuard != guard || attribType != type) {
+        if (!attribCache) attribCache = new int[NUMATTRIBMODS];
+        for (int i = 0; i < NUMATTRIBMODS; i++)
+            attribCache[i] = ATTRIB_UNKNOWN;
+        attribItems = items.version;
+        attribSkills = skills.version;
+        attribFlags = flags;
+        attribGuard = guard;
+        attribType = type;
+    }
+
+    if (attribCache[a] == ATTRIB_UNKNOWN) {
+        attribCache[a] = CalcAttribute(a);
+    } else {
+#ifdef CHECK_ATTRIBUTE_CACHE
+        int fresh = CalcAttribute(a);
+        if (fresh != attribCache[a]) {
+            Awrite(AString("Stale ") + AttribDefs[a].key + " for unit " +
+                    num + ": cached " + attribCache[a] + ", actual " +
+                    fresh);
+            attribCache[a] = fresh;
+        }
+#endif
+    }
+    return attribCache[a];
+}
+
+// Fills in every attribute, so that later lookups only read the cache
+void Unit::CacheAttributes()
+{
+    for (int a = 0; a < NUMATTRIBMODS; a++)
+        GetAttribute(a);
+}
+
+int Unit::CalcAttribute(int attrib)
+{
+    AttribModType *ap = &AttribDefs[attrib];
     AString temp;
     int base = 0;
     int bonus = 0;
     int monbase = -1;
     int monbonus = 0;
 
+    // Work out once which monster stat (if any) this attribute uses
+    int monstat = 0;
     if (ap->flags & AttribModType::CHECK_MONSTERS) {
-        forlist (&items) {
-            Item *i = (Item *) elem;
+        if (attrib == AT_OBSERVATION) monstat = 1;
+        else if (attrib == AT_STEALTH) monstat = 2;
+        else if (attrib == AT_TACTICS) monstat = 3;
+    }
+
+    if (monstat) {
+        forlist_items(&items, i) {
             if (ItemDefs[i->type].type & IT_MONSTER) {
                 MonType *mp = FindMonster(ItemDefs[i->type].abr,
                         (ItemDefs[i->type].type & IT_ILLUSION));
                 int val = 0;
-                temp = attrib;
-                if (temp == "observation") val = mp->obs;
-                else if (temp == "stealth") val = mp->stealth;
-                else if (temp == "tactics") val = mp->tactics;
-                else continue;
+                if (monstat == 1) val = mp->obs;
+                else if (monstat == 2) val = mp->stealth;
+                else val = mp->tactics;
                 if (monbase == -1) monbase = val;
                 else if (ap->flags & AttribModType::USE_WORST)
                     monbase = (val < monbase) ? val : monbase;
@@ -2365,8 +2380,7 @@ int Unit::GetAttribute(char const *attrib)
     for (int index = 0; index < 5; index++) {
         int val = 0;
         if (ap->mods[index].flags & AttribModItem::SKILL) {
-            temp = ap->mods[index].ident;
-            int sk = LookupSkill(&temp);
+            int sk = LookupSkill(ap->mods[index].ident);
             val = GetAvailSkill(sk);
             if (ap->mods[index].modtype == AttribModItem::UNIT_LEVEL_HALF) {
                 val = ((val + 1)/2) * ap->mods[index].val;
@@ -2377,8 +2391,7 @@ int Unit::GetAttribute(char const *attrib)
             }
         } else if (ap->mods[index].flags & AttribModItem::ITEM) {
             val = 0;
-            temp = ap->mods[index].ident;
-            int item = LookupItem(&temp);
+            int item = LookupItem(ap->mods[index].ident);
             if (item != -1) {
                 if (ItemDefs[item].type & IT_MAGEONLY
                     && type != U_MAGE
@@ -2433,12 +2446,16 @@ int Unit::GetAttribute(char const *attrib)
 
 int Unit::PracticeAttribute(char const *attrib)
 {
-    AttribModType *ap = FindAttrib(attrib);
-    if (ap == NULL) return 0;
+    return PracticeAttribute(LookupAttrib(attrib));
+}
+
+int Unit::PracticeAttribute(int attrib)
+{
+    if (attrib == -1) return 0;
+    AttribModType *ap = &AttribDefs[attrib];
     for (int index = 0; index < 5; index++) {
         if (ap->mods[index].flags & AttribModItem::SKILL) {
-            AString temp = ap->mods[index].ident;
-            int sk = LookupSkill(&temp);
+            int sk = LookupSkill(ap->mods[index].ident);
             if (sk != -1)
                 if (Practice(sk)) return 1;
         }
@@ -2460,8 +2477,7 @@ int Unit::GetProductionBonus(int item)
 int Unit::SkillLevels()
 {
     int levels = 0;
-    forlist(&skills) {
-        Skill *s = (Skill *)elem;
+    forlist_skills(&skills, s) {
         levels += GetLevelByDays(s->days/GetMen());
     }
     return levels;
@@ -2469,8 +2485,7 @@ int Unit::SkillLevels()
 
 Skill *Unit::GetSkillObject(int sk)
 {
-    forlist(&skills) {
-        Skill *s = (Skill *)elem;
+    forlist_skills(&skills, s) {
         if (s->type == sk)
             return s;
     }
@@ -2518,8 +2533,7 @@ void Unit::SkillStarvation()
         }
     }
     if (!count) {
-        forlist(&items) {
-            Item *i = (Item *)elem;
+        forlist_items(&items, i) {
             if (ItemDefs[i->type].type & IT_MAN) {
                 count += items.GetNum(i->type);
                 items.SetNum(i->type, 0);
@@ -2537,6 +2551,7 @@ void Unit::SkillStarvation()
                 AString temp = AString("Starves and forgets one level of ")+
                     SkillDefs[i].name + ".";
                 Error(temp);
+                skills.version++;
                 switch(GetLevelByDays(s->days)) {
                     case 1:
                         s->days -= 30;
@@ -2600,3 +2615,61 @@ int Unit::CanUseWeapon(WeaponType *pWep)
 
     return baseSkillLevel;
 }
+
+UnitIndex AllUnits;
+
+UnitIndex::UnitIndex()
+{
+    units = 0;
+    size = 0;
+    firstfree = 1;
+}
+
+UnitIndex::~UnitIndex()
+{
+    Clear();
+}
+
+void UnitIndex::Clear()
+{
+    if (units) delete [] units;
+    units = 0;
+    size = 0;
+    firstfree = 1;
+}
+
+void UnitIndex::SetUnit(int num, Unit *u)
+{
+    if (num <= 0) return;
+    if (num >= size) {
+        int newsize = size ? size : 1024;
+        while (newsize <= num) newsize *= 2;
+        Unit **temp = new Unit *[newsize];
+        int i;
+        for (i = 0; i < size; i++) temp[i] = units[i];
+        for (; i < newsize; i++) temp[i] = 0;
+        if (units) delete [] units;
+        units = temp;
+        size = newsize;
+    }
+    units[num] = u;
+    if (!u && num < firstfree) firstfree = num;
+}
+
+Unit *UnitIndex::GetUnit(int num)
+{
+    if (num <= 0 || num >= size) return 0;
+    return units[num];
+}
+
+void UnitIndex::RemoveUnit(Unit *u)
+{
+    if (GetUnit(u->num) == u) SetUnit(u->num, 0);
+}
+
+/// Return the lowest unit number not currently in use
+int UnitIndex::FirstFree()
+{
+    while (firstfree < size && units[firstfree]) firstfree++;
+    return firstfree;
+}
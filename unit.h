@@ -175,8 +175,14 @@ class Unit : public AListElem
         // These are rule-set specific, in extra.cpp.
         //
         // LLS
+        // Attributes can be given by name or by number in AttribDefs,
+        // such as AT_STEALTH
         int GetAttribute(char const *ident);
+        int GetAttribute(int attrib);
+        int CalcAttribute(int attrib);
+        void CacheAttributes();
         int PracticeAttribute(char const *ident);
+        int PracticeAttribute(int attrib);
         int GetProductionBonus(int);
 
         int GetSkill(int);
@@ -216,7 +222,7 @@ class Unit : public AListElem
         int GetFlag(int);
         void SetFlag(int,int);
         void CopyFlags(Unit *);
-        int GetBattleItem(AString &itm);
+        int GetBattleItem(int item);
         int GetArmor(AString &itm, int ass);
         int GetMount(AString &itm, int canFly, int canRide, int &bonus);
         int GetWeapon(AString &itm, int riding, int ridingBonus,
@@ -299,6 +305,42 @@ class Unit : public AListElem
         // Used for tracking VISIT quests
         set<string> visited;
         int raised;
+
+        // GetAttribute results by AttribDefs index, and the state of the
+        // unit they were worked out for
+        int *attribCache;
+        int attribItems;
+        int attribSkills;
+        int attribFlags;
+        int attribGuard;
+        int attribType;
+};
+
+/// Unit number -> unit lookup for every unit in the game.
+/**
+Units are entered by Game when they are numbered (SetupUnitNums and
+GetNewUnit) and drop out again when they are deleted.  Since MoveUnit and
+Object::MoveObject keep a unit's object and that object's region current,
+the index also answers where a unit is without searching the regions.
+*/
+class UnitIndex
+{
+    public:
+        UnitIndex();
+        ~UnitIndex();
+
+        void Clear();
+        void SetUnit(int, Unit *);
+        Unit *GetUnit(int);
+        void RemoveUnit(Unit *);
+        int FirstFree();
+
+    private:
+        Unit **units;
+        int size;
+        int firstfree; ///< No free unit numbers below this one
 };
 
+extern UnitIndex AllUnits;
+
 #endif